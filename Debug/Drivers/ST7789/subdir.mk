@@ -6,14 +6,17 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../Drivers/ST7789/fonts.c \
+../Drivers/ST7789/fonts_aa.c \
 ../Drivers/ST7789/st7789.c 
 
 OBJS += \
 ./Drivers/ST7789/fonts.o \
+./Drivers/ST7789/fonts_aa.o \
 ./Drivers/ST7789/st7789.o 
 
 C_DEPS += \
 ./Drivers/ST7789/fonts.d \
+./Drivers/ST7789/fonts_aa.d \
 ./Drivers/ST7789/st7789.d 
 
 
@@ -24,7 +27,7 @@ Drivers/ST7789/%.o Drivers/ST7789/%.su Drivers/ST7789/%.cyclo: ../Drivers/ST7789
 clean: clean-Drivers-2f-ST7789
 
 clean-Drivers-2f-ST7789:
-	-$(RM) ./Drivers/ST7789/fonts.cyclo ./Drivers/ST7789/fonts.d ./Drivers/ST7789/fonts.o ./Drivers/ST7789/fonts.su ./Drivers/ST7789/st7789.cyclo ./Drivers/ST7789/st7789.d ./Drivers/ST7789/st7789.o ./Drivers/ST7789/st7789.su
+	-$(RM) ./Drivers/ST7789/fonts.cyclo ./Drivers/ST7789/fonts.d ./Drivers/ST7789/fonts.o ./Drivers/ST7789/fonts.su ./Drivers/ST7789/fonts_aa.cyclo ./Drivers/ST7789/fonts_aa.d ./Drivers/ST7789/fonts_aa.o ./Drivers/ST7789/fonts_aa.su ./Drivers/ST7789/st7789.cyclo ./Drivers/ST7789/st7789.d ./Drivers/ST7789/st7789.o ./Drivers/ST7789/st7789.su
 
 .PHONY: clean-Drivers-2f-ST7789
 
@@ -10,14 +10,22 @@ C_SRCS += \
 ../Src/console.c \
 ../Src/consoleCommands.c \
 ../Src/consoleIo.c \
+../Src/crc.c \
 ../Src/flash.c \
+../Src/macro.c \
 ../Src/main.c \
+../Src/profile.c \
+../Src/scheduler.c \
+../Src/screen.c \
 ../Src/sequence.c \
+../Src/stats.c \
 ../Src/stm32f4xx_hal_msp.c \
 ../Src/stm32f4xx_it.c \
 ../Src/syscalls.c \
 ../Src/sysmem.c \
 ../Src/system_stm32f4xx.c \
+../Src/trace.c \
+../Src/transfer.c \
 ../Src/ui.c 
 
 OBJS += \
@@ -26,14 +34,22 @@ OBJS += \
 ./Src/console.o \
 ./Src/consoleCommands.o \
 ./Src/consoleIo.o \
+./Src/crc.o \
 ./Src/flash.o \
+./Src/macro.o \
 ./Src/main.o \
+./Src/profile.o \
+./Src/scheduler.o \
+./Src/screen.o \
 ./Src/sequence.o \
+./Src/stats.o \
 ./Src/stm32f4xx_hal_msp.o \
 ./Src/stm32f4xx_it.o \
 ./Src/syscalls.o \
 ./Src/sysmem.o \
 ./Src/system_stm32f4xx.o \
+./Src/trace.o \
+./Src/transfer.o \
 ./Src/ui.o 
 
 C_DEPS += \
@@ -42,14 +58,22 @@ C_DEPS += \
 ./Src/console.d \
 ./Src/consoleCommands.d \
 ./Src/consoleIo.d \
+./Src/crc.d \
 ./Src/flash.d \
+./Src/macro.d \
 ./Src/main.d \
+./Src/profile.d \
+./Src/scheduler.d \
+./Src/screen.d \
 ./Src/sequence.d \
+./Src/stats.d \
 ./Src/stm32f4xx_hal_msp.d \
 ./Src/stm32f4xx_it.d \
 ./Src/syscalls.d \
 ./Src/sysmem.d \
 ./Src/system_stm32f4xx.d \
+./Src/trace.d \
+./Src/transfer.d \
 ./Src/ui.d 
 
 
@@ -60,7 +84,7 @@ Src/%.o Src/%.su Src/%.cyclo: ../Src/%.c Src/subdir.mk
 clean: clean-Src
 
 clean-Src:
-	-$(RM) ./Src/application.cyclo ./Src/application.d ./Src/application.o ./Src/application.su ./Src/audio.cyclo ./Src/audio.d ./Src/audio.o ./Src/audio.su ./Src/console.cyclo ./Src/console.d ./Src/console.o ./Src/console.su ./Src/consoleCommands.cyclo ./Src/consoleCommands.d ./Src/consoleCommands.o ./Src/consoleCommands.su ./Src/consoleIo.cyclo ./Src/consoleIo.d ./Src/consoleIo.o ./Src/consoleIo.su ./Src/flash.cyclo ./Src/flash.d ./Src/flash.o ./Src/flash.su ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/sequence.cyclo ./Src/sequence.d ./Src/sequence.o ./Src/sequence.su ./Src/stm32f4xx_hal_msp.cyclo ./Src/stm32f4xx_hal_msp.d ./Src/stm32f4xx_hal_msp.o ./Src/stm32f4xx_hal_msp.su ./Src/stm32f4xx_it.cyclo ./Src/stm32f4xx_it.d ./Src/stm32f4xx_it.o ./Src/stm32f4xx_it.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/system_stm32f4xx.cyclo ./Src/system_stm32f4xx.d ./Src/system_stm32f4xx.o ./Src/system_stm32f4xx.su ./Src/ui.cyclo ./Src/ui.d ./Src/ui.o ./Src/ui.su
+	-$(RM) ./Src/application.cyclo ./Src/application.d ./Src/application.o ./Src/application.su ./Src/audio.cyclo ./Src/audio.d ./Src/audio.o ./Src/audio.su ./Src/console.cyclo ./Src/console.d ./Src/console.o ./Src/console.su ./Src/consoleCommands.cyclo ./Src/consoleCommands.d ./Src/consoleCommands.o ./Src/consoleCommands.su ./Src/consoleIo.cyclo ./Src/consoleIo.d ./Src/consoleIo.o ./Src/consoleIo.su ./Src/crc.cyclo ./Src/crc.d ./Src/crc.o ./Src/crc.su ./Src/flash.cyclo ./Src/flash.d ./Src/flash.o ./Src/flash.su ./Src/macro.cyclo ./Src/macro.d ./Src/macro.o ./Src/macro.su ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/profile.cyclo ./Src/profile.d ./Src/profile.o ./Src/profile.su ./Src/scheduler.cyclo ./Src/scheduler.d ./Src/scheduler.o ./Src/scheduler.su ./Src/screen.cyclo ./Src/screen.d ./Src/screen.o ./Src/screen.su ./Src/sequence.cyclo ./Src/sequence.d ./Src/sequence.o ./Src/sequence.su ./Src/stats.cyclo ./Src/stats.d ./Src/stats.o ./Src/stats.su ./Src/stm32f4xx_hal_msp.cyclo ./Src/stm32f4xx_hal_msp.d ./Src/stm32f4xx_hal_msp.o ./Src/stm32f4xx_hal_msp.su ./Src/stm32f4xx_it.cyclo ./Src/stm32f4xx_it.d ./Src/stm32f4xx_it.o ./Src/stm32f4xx_it.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/system_stm32f4xx.cyclo ./Src/system_stm32f4xx.d ./Src/system_stm32f4xx.o ./Src/system_stm32f4xx.su ./Src/trace.cyclo ./Src/trace.d ./Src/trace.o ./Src/trace.su ./Src/transfer.cyclo ./Src/transfer.d ./Src/transfer.o ./Src/transfer.su ./Src/ui.cyclo ./Src/ui.d ./Src/ui.o ./Src/ui.su
 
 .PHONY: clean-Src
 
@@ -9,10 +9,20 @@ typedef struct {
     const uint16_t *data;
 } FontDef;
 
+/* Anti-aliased font made from a FontDef by Tools/fontgen.py. Glyphs are runs of
+ * 2 bit levels between the background and text colours, see fontgen.py. */
+typedef struct {
+    const uint8_t width;
+    uint8_t height;
+    const uint16_t *offsets;
+    const uint8_t *data;
+} AAFontDef;
+
 //Font lib.
 extern FontDef Font_7x10;
 extern FontDef Font_11x18;
 extern FontDef Font_16x26;
+extern AAFontDef AAFont_11x18;
 
 //16-bit(RGB565) Image lib.
 /*******************************************
@@ -0,0 +1,114 @@
+/* Anti-aliased fonts generated by Tools/fontgen.py from fonts.c, do not edit */
+
+#include "fonts.h"
+
+static const uint16_t AAFont11x18Offsets [] = {
+0, 2, 31, 46, 83, 127, 172, 212, 224, 266, 308, 321,
+343, 357, 362, 368, 397, 434, 466, 500, 535, 567, 600, 636,
+666, 704, 740, 758, 782, 805, 817, 840, 874, 913, 951, 988,
+1023, 1058, 1086, 1114, 1149, 1181, 1212, 1244, 1283, 1313, 1356, 1393,
+1428, 1461, 1497, 1534, 1570, 1600, 1632, 1669, 1713, 1755, 1790, 1820,
+1856, 1887, 1923, 1945, 1949, 1958, 1985, 2019, 2045, 2078, 2102, 2133,
+2168, 2200, 2229, 2268, 2306, 2336, 2368, 2392, 2418, 2451, 2485, 2508,
+2533, 2562, 2586, 2614, 2649, 2678, 2714, 2739, 2777, 2815, 2853,
+};
+
+static const uint8_t AAFont11x18 [] = {
+0x00, 0x00,   // sp
+0x01, 0x0E, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x33, 0x3D, 0x33, 0x0D, 0x30,   // !
+0x01, 0x05, 0x2D, 0x0D, 0x31, 0xD0, 0xD3, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x1D, 0x0D, 0x20,   // "
+0x01, 0x0E, 0x2D, 0x1D, 0x30, 0xD1, 0xD3, 0x0D, 0x1D, 0x34, 0xD5, 0xD4, 0x1F, 0xFC, 0x1F, 0xFC, 0x3D, 0x40, 0xD4, 0x14, 0xD0, 0x4D, 0x3F, 0xFC, 0x1F, 0xFC, 0x14, 0xD5, 0xD4, 0x3D, 0x1D, 0x30, 0xD1, 0xD3, 0x0D, 0x1D, 0x20,   // #
+0x01, 0x10, 0x14, 0xF4, 0x34, 0xFD, 0x42, 0xE0, 0xC0, 0xD2, 0xD1, 0xC0, 0xD2, 0xE0, 0xC3, 0x14, 0xF4, 0x31, 0x4F, 0x43, 0x24, 0xE4, 0x32, 0xC0, 0xD2, 0xD1, 0xC0, 0xD2, 0xD4, 0x0C, 0x0D, 0x2E, 0x0C, 0x0D, 0x24, 0xFD, 0x43, 0x4F, 0x43, 0x24, 0xC4, 0x33, 0x0C, 0x30,   // $
+0x01, 0x0E, 0x4E, 0x43, 0x1D, 0x0D, 0x31, 0xD0, 0xD2, 0x4C, 0x0D, 0x0D, 0x14, 0xD0, 0xD0, 0xD0, 0x4D, 0x40, 0x4E, 0x5D, 0x43, 0x14, 0xD4, 0x31, 0x4D, 0x32, 0x4D, 0x0E, 0x41, 0x4D, 0x0D, 0x0D, 0x1D, 0x40, 0xD0, 0xD1, 0xC4, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x14, 0xE4, 0x00,   // %
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x30, 0xD5, 0xD3, 0x0D, 0x1D, 0x30, 0xD5, 0xD3, 0x04, 0xF4, 0x32, 0xD4, 0x30, 0x4F, 0x40, 0xD1, 0xD5, 0xD0, 0xD1, 0xD1, 0x4E, 0x41, 0xD3, 0xD2, 0xD4, 0x04, 0xE4, 0x14, 0xFC, 0x0D, 0x24, 0xE4, 0x0C, 0x40,   // &
+0x01, 0x05, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x30,   // '
+0x00, 0x12, 0x32, 0x4C, 0x33, 0x4C, 0x43, 0x24, 0xD3, 0x3D, 0x43, 0x3D, 0x33, 0x4C, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x04, 0xC4, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x34, 0xD3, 0x30, 0x4C, 0x43, 0x30, 0x4C, 0x10,   // (
+0x00, 0x12, 0x1C, 0x43, 0x30, 0x4C, 0x43, 0x30, 0xD4, 0x33, 0x4D, 0x33, 0x0D, 0x33, 0x04, 0xC4, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x4C, 0x43, 0x3D, 0x33, 0x4D, 0x33, 0xD4, 0x32, 0x4C, 0x43, 0x3C, 0x43, 0x20,   // )
+0x01, 0x05, 0x3D, 0x32, 0xC0, 0xD0, 0xC3, 0x0F, 0xD3, 0x1F, 0x31, 0xD5, 0xD2,   // *
+0x03, 0x0A, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x4D, 0x43, 0xFF, 0xD0, 0xFF, 0xD3, 0x4D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x30,   // +
+0x0D, 0x05, 0x3D, 0x33, 0x0D, 0x33, 0x04, 0xC3, 0x30, 0x4C, 0x33, 0x0C, 0x43, 0x00,   // ,
+0x09, 0x02, 0x2F, 0x32, 0xF3,   // -
+0x0D, 0x02, 0x3D, 0x33, 0x0D, 0x30,   // .
+0x01, 0x0E, 0x31, 0xD3, 0x30, 0xD3, 0x34, 0xD3, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x4D, 0x33, 0xD4, 0x33, 0xD3, 0x30, 0xD3, 0x34, 0xD3, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x31,   // /
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x34, 0xD5, 0xD4, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x0D, 0x0D, 0x2D, 0x0D, 0x0D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x41, 0x4D, 0x24, 0xD5, 0xD4, 0x3F, 0xD3, 0x04, 0xF4, 0x20,   // 0
+0x01, 0x0E, 0x34, 0xD3, 0x24, 0xE3, 0x14, 0xF3, 0x1D, 0x0D, 0x31, 0xC4, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x30,   // 1
+0x01, 0x0E, 0x14, 0xF4, 0x34, 0xFD, 0x42, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD3, 0x34, 0xD3, 0x24, 0xD4, 0x31, 0x4D, 0x43, 0x14, 0xD4, 0x31, 0x4D, 0x43, 0x14, 0xD4, 0x32, 0xD3, 0x30, 0xFF, 0x2F, 0xF1,   // 2
+0x01, 0x0E, 0x14, 0xE4, 0x30, 0x4F, 0xC4, 0x3D, 0x40, 0x4D, 0x3D, 0x2D, 0x33, 0x4D, 0x32, 0xE4, 0x32, 0xE4, 0x33, 0x4D, 0x43, 0x34, 0xD3, 0x30, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // 3
+0x01, 0x0E, 0x34, 0xD3, 0x3E, 0x32, 0x4E, 0x32, 0xF3, 0x2F, 0x31, 0x4C, 0x0D, 0x31, 0xD0, 0xD3, 0x04, 0xD0, 0xD3, 0x0D, 0x04, 0xD4, 0x3F, 0xF2, 0xFF, 0x31, 0x4D, 0x43, 0x3D, 0x33, 0x0D, 0x30,   // 4
+0x01, 0x0E, 0x0F, 0xE3, 0xFE, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x0E, 0x43, 0xFE, 0x42, 0xD4, 0x04, 0xE3, 0x34, 0xD3, 0x30, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // 5
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x42, 0x4D, 0x5E, 0x2D, 0x41, 0x4D, 0x2D, 0x33, 0x0D, 0x0E, 0x43, 0xFE, 0x42, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0x4D, 0x5E, 0x3F, 0xD4, 0x34, 0xF4, 0x20,   // 6
+0x01, 0x0E, 0x0F, 0xF2, 0xFF, 0x33, 0x0D, 0x33, 0xD4, 0x32, 0x4D, 0x33, 0xD4, 0x32, 0x4D, 0x33, 0xD4, 0x33, 0xD3, 0x30, 0xD3, 0x34, 0xC4, 0x33, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x10,   // 7
+0x01, 0x0E, 0x14, 0xF4, 0x34, 0xFD, 0x42, 0xD4, 0x04, 0xE2, 0xD2, 0x4D, 0x2D, 0x3D, 0x24, 0xC4, 0x14, 0xC4, 0x30, 0xF3, 0x04, 0xFD, 0x42, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // 8
+0x01, 0x0E, 0x14, 0xF4, 0x34, 0xFD, 0x3E, 0x5D, 0x42, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xE3, 0x4E, 0x0D, 0x33, 0x0D, 0x2D, 0x41, 0x4D, 0x2E, 0x5D, 0x42, 0x4F, 0xD3, 0x04, 0xF4, 0x20,   // 9
+0x05, 0x0A, 0x3D, 0x33, 0x0D, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x2D, 0x33, 0x0D, 0x30,   // :
+0x06, 0x0C, 0x3D, 0x33, 0x0D, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0xD3, 0x30, 0xD3, 0x30, 0x4C, 0x33, 0x04, 0xC3, 0x30, 0xC4, 0x30,   // ;
+0x04, 0x09, 0x32, 0x4C, 0x32, 0x4E, 0x30, 0x4E, 0x43, 0x4E, 0x43, 0x1D, 0x33, 0x04, 0xE4, 0x33, 0x4E, 0x43, 0x34, 0xE3, 0x30, 0x4C, 0x10,   // <
+0x05, 0x06, 0x0F, 0xF2, 0xFF, 0x33, 0x33, 0x33, 0x0F, 0xF2, 0xFF, 0x10,   // =
+0x04, 0x09, 0x0C, 0x43, 0x30, 0xE4, 0x33, 0x4E, 0x43, 0x34, 0xE4, 0x33, 0x0D, 0x31, 0x4E, 0x43, 0x4E, 0x43, 0x0E, 0x43, 0x2C, 0x43, 0x30,   // >
+0x01, 0x0E, 0x14, 0xFC, 0x42, 0x4F, 0xE4, 0x1E, 0x40, 0x4E, 0x1D, 0x42, 0x4D, 0x33, 0x4D, 0x32, 0x4E, 0x31, 0x4E, 0x43, 0x04, 0xE4, 0x31, 0xE4, 0x32, 0xD4, 0x33, 0xD3, 0x33, 0x33, 0xD3, 0x30, 0xD3, 0x00,   // ?
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x42, 0x4D, 0x40, 0x4D, 0x2E, 0x14, 0xD2, 0xD4, 0x04, 0xE2, 0xD0, 0xFC, 0x2D, 0x0D, 0x0D, 0x2D, 0x0D, 0x0D, 0x2D, 0x0F, 0xC2, 0xD0, 0x4F, 0x2D, 0x43, 0x34, 0xD5, 0xC3, 0x1F, 0xC3, 0x14, 0xE4, 0x30,   // @
+0x01, 0x0E, 0x3E, 0x32, 0x4E, 0x43, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x1D, 0x0D, 0x30, 0x4D, 0x0D, 0x43, 0xD4, 0x04, 0xD3, 0xD4, 0x04, 0xD3, 0xFE, 0x3F, 0xE2, 0x4D, 0x40, 0x4D, 0x41, 0xD4, 0x24, 0xD1, 0xD3, 0x0D, 0x1D, 0x30, 0xD0,   // A
+0x01, 0x0E, 0x0F, 0xC4, 0x30, 0xFD, 0x43, 0xD4, 0x04, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD4, 0x04, 0xD3, 0xFD, 0x43, 0xFD, 0x43, 0xD4, 0x04, 0xD4, 0x2D, 0x24, 0xD2, 0xD2, 0x4D, 0x2D, 0x40, 0x4E, 0x2F, 0xE4, 0x2F, 0xD4, 0x20,   // B
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x42, 0x4D, 0x40, 0x4D, 0x2D, 0x42, 0xD2, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD4, 0x2D, 0x24, 0xD4, 0x04, 0xD3, 0xFD, 0x43, 0x4F, 0x42,   // C
+0x01, 0x0E, 0x0F, 0xC4, 0x30, 0xFE, 0x3D, 0x40, 0x4D, 0x42, 0xD2, 0xE2, 0xD2, 0x4D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x24, 0xD2, 0xD2, 0xD4, 0x2D, 0x40, 0x4D, 0x3F, 0xD4, 0x3F, 0xC4, 0x30,   // D
+0x01, 0x0E, 0x0F, 0xF2, 0xFF, 0x2D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3F, 0xE3, 0xFE, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3F, 0xF2, 0xFF, 0x10,   // E
+0x01, 0x0E, 0x0F, 0xF2, 0xFF, 0x2D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3F, 0xE3, 0xFE, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33,   // F
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x42, 0x4D, 0x40, 0x4D, 0x2D, 0x42, 0xD2, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD2, 0xE2, 0xD2, 0xE2, 0xD2, 0x4D, 0x2D, 0x42, 0xD2, 0x4D, 0x40, 0x4D, 0x3F, 0xE3, 0x4F, 0x42,   // G
+0x01, 0x0E, 0x0D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x41, 0x4D, 0x2F, 0xF2, 0xFF, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x10,   // H
+0x01, 0x0E, 0x1F, 0xD3, 0x0F, 0xD3, 0x14, 0xD4, 0x33, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x34, 0xD4, 0x31, 0xFD, 0x30, 0xFD, 0x20,   // I
+0x01, 0x0E, 0x32, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // J
+0x01, 0x0E, 0x0D, 0x34, 0xD1, 0xD2, 0x4D, 0x41, 0xD1, 0x4D, 0x42, 0xD1, 0xD4, 0x3D, 0x04, 0xD3, 0x0D, 0x0D, 0x43, 0x0F, 0x32, 0xFC, 0x43, 0x0D, 0x5D, 0x30, 0xD1, 0xD4, 0x3D, 0x14, 0xD4, 0x2D, 0x24, 0xD2, 0xD3, 0xD4, 0x1D, 0x34, 0xD0,   // K
+0x01, 0x0E, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3F, 0xF2, 0xFF, 0x10,   // L
+0x01, 0x0E, 0x0E, 0x2E, 0x1E, 0x40, 0x4E, 0x1F, 0x0F, 0x1F, 0x0C, 0x0D, 0x1D, 0x0C, 0x0C, 0x0D, 0x1D, 0x0C, 0x0C, 0x0D, 0x1D, 0x0E, 0x0D, 0x1D, 0x04, 0xC4, 0x0D, 0x1D, 0x30, 0xD1, 0xD3, 0x0D, 0x1D, 0x30, 0xD1, 0xD3, 0x0D, 0x1D, 0x30, 0xD1, 0xD3, 0x0D, 0x00,   // M
+0x01, 0x0E, 0x0E, 0x2D, 0x2E, 0x41, 0xD2, 0xF1, 0xD2, 0xF1, 0xD2, 0xF4, 0x0D, 0x2D, 0x0D, 0x0D, 0x2D, 0x0D, 0x0D, 0x2D, 0x0D, 0x0D, 0x2D, 0x04, 0xC0, 0xD2, 0xD1, 0xF2, 0xD1, 0xF2, 0xD1, 0xF2, 0xD1, 0x4E, 0x2D, 0x2E, 0x10,   // N
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x34, 0xD5, 0xD4, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x41, 0x4D, 0x24, 0xD5, 0xD4, 0x3F, 0xD3, 0x04, 0xF4, 0x20,   // O
+0x01, 0x0E, 0x0F, 0xD4, 0x3F, 0xE4, 0x2D, 0x40, 0x4E, 0x2D, 0x24, 0xD2, 0xD3, 0xD2, 0xD2, 0x4D, 0x2D, 0x40, 0x4E, 0x2F, 0xE4, 0x2F, 0xD4, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33,   // P
+0x01, 0x0E, 0x14, 0xF4, 0x30, 0xFD, 0x34, 0xD5, 0xD4, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x1C, 0x0D, 0x2D, 0x40, 0xF2, 0x4D, 0x40, 0xD3, 0x0F, 0xE4, 0x24, 0xF5, 0xC0,   // Q
+0x01, 0x0E, 0x0F, 0xD4, 0x3F, 0xE4, 0x2D, 0x40, 0x4E, 0x2D, 0x24, 0xD2, 0xD2, 0x4D, 0x2D, 0x40, 0x4E, 0x2F, 0xE4, 0x2F, 0xD4, 0x3D, 0x5D, 0x43, 0xD1, 0x4D, 0x3D, 0x2D, 0x42, 0xD2, 0x4D, 0x2D, 0x3D, 0x41, 0xD3, 0x4D, 0x00,   // R
+0x01, 0x0E, 0x24, 0xE4, 0x30, 0x4F, 0xC4, 0x3D, 0x40, 0x4D, 0x3D, 0x2D, 0x3D, 0x43, 0x3E, 0x43, 0x24, 0xF4, 0x32, 0x4E, 0x43, 0x24, 0xE2, 0xD2, 0x4D, 0x2D, 0x42, 0xD2, 0x4D, 0x40, 0x4D, 0x3F, 0xD4, 0x34, 0xF4, 0x20,   // S
+0x01, 0x0E, 0xFF, 0xD0, 0xFF, 0xD3, 0x4D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x30,   // T
+0x01, 0x0E, 0x0D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x41, 0x4D, 0x2E, 0x5E, 0x24, 0xFD, 0x43, 0x4F, 0x42,   // U
+0x01, 0x0E, 0x0D, 0x30, 0xD1, 0xD3, 0x0D, 0x1D, 0x42, 0x4D, 0x14, 0xD2, 0xD4, 0x2D, 0x2D, 0x3D, 0x40, 0x4D, 0x34, 0xD0, 0xD4, 0x30, 0xD0, 0xD3, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x14, 0xE4, 0x32, 0xE3, 0x3E, 0x33, 0x4C, 0x43,   // V
+0x01, 0x0E, 0xD3, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x1D, 0x0D, 0x1D, 0x1D, 0x04, 0xC1, 0xD1, 0xC4, 0x1C, 0x04, 0xD4, 0x0C, 0x2C, 0x0F, 0x0C, 0x2C, 0x0C, 0x5C, 0x0C, 0x2C, 0x0C, 0x1C, 0x0C, 0x2E, 0x1E, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x10,   // W
+0x01, 0x0E, 0xD4, 0x30, 0xD0, 0x4D, 0x34, 0xC4, 0x1D, 0x41, 0x4D, 0x24, 0xD4, 0x0D, 0x43, 0xE0, 0xD3, 0x04, 0xF4, 0x31, 0x4D, 0x43, 0x24, 0xD4, 0x32, 0xF4, 0x30, 0x4F, 0xC3, 0x4E, 0x0D, 0x42, 0xE4, 0x04, 0xD1, 0x4D, 0x42, 0xD4, 0x0D, 0x43, 0x4D, 0x00,   // X
+0x01, 0x0E, 0xD4, 0x34, 0xD0, 0x4D, 0x3D, 0x41, 0xD4, 0x14, 0xD2, 0x4D, 0x1D, 0x43, 0xD5, 0xD3, 0x04, 0xF4, 0x31, 0xF3, 0x24, 0xD4, 0x33, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x00,   // Y
+0x01, 0x0E, 0x1F, 0xE3, 0xFE, 0x33, 0x0D, 0x33, 0xD4, 0x32, 0x4D, 0x32, 0x4D, 0x43, 0x2D, 0x43, 0x24, 0xD3, 0x3D, 0x43, 0x24, 0xD3, 0x24, 0xD4, 0x32, 0xD3, 0x30, 0xFF, 0x2F, 0xF1,   // Z
+0x00, 0x12, 0x3F, 0x32, 0xF3, 0x2D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3F, 0x32, 0xF2,   // [
+0x01, 0x0E, 0x2D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x34, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD4, 0x33, 0x4D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x34, 0xD3, 0x30, 0xD3, 0x30, 0xD2,   //
+0x00, 0x12, 0x2F, 0x32, 0xF3, 0x34, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x34, 0xD3, 0x2F, 0x32, 0xF3,   // ]
+0x01, 0x08, 0x3D, 0x33, 0x4D, 0x43, 0x2F, 0x31, 0x4C, 0x5C, 0x43, 0x0D, 0x1D, 0x34, 0xD1, 0xD4, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x10,   // ^
+0x10, 0x01, 0xFF, 0xE0,   // _
+0x01, 0x03, 0x1E, 0x33, 0x4D, 0x43, 0x34, 0xD3, 0x00,   // `
+0x05, 0x0A, 0x14, 0xFC, 0x42, 0x4F, 0xE2, 0xD4, 0x14, 0xD3, 0x34, 0xD3, 0x4F, 0xD2, 0x4F, 0xE2, 0xD4, 0x2D, 0x2D, 0x40, 0x4E, 0x2F, 0xF4, 0x14, 0xE4, 0x04, 0xD0,   // a
+0x01, 0x0E, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x0E, 0x43, 0xFE, 0x42, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0xFE, 0x42, 0xD0, 0xE4, 0x20,   // b
+0x05, 0x0A, 0x14, 0xF4, 0x34, 0xFD, 0x42, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0x30, 0xD3, 0x30, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // c
+0x01, 0x0E, 0x32, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x4E, 0x0D, 0x24, 0xFE, 0x2E, 0x5E, 0x2D, 0x41, 0x4D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x41, 0x4D, 0x2E, 0x5E, 0x24, 0xFE, 0x34, 0xE0, 0xD1,   // d
+0x05, 0x0A, 0x14, 0xF4, 0x34, 0xFD, 0x3E, 0x5D, 0x42, 0xD3, 0xD2, 0xFF, 0x2F, 0xF2, 0xD3, 0x30, 0xE4, 0x04, 0xD2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // e
+0x01, 0x0E, 0x34, 0xFC, 0x30, 0xFD, 0x30, 0xD4, 0x32, 0x4D, 0x43, 0x0F, 0xF2, 0xFF, 0x30, 0x4D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x30,   // f
+0x04, 0x0E, 0x14, 0xE0, 0xD2, 0x4F, 0xE2, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xE3, 0x4E, 0x0D, 0x33, 0x4D, 0x2D, 0x40, 0x4E, 0x2F, 0xE4, 0x24, 0xFC, 0x42,   // g
+0x01, 0x0E, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x0F, 0x42, 0xFF, 0x2E, 0x40, 0x4D, 0x2D, 0x42, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD1,   // h
+0x01, 0x0E, 0x30, 0xD3, 0x30, 0xD3, 0x33, 0x33, 0x33, 0xFC, 0x31, 0xFC, 0x33, 0x4D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x30,   // i
+0x00, 0x12, 0x30, 0xD3, 0x30, 0xD3, 0x33, 0x33, 0x33, 0xFC, 0x31, 0xFC, 0x33, 0x4D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x30, 0xC4, 0x04, 0xD3, 0x0F, 0xD3, 0x04, 0xF4, 0x30,   // j
+0x01, 0x0E, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x24, 0xD2, 0xD1, 0x4D, 0x42, 0xD0, 0x4D, 0x43, 0xD0, 0xD4, 0x30, 0xFC, 0x43, 0x0E, 0x0D, 0x43, 0xD4, 0x04, 0xD3, 0xD2, 0xD4, 0x2D, 0x24, 0xD4, 0x1D, 0x34, 0xD0,   // k
+0x01, 0x0E, 0x1F, 0xC3, 0x1F, 0xC3, 0x34, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3,   // l
+0x05, 0x0A, 0xD0, 0xE0, 0xD4, 0x0F, 0xFD, 0x0D, 0x5E, 0x0D, 0x0D, 0x1D, 0x40, 0xD0, 0xD1, 0xD1, 0xD0, 0xD1, 0xD1, 0xD0, 0xD1, 0xD1, 0xD0, 0xD1, 0xD1, 0xD0, 0xD1, 0xD1, 0xD0, 0xD1, 0xD1, 0xD0,   // m
+0x05, 0x0A, 0x0D, 0x0F, 0x42, 0xFF, 0x2E, 0x40, 0x4D, 0x2D, 0x42, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD3, 0xD1,   // n
+0x05, 0x0A, 0x14, 0xF4, 0x34, 0xFD, 0x42, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xD4, 0x34, 0xF4, 0x20,   // o
+0x04, 0x0E, 0x0D, 0x0E, 0x43, 0xFE, 0x42, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0xFE, 0x42, 0xD0, 0xE4, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33,   // p
+0x04, 0x0E, 0x14, 0xE0, 0xD2, 0x4F, 0xE2, 0xE5, 0xE2, 0xD4, 0x14, 0xD2, 0xD3, 0xD2, 0xD3, 0xD2, 0xD4, 0x14, 0xD2, 0xE5, 0xE2, 0x4F, 0xE3, 0x4E, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x10,   // q
+0x05, 0x0A, 0x0D, 0x5E, 0x42, 0x4F, 0xE3, 0xE5, 0xC4, 0x3D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x32,   // r
+0x05, 0x0A, 0x14, 0xF4, 0x34, 0xFE, 0x2D, 0x41, 0x4D, 0x2D, 0x43, 0x3F, 0xE4, 0x24, 0xFE, 0x33, 0x4D, 0x2D, 0x41, 0x4D, 0x2F, 0xE4, 0x34, 0xF4, 0x20,   // s
+0x02, 0x0D, 0x24, 0xC3, 0x30, 0xD3, 0x34, 0xD4, 0x31, 0xFE, 0x3F, 0xE3, 0x04, 0xD4, 0x33, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD4, 0x33, 0xFD, 0x30, 0x4F, 0xC1,   // t
+0x05, 0x0A, 0x0D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x3D, 0x2D, 0x24, 0xD2, 0xD4, 0x04, 0xE2, 0xFF, 0x24, 0xF0, 0xD1,   // u
+0x05, 0x0A, 0x0D, 0x42, 0x4D, 0x14, 0xD2, 0xD4, 0x2D, 0x2D, 0x3D, 0x40, 0x4D, 0x34, 0xD0, 0xD4, 0x30, 0xD0, 0xD3, 0x1D, 0x0D, 0x31, 0x4E, 0x43, 0x2E, 0x33, 0x4D, 0x30,   // v
+0x05, 0x0A, 0xD0, 0xE0, 0xD1, 0xD0, 0xE0, 0xD1, 0xD0, 0xE0, 0xD1, 0x4C, 0x0C, 0x0C, 0x0C, 0x42, 0xC0, 0xC0, 0xC0, 0xC3, 0xC0, 0xC0, 0xC0, 0xC3, 0xE0, 0xE3, 0xE0, 0xE3, 0x4C, 0x40, 0x4C, 0x43, 0x0C, 0x2C, 0x30,   // w
+0x05, 0x0A, 0x0D, 0x41, 0x4D, 0x24, 0xD1, 0xD4, 0x3D, 0x5D, 0x30, 0x4F, 0x43, 0x14, 0xD4, 0x32, 0x4D, 0x43, 0x14, 0xF4, 0x30, 0xD5, 0xD3, 0x4D, 0x1D, 0x42, 0xD4, 0x14, 0xD1,   // x
+0x04, 0x0E, 0x0D, 0x3D, 0x2D, 0x42, 0xD2, 0x4D, 0x14, 0xD3, 0xD1, 0xD4, 0x3D, 0x40, 0xD3, 0x04, 0xD0, 0xD3, 0x1D, 0x0D, 0x31, 0xD0, 0xD3, 0x14, 0xE4, 0x32, 0xE3, 0x24, 0xE3, 0x14, 0xE4, 0x30, 0xFC, 0x31, 0xE4, 0x31,   // y
+0x05, 0x0A, 0x0F, 0xFC, 0x1F, 0xFC, 0x33, 0xD4, 0x31, 0x4D, 0x43, 0x14, 0xD4, 0x31, 0x4D, 0x43, 0x14, 0xD4, 0x31, 0x4D, 0x33, 0xFF, 0xC1, 0xFF, 0xC0,   // z
+0x00, 0x12, 0x30, 0x4E, 0x32, 0xF3, 0x2D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x4D, 0x32, 0x4E, 0x32, 0xE4, 0x32, 0xE4, 0x32, 0x4E, 0x33, 0x4D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3F, 0x32, 0x4E, 0x10,   // {
+0x00, 0x12, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3, 0x30, 0xD3,   // |
+0x00, 0x12, 0x1E, 0x43, 0x2F, 0x33, 0x4D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x0D, 0x43, 0x3E, 0x43, 0x24, 0xE3, 0x24, 0xE3, 0x2E, 0x43, 0x2D, 0x43, 0x3D, 0x33, 0x0D, 0x33, 0x0D, 0x33, 0x4D, 0x32, 0xF3, 0x2E, 0x43, 0x00,   // }
+0x07, 0x03, 0x04, 0xE4, 0x04, 0xC2, 0xFF, 0x2C, 0x40, 0x4E, 0x41,   // ~
+};
+
+AAFontDef AAFont_11x18 = {11,18,AAFont11x18Offsets,AAFont11x18};
@@ -1,9 +1,17 @@
 #include "st7789.h"
+#include "profile.h"
 
 /* PA changes                                                                     */
 /*                                                                                */
 /* - Added software reset at start of Init                                        */
 /* - Commented out porch control, voltage generator, and gamma settings in Init   */
+/* - Added ST7789_Fill_Rows to fill a band of full width rows                     */
+/* - Added profiling zone to ST7789_WriteChar                                     */
+/* - Text is expanded into disp_buf and sent by DMA a run of glyphs at a time     */
+/* - Added ST7789_WriteCharsAsync, sending bands of text while the next is drawn  */
+/* - Fills all go through ST7789_FillArea, fixing colors with unequal bytes       */
+/* - Added ST7789_DrawColumn for drawing a waveform a column at a time            */
+/* - Added ST7789_WriteCharsAA(Async) for anti-aliased fonts made by fontgen.py   */
 
 #ifdef USE_DMA
 #include <string.h>
@@ -14,9 +22,65 @@ uint16_t DMA_MIN_SIZE = 16;
  * Then you can specify the framebuffer size to the full resolution below.
  */
  #define HOR_LEN 	5	//	Alse mind the resolution of your screen!
-uint16_t disp_buf[ST7789_WIDTH * HOR_LEN];
+/* Word aligned so fills can write it two pixels at a time */
+uint16_t disp_buf[ST7789_WIDTH * HOR_LEN] __attribute__((aligned(4)));
+
+/* Fills bigger than disp_buf send one pixel over and over (see ST7789_FillRepeat) */
+#define FILL_REPEAT_MIN_PIXELS (ST7789_WIDTH * HOR_LEN)
+
+/* Text can also be written without waiting for the panel (ST7789_WriteCharsAsync). Bands of
+ * rows are rasterised into one of two buffers, disp_buf and band_buf, while the other is sent. */
+#define ASYNC_MAX_CHARS 32
+static uint16_t band_buf[ST7789_WIDTH * HOR_LEN];
+static uint16_t *bands[2] = {disp_buf, band_buf};
+
+static struct {
+	volatile uint8_t active;
+	char str[ASYNC_MAX_CHARS];
+	uint16_t len;
+	/* FontDef can't be assigned, it has a const member */
+	const uint16_t *font_data;
+	uint8_t font_width;
+	uint8_t font_height;
+	uint16_t fg;
+	uint16_t bg;
+	uint16_t chunk_rows;
+	/* First row not rasterised yet */
+	uint16_t next_row;
+	/* Buffers to rasterise into and send next, they take turns */
+	uint8_t raster_band;
+	volatile uint8_t send_band;
+	volatile uint8_t sending;
+	volatile uint8_t ready[2];
+	uint16_t band_size[2];
+	/* Anti-aliased font, or NULL when font_data is used. The glyphs are in aa_glyphs. */
+	const AAFontDef *aa_font;
+	uint16_t palette[4];
+} async;
+
+static void (*async_callback)(void) = NULL;
+
+static void ST7789_WaitAsync(void);
 #endif
 
+/* Where each glyph of an anti-aliased write has got to. Its runs carry on from one row to the
+ * next, so a band of rows carries on decoding from where the last band stopped. */
+#define AA_MAX_CHARS 32
+
+typedef struct {
+	/* Byte holding the next nibble, and whether it is the high one */
+	const uint8_t *next;
+	uint8_t high;
+	/* Level and number of pixels left of the run being drawn */
+	uint8_t level;
+	uint8_t run;
+	/* Rows holding the glyph's runs, the rest are background */
+	uint8_t top;
+	uint8_t bottom;
+} AAGlyphState;
+
+static AAGlyphState aa_glyphs[AA_MAX_CHARS];
+
 /**
  * @brief Write command to ST7789 controller
  * @param cmd -> command to write
@@ -24,6 +88,9 @@ uint16_t disp_buf[ST7789_WIDTH * HOR_LEN];
  */
 static void ST7789_WriteCommand(uint8_t cmd)
 {
+	#ifdef USE_DMA
+		ST7789_WaitAsync();
+	#endif
 	ST7789_Select();
 	ST7789_DC_Clr();
 	HAL_SPI_Transmit(&ST7789_SPI_PORT, &cmd, sizeof(cmd), HAL_MAX_DELAY);
@@ -199,34 +266,128 @@ void ST7789_Init(void)
 	ST7789_Fill_Color(BLACK);				//	Fill with Black.
 }
 
+#ifdef USE_DMA
 /**
- * @brief Fill the DisplayWindow with single color
+ * @brief Switch SPI and its DMA between byte frames, sent from an incrementing
+ *        address, and 16 bit frames sent from one address over and over
+ * @param repeat -> 1 for 16 bit frames without memory increment
+ * @return none
+ */
+static void ST7789_SetFillMode(uint8_t repeat)
+{
+	SPI_HandleTypeDef *hspi = &ST7789_SPI_PORT;
+	DMA_HandleTypeDef *hdma = hspi->hdmatx;
+
+	__HAL_SPI_DISABLE(hspi);
+	if (repeat) {
+		SET_BIT(hspi->Instance->CR1, SPI_CR1_DFF);
+		hspi->Init.DataSize = SPI_DATASIZE_16BIT;
+		hdma->Init.MemInc = DMA_MINC_DISABLE;
+		hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+		hdma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+	}
+	else {
+		CLEAR_BIT(hspi->Instance->CR1, SPI_CR1_DFF);
+		hspi->Init.DataSize = SPI_DATASIZE_8BIT;
+		hdma->Init.MemInc = DMA_MINC_ENABLE;
+		hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+		hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	}
+	HAL_DMA_Init(hdma);
+}
+
+/**
+ * @brief Send one color for a number of pixels, as 16 bit SPI frames from a
+ *        single word with the DMA memory increment off, so no buffer is filled
+ * @param color -> color to send
+ * @param pixels -> number of pixels
+ * @return none
+ */
+static void ST7789_FillRepeat(uint16_t color, uint32_t pixels)
+{
+	/* 16 bit frames go high byte first, so the color isn't swapped */
+	static uint16_t fill_color;
+
+	fill_color = color;
+	ST7789_SetFillMode(1);
+	while (pixels > 0) {
+		uint16_t chunk = pixels > 65535 ? 65535 : pixels;
+		HAL_SPI_Transmit_DMA(&ST7789_SPI_PORT, (uint8_t *)&fill_color, chunk);
+		/* The SPI is ready once the last frame is out, not just handed over */
+		while (HAL_SPI_GetState(&ST7789_SPI_PORT) != HAL_SPI_STATE_READY)
+		{}
+		pixels -= chunk;
+	}
+	ST7789_SetFillMode(0);
+}
+#endif
+
+/**
+ * @brief Fill an area with one color. All the fill primitives use this. The
+ *        address window is set once and the area streamed by DMA: big areas by
+ *        ST7789_FillRepeat, smaller ones from disp_buf filled two pixels at a
+ *        time.
+ * @param x0&y0 -> coordinate of the start point
+ * @param x1&y1 -> coordinate of the end point, must be on the display
  * @param color -> color to Fill with
  * @return none
  */
-void ST7789_Fill_Color(uint16_t color)
+static void ST7789_FillArea(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint16_t color)
 {
-	uint16_t i;
-	ST7789_SetAddressWindow(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1);
+	uint32_t pixels = (uint32_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+
+	ST7789_SetAddressWindow(x0, y0, x1, y1);
 	ST7789_Select();
+	ST7789_DC_Set();
 
 	#ifdef USE_DMA
-		for (i = 0; i < ST7789_HEIGHT / HOR_LEN; i++)
-		{
-			memset(disp_buf, color, sizeof(disp_buf));
-			ST7789_WriteData((uint8_t *)disp_buf, sizeof(disp_buf));
+		if (pixels >= FILL_REPEAT_MIN_PIXELS) {
+			ST7789_FillRepeat(color, pixels);
+		}
+		else {
+			/* disp_buf is sent a byte at a time, so the color is stored high byte first */
+			uint16_t swapped = (color >> 8) | (color << 8);
+			uint32_t pair = swapped | ((uint32_t)swapped << 16);
+			uint32_t *buf = (uint32_t *)disp_buf;
+			uint32_t i;
+
+			for (i = 0; i < (pixels + 1) / 2; i++) {
+				buf[i] = pair;
+			}
+			ST7789_WriteData((uint8_t *)disp_buf, pixels * sizeof(disp_buf[0]));
 		}
 	#else
-		uint16_t j;
-		for (i = 0; i < ST7789_WIDTH; i++)
-				for (j = 0; j < ST7789_HEIGHT; j++) {
-					uint8_t data[] = {color >> 8, color & 0xFF};
-					ST7789_WriteData(data, sizeof(data));
-				}
+		uint8_t data[] = {color >> 8, color & 0xFF};
+		while (pixels--) {
+			HAL_SPI_Transmit(&ST7789_SPI_PORT, data, sizeof(data), HAL_MAX_DELAY);
+		}
 	#endif
 	ST7789_UnSelect();
 }
 
+/**
+ * @brief Fill the DisplayWindow with single color
+ * @param color -> color to Fill with
+ * @return none
+ */
+void ST7789_Fill_Color(uint16_t color)
+{
+	ST7789_FillArea(0, 0, ST7789_WIDTH - 1, ST7789_HEIGHT - 1, color);
+}
+
+/**
+ * @brief Fill a band of full width rows with a color, so that clearing the
+ *        screen can be split into several shorter pieces of work
+ * @param ySta&yEnd -> first and last rows to fill
+ * @param color -> color to fill with
+ * @return none
+ */
+void ST7789_Fill_Rows(uint16_t ySta, uint16_t yEnd, uint16_t color)
+{
+	if ((yEnd >= ST7789_HEIGHT) || (ySta > yEnd))	return;
+	ST7789_FillArea(0, ySta, ST7789_WIDTH - 1, yEnd, color);
+}
+
 /**
  * @brief Draw a Pixel
  * @param x&y -> coordinate to Draw
@@ -256,15 +417,8 @@ void ST7789_Fill(uint16_t xSta, uint16_t ySta, uint16_t xEnd, uint16_t yEnd, uin
 {
 	if ((xEnd < 0) || (xEnd >= ST7789_WIDTH) ||
 		 (yEnd < 0) || (yEnd >= ST7789_HEIGHT))	return;
-	ST7789_Select();
-	uint16_t i, j;
-	ST7789_SetAddressWindow(xSta, ySta, xEnd, yEnd);
-	for (i = ySta; i <= yEnd; i++)
-		for (j = xSta; j <= xEnd; j++) {
-			uint8_t data[] = {color >> 8, color & 0xFF};
-			ST7789_WriteData(data, sizeof(data));
-		}
-	ST7789_UnSelect();
+	if ((xSta > xEnd) || (ySta > yEnd))	return;
+	ST7789_FillArea(xSta, ySta, xEnd, yEnd, color);
 }
 
 /**
@@ -426,6 +580,47 @@ void ST7789_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint
 	ST7789_UnSelect();
 }
 
+/**
+ * @brief Draw a one pixel wide column in the background color with a span of it
+ *        in another color, setting the address window once for the whole column
+ * @param x&y -> coordinate of the top of the column
+ * @param h -> height of the column, at most ST7789_WIDTH * HOR_LEN when using DMA
+ * @param spanTop&spanBottom -> first and last rows of the span, relative to y
+ * @param color -> color of the span
+ * @param bgcolor -> color of the rest of the column
+ * @return none
+ */
+void ST7789_DrawColumn(uint16_t x, uint16_t y, uint16_t h, uint16_t spanTop, uint16_t spanBottom, uint16_t color, uint16_t bgcolor)
+{
+	uint16_t i;
+
+	if ((x >= ST7789_WIDTH) || (h == 0) || ((y + h - 1) >= ST7789_HEIGHT))
+		return;
+	#ifdef USE_DMA
+		if (h > ST7789_WIDTH * HOR_LEN)
+			return;
+	#endif
+
+	ST7789_SetAddressWindow(x, y, x, y + h - 1);
+	ST7789_Select();
+	ST7789_DC_Set();
+	#ifdef USE_DMA
+		/* The window has been set so disp_buf is no longer being sent */
+		for (i = 0; i < h; i++) {
+			uint16_t pixel = (i >= spanTop && i <= spanBottom) ? color : bgcolor;
+			disp_buf[i] = (pixel >> 8) | (pixel << 8);
+		}
+		ST7789_WriteData((uint8_t *)disp_buf, h * sizeof(disp_buf[0]));
+	#else
+		for (i = 0; i < h; i++) {
+			uint16_t pixel = (i >= spanTop && i <= spanBottom) ? color : bgcolor;
+			uint8_t data[] = {pixel >> 8, pixel & 0xFF};
+			HAL_SPI_Transmit(&ST7789_SPI_PORT, data, sizeof(data), HAL_MAX_DELAY);
+		}
+	#endif
+	ST7789_UnSelect();
+}
+
 /**
  * @brief Invert Fullscreen color
  * @param invert -> Whether to invert
@@ -438,6 +633,416 @@ void ST7789_InvertColors(uint8_t invert)
 	ST7789_UnSelect();
 }
 
+#ifdef USE_DMA
+/* Glyphs are expanded into disp_buf unless the per-pixel path is selected for comparison */
+static uint8_t glyph_blit = 1;
+#endif
+
+/**
+ * @brief Choose how text is drawn, so the two can be timed against each other
+ * @param enable -> 1 to expand whole glyph rows into disp_buf and send them by DMA,
+ *                  0 to send each pixel on its own as before
+ * @return none
+ */
+void ST7789_SetGlyphBlit(uint8_t enable)
+{
+	#ifdef USE_DMA
+		glyph_blit = enable;
+	#endif
+}
+
+/**
+ * @brief Write a run of chars on one line, one pixel at a time
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write
+ * @param len -> number of chars
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return  none
+ */
+static void ST7789_WriteGlyphPixels(uint16_t x, uint16_t y, const char *str, uint16_t len, FontDef font, uint16_t color, uint16_t bgcolor)
+{
+	uint32_t i, b, j;
+	uint16_t c;
+
+	for (c = 0; c < len; c++) {
+		ST7789_SetAddressWindow(x + c * font.width, y, x + (c + 1) * font.width - 1, y + font.height - 1);
+		for (i = 0; i < font.height; i++) {
+			b = font.data[(str[c] - 32) * font.height + i];
+			for (j = 0; j < font.width; j++) {
+				if ((b << j) & 0x8000) {
+					uint8_t data[] = {color >> 8, color & 0xFF};
+					ST7789_WriteData(data, sizeof(data));
+				}
+				else {
+					uint8_t data[] = {bgcolor >> 8, bgcolor & 0xFF};
+					ST7789_WriteData(data, sizeof(data));
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Work out the colors of the four levels of an anti-aliased font, blending
+ *        from the background color to the text color
+ * @param palette -> where to put the colors, high byte first
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return none
+ */
+static void ST7789_AAPalette(uint16_t *palette, uint16_t color, uint16_t bgcolor)
+{
+	uint8_t level;
+
+	for (level = 0; level < 4; level++) {
+		uint16_t r = ((bgcolor >> 11) * (3 - level) + (color >> 11) * level) / 3;
+		uint16_t g = (((bgcolor >> 5) & 0x3F) * (3 - level) + ((color >> 5) & 0x3F) * level) / 3;
+		uint16_t b = ((bgcolor & 0x1F) * (3 - level) + (color & 0x1F) * level) / 3;
+		uint16_t c = (r << 11) | (g << 5) | b;
+		palette[level] = (c >> 8) | (c << 8);
+	}
+}
+
+/**
+ * @brief Set aa_glyphs to the start of each glyph of a run of chars
+ * @param str -> chars of the run
+ * @param len -> number of chars, at most AA_MAX_CHARS
+ * @param font -> fontstyle of the chars
+ * @return none
+ */
+static void ST7789_StartAAGlyphs(const char *str, uint16_t len, const AAFontDef *font)
+{
+	uint16_t c;
+
+	for (c = 0; c < len; c++) {
+		const uint8_t *data = font->data + font->offsets[str[c] - 32];
+		aa_glyphs[c].top = data[0];
+		aa_glyphs[c].bottom = data[0] + data[1];
+		aa_glyphs[c].next = data + 2;
+		aa_glyphs[c].high = 1;
+		aa_glyphs[c].run = 0;
+	}
+}
+
+/**
+ * @brief Decode rows of a run of anti-aliased glyphs into RGB565 pixels, a span
+ *        of pixels of one color at a time. Rows must be decoded in order.
+ * @param buf -> where to put the pixels, rows * len * font->width of them
+ * @param len -> number of chars, set up by ST7789_StartAAGlyphs
+ * @param font -> fontstyle of the chars
+ * @param palette -> colors of the levels, from ST7789_AAPalette
+ * @param row&rows -> first row of the glyphs and number of rows
+ * @return none
+ */
+static void ST7789_RasteriseAAGlyphs(uint16_t *buf, uint16_t len, const AAFontDef *font, const uint16_t *palette, uint16_t row, uint16_t rows)
+{
+	uint16_t r, c, j, span;
+
+	for (r = row; r < row + rows; r++) {
+		for (c = 0; c < len; c++) {
+			AAGlyphState *glyph = &aa_glyphs[c];
+			if (r < glyph->top || r >= glyph->bottom) {
+				for (j = 0; j < font->width; j++) {
+					*buf++ = palette[0];
+				}
+				continue;
+			}
+			for (j = 0; j < font->width; j += span) {
+				if (glyph->run == 0) {
+					uint8_t nibble = glyph->high ? *glyph->next >> 4 : *glyph->next++ & 0x0F;
+					glyph->high = !glyph->high;
+					glyph->level = nibble >> 2;
+					glyph->run = (nibble & 0x03) + 1;
+				}
+				span = font->width - j < glyph->run ? font->width - j : glyph->run;
+				glyph->run -= span;
+				uint16_t color = palette[glyph->level];
+				uint16_t *end = buf + span;
+				while (buf < end) {
+					*buf++ = color;
+				}
+			}
+		}
+	}
+}
+
+#ifdef USE_DMA
+/**
+ * @brief Expand rows of a run of glyphs from the 1bpp font into RGB565 pixels
+ * @param buf -> where to put the pixels, rows * len * font.width of them
+ * @param str -> chars of the run
+ * @param len -> number of chars
+ * @param font -> fontstyle of the chars
+ * @param fg&bg -> colors of the chars and background, high byte first
+ * @param row&rows -> first row of the glyphs and number of rows
+ * @return none
+ */
+static void ST7789_RasteriseGlyphs(uint16_t *buf, const char *str, uint16_t len, FontDef font, uint16_t fg, uint16_t bg, uint16_t row, uint16_t rows)
+{
+	uint16_t r, c, j;
+
+	for (r = row; r < row + rows; r++) {
+		for (c = 0; c < len; c++) {
+			uint16_t b = font.data[(str[c] - 32) * font.height + r];
+			for (j = 0; j < font.width; j++) {
+				*buf++ = (b & 0x8000) ? fg : bg;
+				b <<= 1;
+			}
+		}
+	}
+}
+#endif
+
+/**
+ * @brief Write a run of chars on one line. The 1bpp font rows are expanded into
+ *        RGB565 rows of the whole run in disp_buf, which are sent by DMA as many
+ *        rows at a time as fit, in one address window.
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write
+ * @param len -> number of chars, len * font.width must fit in ST7789_WIDTH
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return  none
+ */
+static void ST7789_WriteGlyphs(uint16_t x, uint16_t y, const char *str, uint16_t len, FontDef font, uint16_t color, uint16_t bgcolor)
+{
+	if (len == 0)	return;
+
+	#ifdef USE_DMA
+		if (glyph_blit) {
+			uint16_t run_width = len * font.width;
+			uint16_t chunk_rows = (ST7789_WIDTH * HOR_LEN) / run_width;
+			/* disp_buf is sent a byte at a time, so the colors are stored high byte first */
+			uint16_t fg = (color >> 8) | (color << 8);
+			uint16_t bg = (bgcolor >> 8) | (bgcolor << 8);
+			uint16_t row, rows;
+
+			ST7789_SetAddressWindow(x, y, x + run_width - 1, y + font.height - 1);
+			for (row = 0; row < font.height; row += rows) {
+				rows = font.height - row < chunk_rows ? font.height - row : chunk_rows;
+				ST7789_RasteriseGlyphs(disp_buf, str, len, font, fg, bg, row, rows);
+				ST7789_WriteData((uint8_t *)disp_buf, rows * run_width * sizeof(disp_buf[0]));
+			}
+			return;
+		}
+	#endif
+	ST7789_WriteGlyphPixels(x, y, str, len, font, color, bgcolor);
+}
+
+#ifdef USE_DMA
+/**
+ * @brief Start sending the next band of an async write if it's ready and the
+ *        SPI port is free. Called from the DMA interrupt as well as from
+ *        ST7789_ProcessAsync, so it runs with interrupts disabled.
+ * @return none
+ */
+static void ST7789_SendBand(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	if (!async.sending && async.ready[async.send_band]) {
+		async.sending = 1;
+		HAL_SPI_Transmit_DMA(&ST7789_SPI_PORT, (uint8_t *)bands[async.send_band], async.band_size[async.send_band]);
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * @brief Set the function called (from an interrupt) when an async write needs
+ *        ST7789_ProcessAsync to carry on, or has finished
+ * @param callback -> function to call, or NULL
+ * @return none
+ */
+void ST7789_SetAsyncCallback(void (*callback)(void))
+{
+	async_callback = callback;
+}
+
+/**
+ * @brief Whether an async write is still being sent
+ * @return 1 if the panel is busy
+ */
+uint8_t ST7789_AsyncBusy(void)
+{
+	return async.active;
+}
+
+/**
+ * @brief Rasterise the next band of an async write into whichever buffer is
+ *        free, so it is ready to go when the band being sent finishes
+ * @return none
+ */
+void ST7789_ProcessAsync(void)
+{
+	if (!async.active)	return;
+
+	FontDef font = {async.font_width, async.font_height, async.font_data};
+	while (async.next_row < font.height && !async.ready[async.raster_band]) {
+		uint8_t band = async.raster_band;
+		uint16_t rows = font.height - async.next_row;
+		if (rows > async.chunk_rows) {
+			rows = async.chunk_rows;
+		}
+		if (async.aa_font) {
+			ST7789_RasteriseAAGlyphs(bands[band], async.len, async.aa_font, async.palette, async.next_row, rows);
+		}
+		else {
+			ST7789_RasteriseGlyphs(bands[band], async.str, async.len, font, async.fg, async.bg, async.next_row, rows);
+		}
+		async.band_size[band] = rows * async.len * font.width * sizeof(bands[0][0]);
+		async.next_row += rows;
+		async.raster_band = !band;
+		async.ready[band] = 1;
+		ST7789_SendBand();
+	}
+}
+
+/**
+ * @brief Wait for an async write to finish, doing its rasterising meanwhile
+ * @return none
+ */
+static void ST7789_WaitAsync(void)
+{
+	while (async.active) {
+		ST7789_ProcessAsync();
+	}
+}
+
+/**
+ * @brief Start an async write once its font has been set up in async
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write
+ * @param len -> number of chars, at most ASYNC_MAX_CHARS and fitting on the line
+ * @return none
+ */
+static void ST7789_StartAsync(uint16_t x, uint16_t y, const char *str, uint16_t len)
+{
+	ST7789_SetAddressWindow(x, y, x + len * async.font_width - 1, y + async.font_height - 1);
+	memcpy(async.str, str, len);
+	async.len = len;
+	async.chunk_rows = (ST7789_WIDTH * HOR_LEN) / (len * async.font_width);
+	async.next_row = 0;
+	async.raster_band = 0;
+	async.send_band = 0;
+	async.sending = 0;
+	async.ready[0] = 0;
+	async.ready[1] = 0;
+	async.active = 1;
+	ST7789_Select();
+	ST7789_DC_Set();
+	ST7789_ProcessAsync();
+}
+
+/**
+ * @brief Start an anti-aliased async write
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write
+ * @param len -> number of chars, at most AA_MAX_CHARS and ASYNC_MAX_CHARS and fitting on the line
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return none
+ */
+static void ST7789_StartAAAsync(uint16_t x, uint16_t y, const char *str, uint16_t len, const AAFontDef *font, uint16_t color, uint16_t bgcolor)
+{
+	async.aa_font = font;
+	async.font_data = NULL;
+	async.font_width = font->width;
+	async.font_height = font->height;
+	ST7789_AAPalette(async.palette, color, bgcolor);
+	ST7789_StartAAGlyphs(str, len, font);
+	ST7789_StartAsync(x, y, str, len);
+}
+
+/**
+ * @brief Called by the HAL when a DMA transfer to the panel has finished. Sends
+ *        the next band of an async write if it is ready, or finishes the write.
+ * @param hspi -> SPI port the transfer was on
+ * @return none
+ */
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	if (hspi != &ST7789_SPI_PORT || !async.active)	return;
+
+	async.ready[async.send_band] = 0;
+	async.send_band = !async.send_band;
+	async.sending = 0;
+	ST7789_SendBand();
+	if (!async.sending && async.next_row >= async.font_height) {
+		ST7789_UnSelect();
+		async.active = 0;
+	}
+	if (async_callback) {
+		async_callback();
+	}
+}
+#else
+void ST7789_SetAsyncCallback(void (*callback)(void)) {}
+uint8_t ST7789_AsyncBusy(void) { return 0; }
+void ST7789_ProcessAsync(void) {}
+#endif
+
+/**
+ * @brief Start writing a run of chars on one line without waiting for the panel.
+ *        The first bands are rasterised here, the rest by ST7789_ProcessAsync
+ *        while the earlier ones are sent.
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write (copied), needn't be null terminated
+ * @param len -> number of chars, the run must fit on the line
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return 1 if the write was started or done, 0 if the panel is busy with another
+ */
+uint8_t ST7789_WriteCharsAsync(uint16_t x, uint16_t y, const char *str, uint16_t len, FontDef font, uint16_t color, uint16_t bgcolor)
+{
+	#ifdef USE_DMA
+		if (async.active)	return 0;
+		if (glyph_blit && len > 0 && len <= ASYNC_MAX_CHARS &&
+			x + len * font.width <= ST7789_WIDTH && y + font.height <= ST7789_HEIGHT) {
+			async.aa_font = NULL;
+			async.font_data = font.data;
+			async.font_width = font.width;
+			async.font_height = font.height;
+			async.fg = (color >> 8) | (color << 8);
+			async.bg = (bgcolor >> 8) | (bgcolor << 8);
+			ST7789_StartAsync(x, y, str, len);
+			return 1;
+		}
+	#endif
+	ST7789_WriteChars(x, y, str, len, font, color, bgcolor);
+	return 1;
+}
+
+/**
+ * @brief Start writing a run of chars in an anti-aliased font without waiting
+ *        for the panel, as ST7789_WriteCharsAsync. The glyphs are decoded
+ *        straight into the bands as they are sent.
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write (copied), needn't be null terminated
+ * @param len -> number of chars, the run must fit on the line
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return 1 if the write was started or done, 0 if the panel is busy with another
+ */
+uint8_t ST7789_WriteCharsAAAsync(uint16_t x, uint16_t y, const char *str, uint16_t len, const AAFontDef *font, uint16_t color, uint16_t bgcolor)
+{
+	#ifdef USE_DMA
+		if (async.active)	return 0;
+		if (len > 0 && len <= ASYNC_MAX_CHARS && len <= AA_MAX_CHARS &&
+			x + len * font->width <= ST7789_WIDTH && y + font->height <= ST7789_HEIGHT) {
+			ST7789_StartAAAsync(x, y, str, len, font, color, bgcolor);
+			return 1;
+		}
+	#endif
+	ST7789_WriteCharsAA(x, y, str, len, font, color, bgcolor);
+	return 1;
+}
+
 /** 
  * @brief Write a char
  * @param  x&y -> cursor of the start point.
@@ -449,28 +1054,78 @@ void ST7789_InvertColors(uint8_t invert)
  */
 void ST7789_WriteChar(uint16_t x, uint16_t y, char ch, FontDef font, uint16_t color, uint16_t bgcolor)
 {
-	uint32_t i, b, j;
+	PROFILE_BEGIN(PROFILE_WRITE_CHAR);
 	ST7789_Select();
-	ST7789_SetAddressWindow(x, y, x + font.width - 1, y + font.height - 1);
-
-	for (i = 0; i < font.height; i++) {
-		b = font.data[(ch - 32) * font.height + i];
-		for (j = 0; j < font.width; j++) {
-			if ((b << j) & 0x8000) {
-				uint8_t data[] = {color >> 8, color & 0xFF};
-				ST7789_WriteData(data, sizeof(data));
-			}
-			else {
-				uint8_t data[] = {bgcolor >> 8, bgcolor & 0xFF};
-				ST7789_WriteData(data, sizeof(data));
+	ST7789_WriteGlyphs(x, y, &ch, 1, font, color, bgcolor);
+	ST7789_UnSelect();
+	PROFILE_END(PROFILE_WRITE_CHAR);
+}
+
+/** 
+ * @brief Write a run of chars on one line
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write, needn't be null terminated
+ * @param len -> number of chars, the run must fit on the line
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return  none
+ */
+void ST7789_WriteChars(uint16_t x, uint16_t y, const char *str, uint16_t len, FontDef font, uint16_t color, uint16_t bgcolor)
+{
+	if (x + len * font.width > ST7789_WIDTH || y + font.height > ST7789_HEIGHT)	return;
+	PROFILE_BEGIN(PROFILE_WRITE_CHAR);
+	ST7789_Select();
+	ST7789_WriteGlyphs(x, y, str, len, font, color, bgcolor);
+	ST7789_UnSelect();
+	PROFILE_END(PROFILE_WRITE_CHAR);
+}
+
+/**
+ * @brief Write a run of chars on one line in an anti-aliased font. Runs longer
+ *        than AA_MAX_CHARS are written in pieces.
+ * @param  x&y -> cursor of the start point.
+ * @param str -> chars to write, needn't be null terminated
+ * @param len -> number of chars, the run must fit on the line
+ * @param font -> fontstyle of the chars
+ * @param color -> color of the chars
+ * @param bgcolor -> background color of the chars
+ * @return  none
+ */
+void ST7789_WriteCharsAA(uint16_t x, uint16_t y, const char *str, uint16_t len, const AAFontDef *font, uint16_t color, uint16_t bgcolor)
+{
+	if (x + len * font->width > ST7789_WIDTH || y + font->height > ST7789_HEIGHT)	return;
+	PROFILE_BEGIN(PROFILE_WRITE_CHAR);
+	while (len > 0) {
+		uint16_t run = len < AA_MAX_CHARS ? len : AA_MAX_CHARS;
+		#ifdef USE_DMA
+			ST7789_WaitAsync();
+			ST7789_StartAAAsync(x, y, str, run, font, color, bgcolor);
+			ST7789_WaitAsync();
+		#else
+			uint16_t palette[4];
+			uint16_t line[ST7789_WIDTH];
+			uint16_t row;
+
+			ST7789_AAPalette(palette, color, bgcolor);
+			ST7789_StartAAGlyphs(str, run, font);
+			ST7789_Select();
+			ST7789_SetAddressWindow(x, y, x + run * font->width - 1, y + font->height - 1);
+			for (row = 0; row < font->height; row++) {
+				ST7789_RasteriseAAGlyphs(line, run, font, palette, row, 1);
+				ST7789_WriteData((uint8_t *)line, run * font->width * sizeof(line[0]));
 			}
-		}
+			ST7789_UnSelect();
+		#endif
+		x += run * font->width;
+		str += run;
+		len -= run;
 	}
-	ST7789_UnSelect();
+	PROFILE_END(PROFILE_WRITE_CHAR);
 }
 
 /** 
- * @brief Write a string 
+ * @brief Write a string, each line of it as one run of glyphs
  * @param  x&y -> cursor of the start point.
  * @param str -> string to write
  * @param font -> fontstyle of the string
@@ -480,26 +1135,35 @@ void ST7789_WriteChar(uint16_t x, uint16_t y, char ch, FontDef font, uint16_t co
  */
 void ST7789_WriteString(uint16_t x, uint16_t y, const char *str, FontDef font, uint16_t color, uint16_t bgcolor)
 {
+	PROFILE_BEGIN(PROFILE_WRITE_CHAR);
+	const char *run = str;
+	uint16_t run_x = x;
+
 	ST7789_Select();
 	while (*str) {
 		if (x + font.width >= ST7789_WIDTH) {
+			ST7789_WriteGlyphs(run_x, y, run, str - run, font, color, bgcolor);
 			x = 0;
 			y += font.height;
 			if (y + font.height >= ST7789_HEIGHT) {
+				run = str;
 				break;
 			}
 
 			if (*str == ' ') {
 				// skip spaces in the beginning of the new line
 				str++;
-				continue;
 			}
+			run = str;
+			run_x = x;
+			continue;
 		}
-		ST7789_WriteChar(x, y, *str, font, color, bgcolor);
 		x += font.width;
 		str++;
 	}
+	ST7789_WriteGlyphs(run_x, y, run, str - run, font, color, bgcolor);
 	ST7789_UnSelect();
+	PROFILE_END(PROFILE_WRITE_CHAR);
 }
 
 /** 
@@ -511,9 +1175,6 @@ void ST7789_WriteString(uint16_t x, uint16_t y, const char *str, FontDef font, u
  */
 void ST7789_DrawFilledRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color)
 {
-	ST7789_Select();
-	uint8_t i;
-
 	/* Check input parameters */
 	if (x >= ST7789_WIDTH ||
 		y >= ST7789_HEIGHT) {
@@ -521,20 +1182,15 @@ void ST7789_DrawFilledRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
 		return;
 	}
 
-	/* Check width and height */
+	/* Check width and height, the rectangle includes x + w and y + h */
 	if ((x + w) >= ST7789_WIDTH) {
-		w = ST7789_WIDTH - x;
+		w = ST7789_WIDTH - 1 - x;
 	}
 	if ((y + h) >= ST7789_HEIGHT) {
-		h = ST7789_HEIGHT - y;
+		h = ST7789_HEIGHT - 1 - y;
 	}
 
-	/* Draw lines */
-	for (i = 0; i <= h; i++) {
-		/* Draw lines */
-		ST7789_DrawLine(x, y + i, x + w, y + i, color);
-	}
-	ST7789_UnSelect();
+	ST7789_FillArea(x, y, x + w, y + h, color);
 }
 
 /** 
@@ -239,6 +239,7 @@ extern SPI_HandleTypeDef ST7789_SPI_PORT;
 void ST7789_Init(void);
 void ST7789_SetRotation(uint8_t m);
 void ST7789_Fill_Color(uint16_t color);
+void ST7789_Fill_Rows(uint16_t ySta, uint16_t yEnd, uint16_t color);
 void ST7789_DrawPixel(uint16_t x, uint16_t y, uint16_t color);
 void ST7789_Fill(uint16_t xSta, uint16_t ySta, uint16_t xEnd, uint16_t yEnd, uint16_t color);
 void ST7789_DrawPixel_4px(uint16_t x, uint16_t y, uint16_t color);
@@ -248,11 +249,20 @@ void ST7789_DrawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_
 void ST7789_DrawRectangle(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t color);
 void ST7789_DrawCircle(uint16_t x0, uint16_t y0, uint8_t r, uint16_t color);
 void ST7789_DrawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *data);
+void ST7789_DrawColumn(uint16_t x, uint16_t y, uint16_t h, uint16_t spanTop, uint16_t spanBottom, uint16_t color, uint16_t bgcolor);
 void ST7789_InvertColors(uint8_t invert);
 
 /* Text functions. */
 void ST7789_WriteChar(uint16_t x, uint16_t y, char ch, FontDef font, uint16_t color, uint16_t bgcolor);
 void ST7789_WriteString(uint16_t x, uint16_t y, const char *str, FontDef font, uint16_t color, uint16_t bgcolor);
+void ST7789_WriteChars(uint16_t x, uint16_t y, const char *str, uint16_t len, FontDef font, uint16_t color, uint16_t bgcolor);
+void ST7789_SetGlyphBlit(uint8_t enable);
+uint8_t ST7789_WriteCharsAsync(uint16_t x, uint16_t y, const char *str, uint16_t len, FontDef font, uint16_t color, uint16_t bgcolor);
+void ST7789_WriteCharsAA(uint16_t x, uint16_t y, const char *str, uint16_t len, const AAFontDef *font, uint16_t color, uint16_t bgcolor);
+uint8_t ST7789_WriteCharsAAAsync(uint16_t x, uint16_t y, const char *str, uint16_t len, const AAFontDef *font, uint16_t color, uint16_t bgcolor);
+void ST7789_ProcessAsync(void);
+uint8_t ST7789_AsyncBusy(void);
+void ST7789_SetAsyncCallback(void (*callback)(void));
 
 /* Extented Graphical functions. */
 void ST7789_DrawFilledRectangle(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t color);
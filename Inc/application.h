@@ -4,6 +4,8 @@
 #include "stdbool.h"
 #include "stm32f4xx_hal.h"
 #include "audioTypes.h"
+#include "scheduler.h"
+#include "stats.h"
 
 #define STRINGIZE_DETAIL_(v) #v
 #define STRINGIZE(v) STRINGIZE_DETAIL_(v)
@@ -11,6 +13,8 @@
 void appInit(I2S_HandleTypeDef *i2sMicH, I2S_HandleTypeDef *i2sDACH, SPI_HandleTypeDef *spiFlashH, TIM_HandleTypeDef *stepTimerH, TIM_HandleTypeDef *encTimerH, TIM_HandleTypeDef *inputTimerH);
 void appLoop(void);
 void appToggleLED(void);
+bool appInputPending(void);
+int16_t appTakeInput(bool *buttonPressedOut);
 uint16_t appFlashReadDeviceId(void);
 void appRecordAudio(void);
 void appPlayAudio(void);
@@ -35,9 +39,28 @@ void appSetSequenceStepChannelParams(uint8_t stepIdx, uint8_t channelIdx, Channe
 ChannelParams_T appGetSequenceStepChannelParams(uint8_t stepIdx, uint8_t channelIdx);
 void appToggleClipPlay(void);
 void appToggleSequencePlay(void);
+bool appGetSequencePlaying(void);
+uint8_t appGetPlayedStepIdx(void);
 void appSetSequenceNum(uint8_t sequenceNum);
 uint8_t appGetSequenceNum(void);
-void appStoreSequence(void);
+bool appStoreSequence(void);
 void appLoadSequence(void);
 bool appGetSequenceUsed(void);
+void appSetSequenceLength(uint8_t length);
+uint8_t appGetSequenceLength(void);
+bool appSetSong(const uint8_t *sequenceNums, uint8_t length);
+bool appStartSong(void);
+void appToggleSongPlay(void);
+bool appRecordStep(uint8_t channelIdx, uint8_t fields, bool hit, ChannelParams_T params);
+uint16_t appGetDutyCycle(void);
+const SchedulerHandlerStats_T * appGetHandlerStats(uint8_t handlerIdx);
+void appResetHandlerStats(void);
+uint32_t appGetHandlerDeadline(uint8_t handlerIdx);
+uint32_t appGetHandlerDeadlineMisses(uint8_t handlerIdx);
+uint32_t appGetAudioMixWCET(void);
+uint32_t appGetAudioMixUnderruns(void);
+void appResetAudioMixStats(void);
+void appTraceDump(void);
+void appGetAndClearStats(HealthStats_T *stats);
+void appStartTransfer(void);
 #endif
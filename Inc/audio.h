@@ -6,6 +6,33 @@
 #include "audioTypes.h"
 #include "ui_values.h"
 
+// Each half of the I2S DMA buffers holds 64 samples, 4 ms of audio at 16 kHz. After the DMA
+// signals a half is done, audioProcessData must refill it before the DMA comes back round to it.
+#define AUDIO_REFILL_DEADLINE_US 4000
+
+// Uncomment to mix channels played from flash in the PendSV interrupt as soon as the DAC DMA has
+// finished with half of its buffer, instead of in the main loop. The mix only reads from per channel
+// RAM buffers which the main loop keeps topped up from flash, so the time spent in the interrupt
+// is bounded and blocking work in the main loop can delay prefetching without causing underruns.
+// Tools/mix_wcet.py measures the worst case time of the mix on the board with all three channels
+// playing (the "mixwcet" command), it hasn't been measured yet.
+//#define AUDIO_REFILL_IN_ISR
+
+// The waveform view shows the lowest and highest sample of channel 0 in each column of
+// AUDIO_PEAK_SAMPLES samples of the clip, so a whole clip is AUDIO_PEAK_COLUMNS columns wide.
+#define AUDIO_PEAK_SAMPLES 67
+#define AUDIO_PEAK_COLUMNS ((CLIP_SAMPLES + AUDIO_PEAK_SAMPLES - 1) / AUDIO_PEAK_SAMPLES)
+
+typedef struct {
+  uint8_t column;
+  int16_t min;
+  int16_t max;
+} AudioPeak_T;
+
+// The overview stored with each clip has the same columns as the waveform view at level 0, and
+// each level above has columns of twice as many samples, up to a single column
+#define AUDIO_OVERVIEW_MAX_LEVEL 8
+
 void audioInit(I2S_HandleTypeDef *i2sMicH, I2S_HandleTypeDef *i2sDACH, uiChangeCallback _uiChangeCB);
 void audioProcessData(void);
 void audioRecord(void);
@@ -26,5 +53,12 @@ void audioSetChannelRunning(uint8_t channelIdx, bool runningState);
 bool getAudioRunning(void);
 bool audioClipUsed(uint8_t audioClipNum);
 void audioSetClipUsed(uint8_t audioClipNum);
+void audioFinishClip(uint8_t audioClipNum);
+uint8_t audioReadOverview(uint8_t audioClipNum, uint8_t level, int8_t *peaks);
+void audioMixISR(void);
+uint32_t audioGetMixWCET(void);
+uint32_t audioGetMixUnderruns(void);
+void audioResetMixStats(void);
+bool audioGetPeak(AudioPeak_T *peakOut);
 
 #endif
@@ -8,7 +8,8 @@
 #define CLIP_SAMPLES    16000 // 1 second of audio at 16 kHz sample rate (16000 half word samples == 31KiB)
 #define MAX_SAMPLE_IDX CLIP_SAMPLES-1
 // The flash chip can store 128 x 32KiB blocks
-// Each audio clip consumes one block. 768 bytes (3 pages) of each block is not used for audio data.
+// Each audio clip consumes one block. The last 768 bytes (3 pages) of each block hold the used flag
+// and an overview of the clip (see audio.c) rather than audio data.
 // 1 block = 32768 bytes (128 pages). 1 clip = 32000 bytes (125 pages).
 // Limit the number of clips to 100 to allow the rest of the flash to be used for sequences.
 #define NUM_CLIPS 100
@@ -20,6 +20,7 @@
 // Salled from higher up areas of the code (main)
 void ConsoleInit(void);
 void ConsoleProcess(void); // call this in a loop
+void ConsoleExecuteLine(char line[], uint32_t length); // runs a line as if it was received
 
 // called from lower down areas of the code (consoleCommands)
 typedef enum {
@@ -35,6 +36,7 @@ typedef enum {
 // The HexUint16 functions implement the parsing themselves, eschewing atoi and itoa.
 eCommandResult_T ConsoleParamFindN(const char * buffer, const uint8_t parameterNumber, uint32_t *startLocation);
 eCommandResult_T ConsoleReceiveParamInt16(const char * buffer, const uint8_t parameterNumber, int16_t* parameterInt16);
+eCommandResult_T ConsoleReceiveParamUInt32(const char * buffer, const uint8_t parameterNumber, uint32_t* parameterUInt32);
 eCommandResult_T ConsoleSendParamInt16(int16_t parameterInt);
 eCommandResult_T ConsoleSendParamInt32(int32_t parameterInt);
 eCommandResult_T ConsoleSendParamUInt32(uint32_t parameterInt);
@@ -8,7 +8,6 @@
 #include <stdint.h>
 #include "console.h"
 
-#define CONSOLE_COMMAND_MAX_COMMAND_LENGTH 10   // command only
 #define CONSOLE_COMMAND_MAX_LENGTH 256        // whole command with argument
 #define CONSOLE_COMMAND_MAX_HELP_LENGTH 64      // if this is zero, there will be no  help (XXXOPT: RAM reduction)
 
@@ -4,12 +4,21 @@
 #define CONSOLE_IO_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef enum {CONSOLE_SUCCESS = 0u, CONSOLE_ERROR = 1u } eConsoleError;
 
 eConsoleError ConsoleIoInit(void);
 
 eConsoleError ConsoleIoReceive(uint8_t *buffer, const uint32_t bufferLength, uint32_t *readLength);
+eConsoleError ConsoleIoReceiveData(uint8_t *buffer, const uint32_t bufferLength, uint32_t *readLength); // raw bytes, not echoed
 eConsoleError ConsoleIoSendString(const char *buffer); // must be null terminated
+eConsoleError ConsoleIoSendData(const uint8_t *buffer, const uint32_t length); // raw bytes, may include nulls
+
+bool ConsoleIoBaudRateSupported(uint32_t baudRate);
+eConsoleError ConsoleIoSetBaudRate(uint32_t baudRate);
+bool ConsoleIoConfirmBaudRate(void);
+uint32_t ConsoleIoGetBaudRate(void);
+void ConsoleIoTick(void);
 
 #endif // CONSOLE_IO_H
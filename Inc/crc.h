@@ -0,0 +1,12 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+
+// CRC-16/CCITT (polynomial 0x1021). Start a new CRC with CRC16_INIT and feed data through
+// crc16Update in as many pieces as needed.
+#define CRC16_INIT 0xFFFF
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, uint16_t length);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include "stm32f4xx_hal.h"
+
+// Cycle counter used for timing code. The DWT cycle counter counts core clock cycles
+// (96 MHz) so it wraps roughly every 44 seconds. Differences between two readings are
+// correct across a wrap as long as they are taken less than 44 seconds apart.
+
+#define CYCLES_PER_US (SystemCoreClock / 1000000)
+
+static inline void cyclesInit(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+static inline uint32_t cyclesNow(void)
+{
+  return DWT->CYCCNT;
+}
+
+#endif
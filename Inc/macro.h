@@ -0,0 +1,36 @@
+#ifndef MACRO_H
+#define MACRO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Console macros: named lists of console lines stored in flash and replayed on the device
+// (see macro.c)
+#define NUM_MACROS 16
+// A spare sector lets a macro be recorded again without erasing the old one first
+#define NUM_MACRO_SECTORS (NUM_MACROS + 1)
+#define MACRO_NAME_MAX_LENGTH 15
+#define MACRO_MAX_ARGS 4
+
+typedef enum {
+  MACRO_OK          = 0u,
+  MACRO_BAD_NAME    = 1u,
+  MACRO_NOT_FOUND   = 2u,
+  MACRO_NO_SPACE    = 3u,
+  MACRO_BUSY        = 4u
+} eMacroResult_T;
+
+eMacroResult_T macroRecordStart(const char *name);
+eMacroResult_T macroRecordEnd(void);
+bool macroRecording(void);
+bool macroRecordLine(const char *line, uint32_t length);
+eMacroResult_T macroRun(const char *name, const char *args);
+void macroStop(void);
+bool macroRunning(void);
+eMacroResult_T macroDelete(const char *name);
+bool macroGetInfo(uint8_t macroIdx, char *name, uint16_t *length);
+eMacroResult_T macroShow(const char *name);
+void macroProcess(void);
+void macroTick(void);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+// Uncomment to time the zones below with the DWT cycle counter. When this isn't defined the
+// PROFILE_BEGIN and PROFILE_END macros are empty and no RAM is used for the zone table.
+//#define PROFILE_ENABLED
+
+typedef enum {
+  PROFILE_AUDIO_PROCESS     = 0u,
+  PROFILE_FLASH_READ        = 1u,
+  PROFILE_STEP              = 2u,
+  PROFILE_UI_UPDATE         = 3u,
+  PROFILE_WRITE_CHAR        = 4u,
+  PROFILE_CONSOLE_PROCESS   = 5u,
+  NUM_PROFILE_ZONES         = 6u
+} eProfileZone_T;
+
+// Zone timings are bucketed by the log2 of the number of cycles taken
+#define PROFILE_NUM_BUCKETS 32
+
+typedef struct {
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t buckets[PROFILE_NUM_BUCKETS];
+} ProfileZone_T;
+
+#ifdef PROFILE_ENABLED
+#include "cycles.h"
+
+// PROFILE_BEGIN and PROFILE_END must be used in the same block, END once on each path out of it.
+// Zones can be nested but profiling isn't safe to use from interrupt handlers.
+#define PROFILE_BEGIN(zone) uint32_t profileStart_##zone = cyclesNow()
+#define PROFILE_END(zone) profileRecord(zone, cyclesNow() - profileStart_##zone)
+
+void profileRecord(eProfileZone_T zone, uint32_t cycles);
+const char * profileGetZoneName(eProfileZone_T zone);
+const ProfileZone_T * profileGetZone(eProfileZone_T zone);
+void profileReset(void);
+#else
+#define PROFILE_BEGIN(zone)
+#define PROFILE_END(zone)
+#endif
+
+#endif
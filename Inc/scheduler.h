@@ -0,0 +1,52 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Events are posted by interrupt handlers (or by the handlers of other events) and the
+// handler registered for each event is run from the main loop. When more than one event
+// is pending the handlers run in the order below, lowest bit first.
+typedef enum {
+  EVENT_AUDIO     = 0x01,
+  EVENT_STEP      = 0x02,
+  EVENT_CONSOLE   = 0x04,
+  EVENT_UI        = 0x08,
+  EVENT_SEQUENCE  = 0x10,
+  EVENT_TRANSFER  = 0x20
+} eSchedulerEvent_T;
+
+#define NUM_SCHEDULER_EVENTS 6
+
+// Longest a handler should run before giving way to other handlers. Handlers that can take
+// longer than this should check schedulerShouldYield and split their work into pieces,
+// posting their own event again to carry on.
+#define SCHEDULER_TIME_SLICE_US 1000
+
+typedef void (*schedulerHandler)(void);
+
+typedef struct {
+  const char *name;
+  uint32_t runs;
+  // Cycles from the event first being posted to its handler starting
+  uint32_t maxLatency;
+  uint64_t totalLatency;
+  // Cycles spent in the handler
+  uint32_t maxRunTime;
+  uint64_t totalRunTime;
+} SchedulerHandlerStats_T;
+
+void schedulerInit(void);
+void schedulerRegister(eSchedulerEvent_T event, const char *name, schedulerHandler handler);
+void schedulerPost(uint32_t events);
+void schedulerRun(void);
+bool schedulerShouldYield(void);
+void schedulerYield(void);
+void schedulerSetDeadline(eSchedulerEvent_T event, uint32_t deadlineUs);
+uint32_t schedulerGetDeadline(uint8_t handlerIdx);
+uint32_t schedulerGetDeadlineMisses(uint8_t handlerIdx);
+uint16_t schedulerGetDutyCycle(void);
+const SchedulerHandlerStats_T * schedulerGetHandlerStats(uint8_t handlerIdx);
+void schedulerResetStats(void);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Text fields on the display that are only redrawn where they change (see screen.c)
+#define SCREEN_FIELD_MAX_CELLS 21
+
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint8_t numCells;
+  uint16_t color;
+  uint16_t bgColor;
+  // Bit per cell that has changed since the field was last drawn
+  uint32_t dirty;
+  char cells[SCREEN_FIELD_MAX_CELLS];
+} ScreenField_T;
+
+void screenFieldInit(ScreenField_T *field, uint16_t x, uint16_t y, uint8_t numCells, uint16_t bgColor);
+void screenFieldSet(ScreenField_T *field, const char *str, uint16_t color, uint16_t bgColor);
+void screenFieldInvalidate(ScreenField_T *field);
+bool screenFieldDirty(const ScreenField_T *field);
+bool screenFieldDraw(ScreenField_T *field);
+void screenSetAAFont(bool enable);
+
+#endif
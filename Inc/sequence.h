@@ -9,13 +9,32 @@
 // 3584 / 16 = 224).
 // But for now we will limit the number of sequences to 150 to allow space for future uses
 // of the remaining flash capacity.
+// Sequences are now stored as packed records, 3 to a sector, in the sectors following the
+// original 150 (see sequence.c). The original sectors are still read for sequences that
+// haven't been stored since.
 #define NUM_SEQUENCES 150
+// Steps are grouped into bars of NUM_STEPS steps. A sequence can be from 1 to MAX_NUM_STEPS
+// steps long (up to NUM_BARS bars).
 #define NUM_STEPS 16
-#define MAX_STEP_IDX NUM_STEPS-1
+#define MAX_NUM_STEPS 64
+#define NUM_BARS (MAX_NUM_STEPS / NUM_STEPS)
+#define MAX_STEP_IDX MAX_NUM_STEPS-1
+// Maximum number of sequences that can be chained together in a song
+#define MAX_SONG_LENGTH 16
+// Largest record produced by sequenceExport, a header and an entry with sample points for every
+// step of every channel (see sequence.c)
+#define SEQUENCE_RECORD_MAX_SIZE (8 + NUM_CHANNELS * MAX_NUM_STEPS * 6)
+// Step fields changed by a live record event
+#define RECORD_CLIP 0x01
+#define RECORD_START 0x02
+#define RECORD_END 0x04
 
 void sequenceInit(uiChangeCallback _uiChangeCB);
+void sequenceProcess(void);
 void sequenceSetNum(uint8_t sequenceNum);
 uint8_t sequenceGetNum(void);
+void sequenceSetLength(uint8_t length);
+uint8_t sequenceGetLength(void);
 ChannelParams_T getStepChannelParams(uint8_t channelIdx, uint8_t stepIdx);
 ChannelParams_T getCurrStepChannelParams(uint8_t channelIdx);
 void setStepChannelParams(uint8_t channelIdx, uint8_t stepIdx, ChannelParams_T channelParams);
@@ -24,8 +43,16 @@ void step();
 void sequenceStart(void);
 void sequenceStop(void);
 bool getSequencePlaying(void);
-void sequenceStore(void);
+bool sequenceStore(void);
 void sequenceLoad(void);
 bool getSequenceUsed(void);
+uint16_t sequenceExport(uint8_t sequenceNum, uint8_t *record);
+bool sequenceImport(uint8_t sequenceNum, const uint8_t *record, uint16_t size);
+bool songSet(const uint8_t *sequenceNums, uint8_t length);
+uint8_t songGetLength(void);
+uint8_t songGetPos(void);
+void songStart(void);
+bool getSongPlaying(void);
+bool sequenceRecord(uint8_t channelIdx, uint8_t fields, bool hit, ChannelParams_T params, bool nextStep);
 
 #endif
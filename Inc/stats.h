@@ -0,0 +1,29 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include "audioTypes.h"
+
+// Health counters for deciding whether a unit has headroom for more voices. Times are
+// recorded as the worst case seen since the counters were last cleared.
+typedef struct {
+  // Halves of the DAC buffer that were played again before they had been refilled
+  uint32_t dacUnderruns;
+  // Halves of the mic buffer that were overwritten before they had been copied
+  uint32_t micOverruns;
+  // Cycles from the DMA needing a half buffer refilled to the refill finishing
+  uint32_t maxRefillLatency;
+  // Cycles taken by the longest flash read of clip data for each channel
+  uint32_t maxFlashReadTime[NUM_CHANNELS];
+  // Samples from the step timer firing to the step's clips being started
+  uint32_t maxStepLateness;
+} HealthStats_T;
+
+void statsDacUnderrun(void);
+void statsMicOverrun(void);
+void statsRefillLatency(uint32_t cycles);
+void statsFlashReadTime(uint8_t channelIdx, uint32_t cycles);
+void statsStepLateness(uint32_t cycles);
+void statsGetAndClear(HealthStats_T *stats);
+
+#endif
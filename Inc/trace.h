@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Comment out to remove all trace points
+#define TRACE_ENABLED
+
+// Number of records kept, must be a power of two. Once full the oldest records are overwritten.
+#define TRACE_NUM_RECORDS 256
+
+// Events with a matching _BEGIN/_END pair are shown as durations by the host decoder
+// (Tools/trace2chrome.py), anything else as an instant. Keep the two in step.
+typedef enum {
+  TRACE_I2S_RX_HALF         = 0x01,
+  TRACE_I2S_RX_CPLT         = 0x02,
+  TRACE_I2S_TX_HALF         = 0x03,
+  TRACE_I2S_TX_CPLT         = 0x04,
+  TRACE_STEP                = 0x05, // arg: step index
+  TRACE_FLASH_READ_BEGIN    = 0x10, // arg: length
+  TRACE_FLASH_READ_END      = 0x11,
+  TRACE_FLASH_WRITE_BEGIN   = 0x12, // arg: length
+  TRACE_FLASH_WRITE_END     = 0x13,
+  TRACE_FLASH_ERASE_BEGIN   = 0x14, // arg: erase command
+  TRACE_FLASH_ERASE_END     = 0x15,
+  TRACE_UI_RENDER_BEGIN     = 0x20, // arg: menu index
+  TRACE_UI_RENDER_END       = 0x21,
+  TRACE_HANDLER_BEGIN       = 0x30, // arg: scheduler handler index
+  TRACE_HANDLER_END         = 0x31
+} eTraceEvent_T;
+
+// Records are 8 bytes: DWT cycle count, event id and an argument
+typedef struct {
+  uint32_t timestamp;
+  uint16_t id;
+  uint16_t arg;
+} TraceRecord_T;
+
+#ifdef TRACE_ENABLED
+#define TRACE(id, arg) traceRecord((id), (arg))
+#else
+#define TRACE(id, arg)
+#endif
+
+void traceRecord(uint16_t id, uint16_t arg);
+void traceDump(void);
+
+#endif
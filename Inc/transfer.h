@@ -0,0 +1,44 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary transfer of clips and sequences over the console UART (see transfer.c for the protocol)
+#define TRANSFER_PROTOCOL_VERSION 1
+#define TRANSFER_SYNC 0xA5
+// Data frames carry one flash page
+#define TRANSFER_MAX_PAYLOAD 256
+// Data frames that can be sent before the first of them has been acknowledged
+#define TRANSFER_WINDOW 8
+
+typedef enum {
+  FRAME_HELLO       = 0x01,
+  FRAME_INFO        = 0x02,
+  FRAME_OPEN_READ   = 0x03,
+  FRAME_OPEN_WRITE  = 0x04,
+  FRAME_OPEN_OK     = 0x05,
+  FRAME_DATA        = 0x06,
+  FRAME_ACK         = 0x07,
+  FRAME_DONE        = 0x08,
+  FRAME_ERROR       = 0x09,
+  FRAME_CLOSE       = 0x0A
+} eTransferFrame_T;
+
+typedef enum {
+  TRANSFER_OBJECT_CLIP      = 0x00,
+  TRANSFER_OBJECT_SEQUENCE  = 0x01
+} eTransferObject_T;
+
+typedef enum {
+  TRANSFER_ERROR_BAD_REQUEST  = 0x01,
+  TRANSFER_ERROR_BUSY         = 0x02,
+  TRANSFER_ERROR_INVALID_DATA = 0x03
+} eTransferError_T;
+
+void transferStart(void);
+bool transferIsActive(void);
+void transferProcess(void);
+void transferTick(void);
+
+#endif
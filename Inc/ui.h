@@ -5,7 +5,13 @@
 #include <stdbool.h>
 
 void uiInit(void);
-void uiUpdate(int16_t encCountChange, bool buttonPressed);
+// Input and value changes are gathered into frames of at most one every UI_FRAME_MS
+#define UI_FRAME_MS 16
+
+void uiUpdate(void);
 void uiValueChangeCB(int16_t valuesChanged);
+void uiTick(void);
+void uiGetAndResetFrameStats(uint32_t *rendered, uint32_t *skipped);
+uint32_t uiBenchRedraw(void);
 
 #endif
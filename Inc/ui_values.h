@@ -12,7 +12,11 @@ enum {
   UI_SEQ_CLIP       = 0x080,
   UI_SEQ_CLIP_START = 0x100,
   UI_SEQ_CLIP_END   = 0x200,
-  UI_AUDIO_RUNNING  = 0x400
+  UI_AUDIO_RUNNING  = 0x400,
+  UI_SEQ_LENGTH     = 0x800,
+  UI_REC_CLIP       = 0x1000,
+  UI_REC_CLIP_START = 0x2000,
+  UI_REC_CLIP_END   = 0x4000
 };
 
 typedef void (*uiChangeCallback)(int16_t);
@@ -5,6 +5,10 @@
 #include "audio.h"
 #include "sequence.h"
 #include "ui.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "cycles.h"
+#include "transfer.h"
 
 
 // Step timer config
@@ -23,10 +27,17 @@ static TIM_HandleTypeDef *encTimer;
 static TIM_HandleTypeDef *inputTimer;
 
 static volatile uint16_t previousCount;
+// Encoder movement since the UI last took it (see appTakeInput)
 static volatile int16_t countChange = 0;
 static volatile bool tempButtonPressed = false;
 static volatile bool buttonPressed = false;
+// Set when the encoder moves or the button changes, until the UI takes the input
+static volatile bool inputChanged = false;
 static volatile bool triggerStep = false;
+// When the current step was due, for measuring how late it was started
+static volatile uint32_t stepTriggerTime;
+// Step of the sequence that was played last, for the grid view's playhead
+static uint8_t playedStepIdx = 0;
 
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
@@ -50,24 +61,83 @@ void HAL_TIM_PeriodElapsedCallback (TIM_HandleTypeDef *htim)
 	} else {
 	  buttonPressed = false;
 	}
+	inputChanged = true;
 	HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+	schedulerPost(EVENT_UI);
   }
   if (htim->Instance == stepTimer->Instance)
   {
+    stepTriggerTime = cyclesNow();
     triggerStep = true;
+    schedulerPost(EVENT_STEP);
   }
 }
 
 
 void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
 {
-  countChange = htim->Instance->CNT - previousCount;
+  // Movement adds up until the UI takes it at its next frame
+  countChange += htim->Instance->CNT - previousCount;
   previousCount = htim->Instance->CNT = 32767;
+  inputChanged = true;
+  schedulerPost(EVENT_UI);
+}
+
+
+static void appStepHandler(void)
+{
+  if (triggerStep) {
+    statsStepLateness(cyclesNow() - stepTriggerTime);
+    playedStepIdx = getStepIdx();
+    step();
+    triggerStep = false;
+    // Moves the playhead of the grid view
+    schedulerPost(EVENT_UI);
+  }
+}
+
+
+static void appUIHandler(void)
+{
+  uiUpdate();
+}
+
+
+// appInputPending
+// Returns whether the encoder has moved or the button has changed since the UI last took its input
+bool appInputPending(void)
+{
+  return inputChanged;
+}
+
+
+// appTakeInput
+// Returns the encoder movement since the input was last taken, and the state of the button.
+// Taken with interrupts disabled so no movement is lost.
+int16_t appTakeInput(bool *buttonPressedOut)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int16_t change = countChange;
+  countChange = 0;
+  inputChanged = false;
+  *buttonPressedOut = buttonPressed;
+  __set_PRIMASK(primask);
+
+  return change;
 }
 
 
 void appInit(I2S_HandleTypeDef *i2sMicH, I2S_HandleTypeDef *i2sDACH, SPI_HandleTypeDef *spiFlashH, TIM_HandleTypeDef *stepTimerH, TIM_HandleTypeDef *encTimerH, TIM_HandleTypeDef *inputTimerH)
 {
+  schedulerInit();
+  schedulerRegister(EVENT_AUDIO, "audio", &audioProcessData);
+  schedulerRegister(EVENT_STEP, "step", &appStepHandler);
+  schedulerRegister(EVENT_CONSOLE, "console", &ConsoleProcess);
+  schedulerRegister(EVENT_UI, "ui", &appUIHandler);
+  schedulerRegister(EVENT_SEQUENCE, "sequence", &sequenceProcess);
+  schedulerRegister(EVENT_TRANSFER, "transfer", &transferProcess);
+  schedulerSetDeadline(EVENT_AUDIO, AUDIO_REFILL_DEADLINE_US);
   ConsoleInit();
   flashInit(spiFlashH);
   audioInit(i2sMicH, i2sDACH, &uiValueChangeCB);
@@ -84,19 +154,8 @@ void appInit(I2S_HandleTypeDef *i2sMicH, I2S_HandleTypeDef *i2sDACH, SPI_HandleT
 
 void appLoop(void)
 {
-  while(1)
-  {
-    ConsoleProcess();
-    audioProcessData();
-
-    if (triggerStep) {
-      step();
-      triggerStep = false;
-    }
-
-    uiUpdate(countChange, buttonPressed);
-    countChange = 0;
-  }
+  // Runs the handlers registered in appInit as their events are posted
+  schedulerRun();
 }
 
 
@@ -218,7 +277,9 @@ void appStartSequence(void)
 {
   sequenceStart();
   HAL_TIM_Base_Start_IT(stepTimer);
+  stepTriggerTime = cyclesNow();
   triggerStep = true;
+  schedulerPost(EVENT_STEP);
 }
 
 
@@ -251,6 +312,18 @@ void appToggleClipPlay(void)
 }
 
 
+bool appGetSequencePlaying(void)
+{
+  return getSequencePlaying();
+}
+
+
+uint8_t appGetPlayedStepIdx(void)
+{
+  return playedStepIdx;
+}
+
+
 void appToggleSequencePlay(void)
 {
   if (getSequencePlaying()) {
@@ -273,9 +346,9 @@ uint8_t appGetSequenceNum(void)
 }
 
 
-void appStoreSequence(void)
+bool appStoreSequence(void)
 {
-  sequenceStore();
+  return sequenceStore();
 }
 
 
@@ -289,3 +362,134 @@ bool appGetSequenceUsed(void)
 {
   return getSequenceUsed();
 }
+
+
+void appSetSequenceLength(uint8_t length)
+{
+  sequenceSetLength(length);
+}
+
+
+uint8_t appGetSequenceLength(void)
+{
+  return sequenceGetLength();
+}
+
+
+bool appSetSong(const uint8_t *sequenceNums, uint8_t length)
+{
+  return songSet(sequenceNums, length);
+}
+
+
+// appStartSong
+// Starts playing the song from its first sequence. Returns false if no song has been set.
+bool appStartSong(void)
+{
+  if (songGetLength() == 0) {
+    return false;
+  }
+  songStart();
+  HAL_TIM_Base_Start_IT(stepTimer);
+  stepTriggerTime = cyclesNow();
+  triggerStep = true;
+  schedulerPost(EVENT_STEP);
+  return true;
+}
+
+
+// appRecordStep
+// Records a live change to the sequence, quantised to the nearest step. The step timer counts up
+// to its period between steps, so in the first half of the period the nearest step is the one that
+// has just played and in the second half it's the next one. A step that's due but hasn't been
+// processed yet counts as the next one.
+bool appRecordStep(uint8_t channelIdx, uint8_t fields, bool hit, ChannelParams_T params)
+{
+  bool nextStep = triggerStep || stepTimer->Instance->CNT >= stepTimer->Instance->ARR / 2;
+  if (!sequenceRecord(channelIdx, fields, hit, params, nextStep)) {
+    return false;
+  }
+  // A hit recorded on the step that has just played won't be heard until the sequence loops,
+  // so play it now
+  if (hit && !nextStep) {
+    audioSetChannelParams(channelIdx, params);
+    audioSetChannelRunning(channelIdx, true);
+  }
+  return true;
+}
+
+
+void appToggleSongPlay(void)
+{
+  if (getSequencePlaying()) {
+    appStopSequence();
+  } else {
+    appStartSong();
+  }
+}
+
+
+uint16_t appGetDutyCycle(void)
+{
+  return schedulerGetDutyCycle();
+}
+
+
+const SchedulerHandlerStats_T * appGetHandlerStats(uint8_t handlerIdx)
+{
+  return schedulerGetHandlerStats(handlerIdx);
+}
+
+
+void appResetHandlerStats(void)
+{
+  schedulerResetStats();
+}
+
+
+uint32_t appGetHandlerDeadline(uint8_t handlerIdx)
+{
+  return schedulerGetDeadline(handlerIdx);
+}
+
+
+uint32_t appGetHandlerDeadlineMisses(uint8_t handlerIdx)
+{
+  return schedulerGetDeadlineMisses(handlerIdx);
+}
+
+
+uint32_t appGetAudioMixWCET(void)
+{
+  return audioGetMixWCET();
+}
+
+
+uint32_t appGetAudioMixUnderruns(void)
+{
+  return audioGetMixUnderruns();
+}
+
+
+void appResetAudioMixStats(void)
+{
+  audioResetMixStats();
+}
+
+
+void appTraceDump(void)
+{
+  traceDump();
+}
+
+
+void appGetAndClearStats(HealthStats_T *stats)
+{
+  statsGetAndClear(stats);
+}
+
+
+void appStartTransfer(void)
+{
+  transferStart();
+}
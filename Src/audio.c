@@ -1,6 +1,12 @@
 #include "audio.h"
 #include "flash.h"
 #include "main.h"
+#include "scheduler.h"
+#include "cycles.h"
+#include "profile.h"
+#include "trace.h"
+#include "stats.h"
+#include <string.h>
 
 
 // Samples sent over I2S are one word (half word for each channel)
@@ -19,6 +25,8 @@ static int16_t dacBuffer[I2S_BUFFER_SIZE];
 static volatile int16_t *micBufferPtr = &micBuffer[0];
 static volatile int16_t *dacBufferPtr = &dacBuffer[0];
 static volatile bool readyForData;
+// When the DMA last asked for a half buffer, for measuring refill latency
+static volatile uint32_t refillRequestTime;
 
 typedef enum {
   AUDIO_RECORD      = 0u,
@@ -32,41 +40,181 @@ static eAudioState_T audioState = AUDIO_RAM_PLAY;
 // When state is play from Flash use all channels
 static ChannelParams_T channelParams[NUM_CHANNELS];
 static uint16_t sampleIndexes[NUM_CHANNELS];
-static bool channelRunning[NUM_CHANNELS];
+static volatile bool channelRunning[NUM_CHANNELS];
 static bool audioRunning;
 
 static uiChangeCallback uiChangeCB;
 
+// Each clip block ends with a tail, written after the audio:
+//   0  used flag (CLIP_USED_FLAG)
+//   1  overview version, 0 in clips stored before there was an overview
+//   2  overview level 0, a pair of the lowest and highest sample in each of the AUDIO_PEAK_COLUMNS
+//      columns, keeping the top 8 bits of each
+//      then level 1, with half as many columns
+// Higher levels are made from level 1 when they are read, so a clip can be drawn at any width with
+// one small read instead of reading all of its samples.
+#define CLIP_TAIL_OFFSET (CLIP_SAMPLES * 2)
+#define CLIP_TAIL_SIZE 768
+#define CLIP_USED_FLAG 0xAA
+#define OVERVIEW_VERSION 1
+#define OVERVIEW_LEVEL0_OFFSET 2
+#define OVERVIEW_LEVEL0_COLUMNS AUDIO_PEAK_COLUMNS
+#define OVERVIEW_LEVEL1_OFFSET (OVERVIEW_LEVEL0_OFFSET + OVERVIEW_LEVEL0_COLUMNS * 2)
+#define OVERVIEW_LEVEL1_COLUMNS ((OVERVIEW_LEVEL0_COLUMNS + 1) / 2)
+// Samples read at a time when finishing a clip that is already in flash
+#define OVERVIEW_READ_SAMPLES 128
+
+static uint8_t clipTail[CLIP_TAIL_SIZE];
+
+// Peaks of channel 0 waiting to be drawn by the waveform view. The indexes are left to wrap
+// (PEAK_RING_SIZE divides 256). Peaks are only added by the main loop.
+#define PEAK_RING_SIZE 16
+static AudioPeak_T peakRing[PEAK_RING_SIZE];
+static volatile uint8_t peakReadIdx;
+static volatile uint8_t peakWriteIdx;
+// Peak of the column being collected, and the number of samples left before the next column
+static AudioPeak_T peak = {0, INT16_MAX, INT16_MIN};
+static uint8_t peakSamplesLeft = AUDIO_PEAK_SAMPLES;
+
+#ifdef AUDIO_REFILL_IN_ISR
+// Number of samples mixed into each half of the DAC buffer
+#define MIX_SAMPLES (I2S_BUFFER_SIZE / 4)
+// Each channel has a ring of samples read ahead from flash, in chunks of MIX_SAMPLES samples
+#define PREFETCH_CHUNKS 4
+#define PREFETCH_SIZE (MIX_SAMPLES * PREFETCH_CHUNKS)
+// Chunks read straight away when a channel is started, so it has data for the next mix
+#define PREFILL_CHUNKS 2
+
+// The read and write indexes count samples and are left to wrap (PREFETCH_SIZE divides 65536),
+// so the number of samples in the ring is always writeIdx - readIdx. readIdx is only written by
+// the mixer and writeIdx only by the prefetcher.
+typedef struct {
+  int16_t samples[PREFETCH_SIZE];
+  volatile uint16_t readIdx;
+  volatile uint16_t writeIdx;
+  // Next sample of the clip to read from flash
+  uint16_t fetchIdx;
+  // Set when the end of a clip that doesn't loop has been read
+  volatile bool fetchDone;
+} PrefetchRing_T;
+
+static PrefetchRing_T prefetchRings[NUM_CHANNELS];
+static volatile uint32_t mixWCET = 0;
+static volatile uint32_t mixUnderruns = 0;
+#endif
+
+
+// peakPush
+// Queues the peak of the column being collected for the waveform view, if it has any samples.
+// If the UI has fallen behind the peak is dropped.
+static void peakPush(void)
+{
+  if (peak.min <= peak.max && (uint8_t) (peakWriteIdx - peakReadIdx) < PEAK_RING_SIZE) {
+    peakRing[peakWriteIdx % PEAK_RING_SIZE] = peak;
+    peakWriteIdx++;
+    schedulerPost(EVENT_UI);
+  }
+  peak.min = INT16_MAX;
+  peak.max = INT16_MIN;
+}
 
-void HAL_I2S_RxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+
+// peakSeek
+// Called with the clip index of the first sample of each block passed to peakAdd. Only this
+// divides, so collecting peaks costs a couple of compares per sample.
+static void peakSeek(uint16_t sampleIdx)
 {
-  micBufferPtr = &micBuffer[0];
-  readyForData = true;
+  uint8_t column = sampleIdx / AUDIO_PEAK_SAMPLES;
+
+  if (column != peak.column) {
+    peakPush();
+    peak.column = column;
+  }
+  peakSamplesLeft = AUDIO_PEAK_SAMPLES - (sampleIdx % AUDIO_PEAK_SAMPLES);
 }
 
 
-void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef *hi2s)
+static inline void peakAdd(int16_t sample)
 {
-  micBufferPtr = &micBuffer[I2S_BUFFER_SIZE/2];
+  if (sample < peak.min) {
+    peak.min = sample;
+  }
+  if (sample > peak.max) {
+    peak.max = sample;
+  }
+  if (--peakSamplesLeft == 0) {
+    peakPush();
+    peak.column++;
+    peakSamplesLeft = AUDIO_PEAK_SAMPLES;
+  }
+}
+
+
+static void micHalfDone(volatile int16_t *half)
+{
+  micBufferPtr = half;
+  // If the last half hasn't been copied yet it has now been overwritten
+  if (readyForData) {
+    statsMicOverrun();
+  }
+  refillRequestTime = cyclesNow();
   readyForData = true;
+  schedulerPost(EVENT_AUDIO);
 }
 
 
-void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+static void dacHalfDone(volatile int16_t *half)
 {
-  dacBufferPtr = &dacBuffer[0];
+  dacBufferPtr = half;
   // If we're recording we pause filling of the DAC buffer so don't signal for more data
   if (audioState == AUDIO_RECORD) return;
+#ifdef AUDIO_REFILL_IN_ISR
+  if (audioState == AUDIO_FLASH_PLAY) {
+    // Mix into the half just played as soon as this interrupt returns. The mix counts
+    // underruns itself as the main loop only prefetches.
+    refillRequestTime = cyclesNow();
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    readyForData = true;
+    schedulerPost(EVENT_AUDIO);
+    return;
+  }
+#endif
+  // If the last half hasn't been refilled yet the DMA is about to play it again
+  if (readyForData) {
+    statsDacUnderrun();
+  } else {
+    refillRequestTime = cyclesNow();
+  }
   readyForData = true;
+  schedulerPost(EVENT_AUDIO);
+}
+
+
+void HAL_I2S_RxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+  TRACE(TRACE_I2S_RX_HALF, 0);
+  micHalfDone(&micBuffer[0]);
+}
+
+
+void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+  TRACE(TRACE_I2S_RX_CPLT, 0);
+  micHalfDone(&micBuffer[I2S_BUFFER_SIZE/2]);
+}
+
+
+void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s)
+{
+  TRACE(TRACE_I2S_TX_HALF, 0);
+  dacHalfDone(&dacBuffer[0]);
 }
 
 
 void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s)
 {
-  dacBufferPtr = &dacBuffer[I2S_BUFFER_SIZE/2];
-  // If we're recording we pause filling of the DAC buffer so don't signal for more data
-  if (audioState == AUDIO_RECORD) return;
-  readyForData = true;
+  TRACE(TRACE_I2S_TX_CPLT, 0);
+  dacHalfDone(&dacBuffer[I2S_BUFFER_SIZE/2]);
 }
 
 
@@ -77,6 +225,11 @@ void audioInit(I2S_HandleTypeDef *i2sMicH, I2S_HandleTypeDef *i2sDACH, uiChangeC
 
   HAL_I2S_Transmit_DMA(i2sDAC, (uint16_t *) dacBuffer, I2S_BUFFER_SIZE);
 
+#ifdef AUDIO_REFILL_IN_ISR
+  // The mix must not pre-empt any other interrupt
+  HAL_NVIC_SetPriority(PendSV_IRQn, 15, 0);
+#endif
+
   for (int i=0; i < NUM_CHANNELS; i++) {
     channelParams[i].clipNum = 1;
     channelParams[i].startSample = 0;
@@ -91,9 +244,199 @@ void audioInit(I2S_HandleTypeDef *i2sMicH, I2S_HandleTypeDef *i2sDACH, uiChangeC
 }
 
 
+#ifdef AUDIO_REFILL_IN_ISR
+static uint16_t prefetchUsed(PrefetchRing_T *ring)
+{
+  return (uint16_t) (ring->writeIdx - ring->readIdx);
+}
+
+
+static void prefetchChunk(uint8_t channelIdx)
+{
+  PrefetchRing_T *ring = &prefetchRings[channelIdx];
+  ChannelParams_T *params = &channelParams[channelIdx];
+
+  uint32_t readStart = cyclesNow();
+  flashReadDataBlockOffset(
+      params->clipNum - 1,
+      (uint8_t *) &ring->samples[ring->writeIdx % PREFETCH_SIZE],
+      ring->fetchIdx * 2,
+      MIX_SAMPLES * 2
+  );
+  statsFlashReadTime(channelIdx, cyclesNow() - readStart);
+  if (channelIdx == 0) {
+    // Peaks run a few chunks ahead of what is heard
+    int16_t *chunk = &ring->samples[ring->writeIdx % PREFETCH_SIZE];
+    peakSeek(ring->fetchIdx);
+    for (uint16_t i = 0; i < MIX_SAMPLES; i++) {
+      peakAdd(chunk[i]);
+    }
+  }
+  // The samples must be in the ring before the mixer can see them
+  __DMB();
+  ring->writeIdx += MIX_SAMPLES;
+
+  ring->fetchIdx += MIX_SAMPLES;
+  if (ring->fetchIdx > params->endSample) {
+    if (params->loop) {
+      ring->fetchIdx = params->startSample;
+    } else {
+      ring->fetchDone = true;
+    }
+  }
+}
+
+
+// audioPrefetch
+// Tops up the prefetch ring of each running channel from flash. Runs in the main loop.
+static void audioPrefetch(void)
+{
+  bool anyChannelsRunning = false;
+
+  for (uint8_t channelIdx = 0; channelIdx < NUM_CHANNELS; channelIdx++) {
+    if (!channelRunning[channelIdx]) {
+      continue;
+    }
+    anyChannelsRunning = true;
+    PrefetchRing_T *ring = &prefetchRings[channelIdx];
+    while (!ring->fetchDone && prefetchUsed(ring) <= PREFETCH_SIZE - MIX_SAMPLES) {
+      prefetchChunk(channelIdx);
+    }
+  }
+
+  if (!anyChannelsRunning && audioRunning) {
+    audioRunning = false;
+    uiChangeCB(UI_AUDIO_RUNNING);
+  }
+}
+#endif
+
+
+static void channelStart(uint8_t channelIdx)
+{
+  sampleIndexes[channelIdx] = channelParams[channelIdx].startSample;
+#ifdef AUDIO_REFILL_IN_ISR
+  // The mixer ignores the channel while its ring is refilled. The mixer can interrupt this
+  // but not the other way round, so no locking is needed.
+  channelRunning[channelIdx] = false;
+  PrefetchRing_T *ring = &prefetchRings[channelIdx];
+  ring->readIdx = 0;
+  ring->writeIdx = 0;
+  ring->fetchIdx = channelParams[channelIdx].startSample;
+  ring->fetchDone = false;
+  for (uint8_t i = 0; i < PREFILL_CHUNKS && !ring->fetchDone; i++) {
+    prefetchChunk(channelIdx);
+  }
+#endif
+  channelRunning[channelIdx] = true;
+}
+
+
+#ifdef AUDIO_REFILL_IN_ISR
+// audioMixISR
+// Mixes the running channels into the half of the DAC buffer that has just been played.
+// Called from PendSV, which is pended by the DAC DMA callbacks. Only reads from the prefetch
+// rings so it takes the same time whatever the main loop is doing.
+void audioMixISR(void)
+{
+  if (audioState != AUDIO_FLASH_PLAY) return;
+
+  uint32_t start = cyclesNow();
+  volatile int16_t *out = dacBufferPtr;
+  PrefetchRing_T *rings[NUM_CHANNELS];
+  const int16_t *chunks[NUM_CHANNELS];
+  uint8_t numChunks = 0;
+
+  for (uint8_t channelIdx = 0; channelIdx < NUM_CHANNELS; channelIdx++) {
+    if (!channelRunning[channelIdx]) {
+      continue;
+    }
+    PrefetchRing_T *ring = &prefetchRings[channelIdx];
+    if (prefetchUsed(ring) >= MIX_SAMPLES) {
+      rings[numChunks] = ring;
+      chunks[numChunks++] = &ring->samples[ring->readIdx % PREFETCH_SIZE];
+    } else if (ring->fetchDone) {
+      channelRunning[channelIdx] = false;
+    } else {
+      // The prefetcher hasn't kept up, the channel is silent for this half buffer
+      mixUnderruns++;
+      statsDacUnderrun();
+    }
+  }
+
+  for (uint16_t i = 0; i < MIX_SAMPLES; i++) {
+    int16_t sample = 0;
+    for (uint8_t c = 0; c < numChunks; c++) {
+      sample += chunks[c][i];
+    }
+    // Send same sample to left and right channels
+    out[i * 2] = sample;
+    out[i * 2 + 1] = sample;
+  }
+
+  for (uint8_t c = 0; c < numChunks; c++) {
+    rings[c]->readIdx += MIX_SAMPLES;
+  }
+
+  uint32_t now = cyclesNow();
+  uint32_t cycles = now - start;
+  if (cycles > mixWCET) {
+    mixWCET = cycles;
+  }
+  statsRefillLatency(now - refillRequestTime);
+}
+#else
+void audioMixISR(void)
+{
+}
+#endif
+
+
+// audioGetMixWCET
+// Returns the longest time audioMixISR has taken in cycles, or 0 if mixing isn't done in the interrupt.
+uint32_t audioGetMixWCET(void)
+{
+#ifdef AUDIO_REFILL_IN_ISR
+  return mixWCET;
+#else
+  return 0;
+#endif
+}
+
+
+uint32_t audioGetMixUnderruns(void)
+{
+#ifdef AUDIO_REFILL_IN_ISR
+  return mixUnderruns;
+#else
+  return 0;
+#endif
+}
+
+
+void audioResetMixStats(void)
+{
+#ifdef AUDIO_REFILL_IN_ISR
+  mixWCET = 0;
+  mixUnderruns = 0;
+#endif
+}
+
+
 void audioProcessData(void)
 {
   if (!readyForData) return;
+  PROFILE_BEGIN(PROFILE_AUDIO_PROCESS);
+
+#ifdef AUDIO_REFILL_IN_ISR
+  if (audioState == AUDIO_FLASH_PLAY) {
+    // Mixing has already been done in audioMixISR
+    audioPrefetch();
+    readyForData = false;
+    PROFILE_END(PROFILE_AUDIO_PROCESS);
+    return;
+  }
+#endif
 
   // Stored sample (only left frame)
   int16_t sample;
@@ -121,12 +464,17 @@ void audioProcessData(void)
       // We read I2S_BUFFER_SIZE/2 bytes so I2S_BUFFER_SIZE/4 samples (samples are 16 bits each)
       // This is enough to fill half the buffer as each sample is duplicated for left and right channels
       if (channelRunning[channelIdx]) {
+        uint32_t readStart = cyclesNow();
         flashReadDataBlockOffset(
             channelParams[channelIdx].clipNum - 1,
             (uint8_t *) &audio[channelIdx * (I2S_BUFFER_SIZE / 2)],
             sampleIndexes[channelIdx] * 2,
             I2S_BUFFER_SIZE / 2
         );
+        statsFlashReadTime(channelIdx, cyclesNow() - readStart);
+        if (channelIdx == 0) {
+          peakSeek(sampleIndexes[0]);
+        }
 
         // FIXME: I think this should come after the buffer fill loop otherwise we prematurely stop channels
         // We also want this to apply when the audio state is AUDIO_RAM_PLAY maybe?
@@ -150,6 +498,7 @@ void audioProcessData(void)
     }
   } else {
     ramSampleIdx = sampleIndexes[channelIdx];
+    peakSeek(ramSampleIdx);
   }
 
   for (uint16_t i = 0; i < (I2S_BUFFER_SIZE/2) - 1; i += increment) {
@@ -158,6 +507,7 @@ void audioProcessData(void)
       // We also only store the top 16 bits of each 24 bit sample
       // This has the effect of a crude re-sample to 16 bits
       audio[ramSampleIdx] = micBufferPtr[i];
+      peakAdd(audio[ramSampleIdx]);
     } else if (audioState == AUDIO_RAM_PLAY) {
       // FIXME: I think it should be possible to combine the code for AUDIO_RAM_PLAY and AUDIO_FLASH_PLAY
       // Maybe we just iterate over first channel instead of all channels for AUDIO_RAM_PLAY
@@ -165,6 +515,7 @@ void audioProcessData(void)
       // Send same sample to left and right channels
       if (channelRunning[channelIdx]) {
         sample = audio[ramSampleIdx];
+        peakAdd(sample);
       } else {
         sample = 0;
       }
@@ -172,6 +523,9 @@ void audioProcessData(void)
       dacBufferPtr[i + 1] = sample;
     } else {
       sample = 0;
+      if (channelRunning[0]) {
+        peakAdd(audio[ramSampleIdx]);
+      }
       for (channelIdx = 0; channelIdx < NUM_CHANNELS; channelIdx++) {
         if (channelRunning[channelIdx]) {
           sample += audio[ramSampleIdx + (channelIdx * (I2S_BUFFER_SIZE / 2))];
@@ -185,6 +539,7 @@ void audioProcessData(void)
     if (audioState == AUDIO_RAM_PLAY || audioState == AUDIO_RECORD) {
       if (ramSampleIdx >= 16000) {
         ramSampleIdx = 0;
+        peakSeek(0);
         if (audioState == AUDIO_RECORD) {
           HAL_GPIO_WritePin(STATUS_LED_GPIO_Port, STATUS_LED_Pin, GPIO_PIN_RESET);
           // Stop recoding audio
@@ -203,7 +558,22 @@ void audioProcessData(void)
     sampleIndexes[channelIdx] = ramSampleIdx;
   }
 
+  statsRefillLatency(cyclesNow() - refillRequestTime);
   readyForData = false;
+  PROFILE_END(PROFILE_AUDIO_PROCESS);
+}
+
+
+// audioGetPeak
+// Takes the oldest peak waiting to be drawn by the waveform view, returning false if there are none
+bool audioGetPeak(AudioPeak_T *peakOut)
+{
+  if (peakReadIdx == peakWriteIdx) {
+    return false;
+  }
+  *peakOut = peakRing[peakReadIdx % PEAK_RING_SIZE];
+  peakReadIdx++;
+  return true;
 }
 
 
@@ -234,8 +604,7 @@ void audioPlay(void)
 void audioPlayFromFlash(void)
 {
   audioState = AUDIO_FLASH_PLAY;
-  sampleIndexes[0] = channelParams[0].startSample;
-  channelRunning[0] = true;
+  channelStart(0);
   HAL_I2S_Transmit_DMA(i2sDAC, (uint16_t *) dacBuffer, I2S_BUFFER_SIZE);
   audioRunning = true;
   uiChangeCB(UI_AUDIO_RUNNING);
@@ -297,13 +666,141 @@ void audioSetLoop(bool loop)
 }
 
 
+// overviewBegin
+// Starts building the tail of a clip block, with every overview column empty
+static void overviewBegin(void)
+{
+  memset(clipTail, 0, sizeof(clipTail));
+  clipTail[0] = CLIP_USED_FLAG;
+  clipTail[1] = OVERVIEW_VERSION;
+  for (uint16_t column = 0; column < OVERVIEW_LEVEL0_COLUMNS; column++) {
+    clipTail[OVERVIEW_LEVEL0_OFFSET + column * 2] = (uint8_t) INT8_MAX;
+    clipTail[OVERVIEW_LEVEL0_OFFSET + column * 2 + 1] = (uint8_t) INT8_MIN;
+  }
+}
+
+
+// overviewAdd
+// Adds samples to level 0 of the overview, the first being sample firstIdx of the clip
+static void overviewAdd(const int16_t *samples, uint16_t firstIdx, uint16_t count)
+{
+  int8_t *level0 = (int8_t *) &clipTail[OVERVIEW_LEVEL0_OFFSET];
+  uint16_t column = firstIdx / AUDIO_PEAK_SAMPLES;
+  uint8_t samplesLeft = AUDIO_PEAK_SAMPLES - (firstIdx % AUDIO_PEAK_SAMPLES);
+
+  for (uint16_t i = 0; i < count; i++) {
+    int8_t value = samples[i] >> 8;
+    if (value < level0[column * 2]) {
+      level0[column * 2] = value;
+    }
+    if (value > level0[column * 2 + 1]) {
+      level0[column * 2 + 1] = value;
+    }
+    if (--samplesLeft == 0) {
+      column++;
+      samplesLeft = AUDIO_PEAK_SAMPLES;
+    }
+  }
+}
+
+
+// overviewHalve
+// Makes each column of a level from two columns of the level below, returning the number of columns
+static uint8_t overviewHalve(const int8_t *below, uint8_t belowColumns, int8_t *level)
+{
+  uint8_t columns = (belowColumns + 1) / 2;
+
+  for (uint8_t column = 0; column < columns; column++) {
+    int8_t min = below[column * 4];
+    int8_t max = below[column * 4 + 1];
+    if (column * 2 + 1 < belowColumns) {
+      if (below[column * 4 + 2] < min) {
+        min = below[column * 4 + 2];
+      }
+      if (below[column * 4 + 3] > max) {
+        max = below[column * 4 + 3];
+      }
+    }
+    level[column * 2] = min;
+    level[column * 2 + 1] = max;
+  }
+  return columns;
+}
+
+
+// overviewWrite
+// Makes level 1 of the overview and writes the tail to the clip's block, which must be erased
+static void overviewWrite(uint8_t blockIdx)
+{
+  overviewHalve(
+      (int8_t *) &clipTail[OVERVIEW_LEVEL0_OFFSET],
+      OVERVIEW_LEVEL0_COLUMNS,
+      (int8_t *) &clipTail[OVERVIEW_LEVEL1_OFFSET]
+  );
+  flashWriteDataBlockOffset(blockIdx, clipTail, CLIP_TAIL_OFFSET, CLIP_TAIL_SIZE);
+}
+
+
 void audioStore(void)
 {
   uint8_t blockIdx = channelParams[0].clipNum - 1;
 
   flashEraseBlock(blockIdx);
-  audio[CLIP_SAMPLES] = 0x00AA;  // Set used flag
-  flashWriteDataBlock(blockIdx, (uint8_t *) audio, (CLIP_SAMPLES*2) + 1);
+  flashWriteDataBlock(blockIdx, (uint8_t *) audio, CLIP_SAMPLES * 2);
+  overviewBegin();
+  overviewAdd(audio, 0, CLIP_SAMPLES);
+  overviewWrite(blockIdx);
+}
+
+
+// audioFinishClip
+// Marks a clip written straight to flash as used and stores its overview. The clip's samples are
+// read back a few at a time, so the clip in RAM is left alone.
+void audioFinishClip(uint8_t audioClipNum)
+{
+  int16_t samples[OVERVIEW_READ_SAMPLES];
+
+  overviewBegin();
+  for (uint16_t sampleIdx = 0; sampleIdx < CLIP_SAMPLES; sampleIdx += OVERVIEW_READ_SAMPLES) {
+    uint16_t count = CLIP_SAMPLES - sampleIdx;
+    if (count > OVERVIEW_READ_SAMPLES) {
+      count = OVERVIEW_READ_SAMPLES;
+    }
+    flashReadDataBlockOffset(audioClipNum - 1, (uint8_t *) samples, sampleIdx * 2, count * 2);
+    overviewAdd(samples, sampleIdx, count);
+  }
+  overviewWrite(audioClipNum - 1);
+}
+
+
+// audioReadOverview
+// Reads a level of the overview stored with a clip into peaks, as a pair of the lowest and highest
+// sample in each column keeping the top 8 bits. peaks must have room for level 0, 2 bytes for each
+// of AUDIO_PEAK_COLUMNS columns. Returns the number of columns, or 0 if the clip has no overview.
+uint8_t audioReadOverview(uint8_t audioClipNum, uint8_t level, int8_t *peaks)
+{
+  uint8_t version;
+  uint8_t columns;
+
+  if (audioClipNum < 1 || audioClipNum > NUM_CLIPS || level > AUDIO_OVERVIEW_MAX_LEVEL) {
+    return 0;
+  }
+  flashReadDataBlockOffset(audioClipNum - 1, &version, CLIP_TAIL_OFFSET + 1, 1);
+  if (version != OVERVIEW_VERSION) {
+    return 0;
+  }
+
+  if (level == 0) {
+    columns = OVERVIEW_LEVEL0_COLUMNS;
+    flashReadDataBlockOffset(audioClipNum - 1, (uint8_t *) peaks, CLIP_TAIL_OFFSET + OVERVIEW_LEVEL0_OFFSET, columns * 2);
+    return columns;
+  }
+  columns = OVERVIEW_LEVEL1_COLUMNS;
+  flashReadDataBlockOffset(audioClipNum - 1, (uint8_t *) peaks, CLIP_TAIL_OFFSET + OVERVIEW_LEVEL1_OFFSET, columns * 2);
+  for (uint8_t i = 1; i < level; i++) {
+    columns = overviewHalve(peaks, columns, peaks);
+  }
+  return columns;
 }
 
 
@@ -335,9 +832,10 @@ ChannelParams_T audioGetChannelParams(uint8_t channelIdx)
 
 void audioSetChannelRunning(uint8_t channelIdx, bool runningState)
 {
-  channelRunning[channelIdx] = runningState;
-  if (runningState) {
-    sampleIndexes[channelIdx] = channelParams[channelIdx].startSample;
+  if (!runningState) {
+    channelRunning[channelIdx] = false;
+  } else {
+    channelStart(channelIdx);
     audioRunning = true;
     uiChangeCB(UI_AUDIO_RUNNING);
   }
@@ -359,7 +857,7 @@ bool audioClipUsed(uint8_t audioClipNum)
       CLIP_SAMPLES*2,
       1
   );
-  return clipUsed == 0xAA;
+  return clipUsed == CLIP_USED_FLAG;
 }
 
 
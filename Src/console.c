@@ -9,6 +9,9 @@
 #include "console.h"
 #include "consoleIo.h"
 #include "consoleCommands.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "macro.h"
 
 #define MIN(X, Y)   (((X) < (Y)) ? (X) : (Y))
 #define NOT_FOUND   -1
@@ -17,50 +20,111 @@
 #define NULL_CHAR            '\0'
 #define CR_CHAR              '\r'
 #define LF_CHAR              '\n'
+#define COMMAND_SEPARATOR    ';'
 
 // global variables
 char mReceiveBuffer[CONSOLE_COMMAND_MAX_LENGTH];
 uint32_t mReceivedSoFar;
 bool mReceiveBufferNeedsChecking = false;
+uint32_t mCommandCount;
 
 // local functions
 static int32_t ConsoleCommandEndline(const char receiveBuffer[], const  uint32_t filledLength);
 
-static uint32_t ConsoleCommandMatch(const char* name, const char *buffer);
+static int32_t ConsoleCommandCompare(const char *buffer, const char* name);
+static int32_t ConsoleCommandFind(const sConsoleCommandTable_T* commandTable, const char *buffer);
+static void ConsoleRunCommand(const char *command, uint32_t length);
 static uint32_t ConsoleResetBuffer(char receiveBuffer[], const  uint32_t filledLength, uint32_t usedSoFar);
 
 static eCommandResult_T ConsoleUtilHexCharToInt(char charVal, uint8_t* pInt); // this might be replaceable with *pInt = atoi(str)
 static eCommandResult_T ConsoleUtilsIntToHexChar(uint8_t intVal, char* pChar); // this could be replaced with itoa (intVal, str, 16);
 
-// ConsoleCommandMatch
-// Look to see if the data in the buffer matches the command name given that
-// the strings are different lengths and we have parameter separators
-static uint32_t ConsoleCommandMatch(const char* name, const char *buffer)
+// ConsoleCommandCompare
+// Compares the command at the start of the buffer, which ends at a parameter separator or the end
+// of the line, with a command name. Returns less than, equal to or greater than zero like strcmp.
+static int32_t ConsoleCommandCompare(const char *buffer, const char* name)
 {
   uint32_t i = 0u;
-  uint32_t result = 0u; // match
+  char bufferChar = buffer[i];
 
-  if ( buffer[i] == name [i] )
+  while ( ( PARAMETER_SEPARATER != bufferChar ) &&
+    ( LF_CHAR != bufferChar ) && ( CR_CHAR != bufferChar ) &&
+    ( NULL_CHAR != bufferChar ) && ( bufferChar == name[i] ) )
   {
-    result = 1u;
     i++;
+    bufferChar = buffer[i];
   }
+  if ( ( PARAMETER_SEPARATER == bufferChar ) || ( LF_CHAR == bufferChar ) || ( CR_CHAR == bufferChar ) )
+  {
+    bufferChar = NULL_CHAR;
+  }
+
+  return (int32_t) (uint8_t) bufferChar - (int32_t) (uint8_t) name[i];
+}
+
+// ConsoleCommandFind
+// Binary search of the command table, which is sorted by name. Returns the index of the command
+// at the start of the buffer or NOT_FOUND.
+static int32_t ConsoleCommandFind(const sConsoleCommandTable_T* commandTable, const char *buffer)
+{
+  int32_t low = 0;
+  int32_t high = (int32_t) mCommandCount - 1;
 
-  while ( ( 1u == result ) &&
-    ( i < CONSOLE_COMMAND_MAX_COMMAND_LENGTH )  &&
-    ( buffer[i] != PARAMETER_SEPARATER ) &&
-    ( buffer[i] != LF_CHAR ) &&( buffer[i] != CR_CHAR ) &&
-    ( buffer[i] != (char) NULL_CHAR )
-    )
+  while ( low <= high )
   {
-    if ( buffer[i] != name[i] )
+    int32_t middle = (low + high) / 2;
+    int32_t compare = ConsoleCommandCompare(buffer, commandTable[middle].name);
+    if ( 0 == compare )
     {
-      result = 0u;
+      return middle;
+    }
+    if ( compare < 0 )
+    {
+      high = middle - 1;
+    }
+    else
+    {
+      low = middle + 1;
     }
-    i++;
   }
+  return NOT_FOUND;
+}
 
-  return result;
+// ConsoleRunCommand
+// Runs one command, which is length characters long and ends with an endline
+static void ConsoleRunCommand(const char *command, uint32_t length)
+{
+  const sConsoleCommandTable_T* commandTable = ConsoleCommandsGetTable();
+  int32_t found;
+  eCommandResult_T result;
+
+  // Commands after the first in a batch usually follow a space
+  while ( ( length > 0u ) && ( PARAMETER_SEPARATER == *command ) )
+  {
+    command++;
+    length--;
+  }
+
+  found = ConsoleCommandFind(commandTable, command);
+  if ( NOT_FOUND != found )
+  {
+    result = commandTable[found].execute(command);
+    if ( COMMAND_SUCCESS != result )
+    {
+      ConsoleIoSendString("Error: ");
+      ConsoleIoSendData((const uint8_t *) command, length);
+      ConsoleIoSendString(STR_ENDLINE);
+
+      ConsoleIoSendString("Help: ");
+      ConsoleIoSendString(commandTable[found].help);
+      ConsoleIoSendString(STR_ENDLINE);
+    }
+  }
+  else if ( length > 1u ) // shorter than that, it is probably nothing
+  {
+    ConsoleIoSendString("Command not found.");
+    ConsoleIoSendString(STR_ENDLINE);
+  }
 }
 
 // ConsoleResetBuffer
@@ -112,8 +176,26 @@ void ConsoleInit(void)
   uint32_t i;
 
   ConsoleIoInit();
+
+  mCommandCount = 0u;
+  while ( NULL != ConsoleCommandsGetTable()[mCommandCount].name )
+  {
+    mCommandCount++;
+  }
+
   ConsoleIoSendString("Welcome to the Consolinator, your gateway to testing code and hardware.");
   ConsoleIoSendString(STR_ENDLINE);
+
+  // ConsoleCommandFind can't find a command that is out of order, so say which ones are
+  for ( i = 1u ; i < mCommandCount ; i++ )
+  {
+    if ( strcmp(ConsoleCommandsGetTable()[i - 1u].name, ConsoleCommandsGetTable()[i].name) >= 0 )
+    {
+      ConsoleIoSendString("Command table out of order at: ");
+      ConsoleIoSendString(ConsoleCommandsGetTable()[i].name);
+      ConsoleIoSendString(STR_ENDLINE);
+    }
+  }
   ConsoleIoSendString(CONSOLE_PROMPT);
   mReceivedSoFar = 0u;
 
@@ -124,17 +206,42 @@ void ConsoleInit(void)
 
 }
 
+// ConsoleExecuteLine
+// Runs the commands in a line ending with an endline character at line[length]. A line can hold a
+// batch of commands separated by COMMAND_SEPARATOR, which are run one after another. A line
+// starting with it is a comment. Doesn't send a prompt.
+void ConsoleExecuteLine(char line[], uint32_t length)
+{
+  uint32_t commandStart;
+  int32_t  commandLength;
+
+  if ( COMMAND_SEPARATOR != line[0] )
+  {
+    for ( commandStart = 0u ; commandStart < length ; commandStart++ )
+    {
+      if ( COMMAND_SEPARATOR == line[commandStart] )
+      {
+        line[commandStart] = CR_CHAR;
+      }
+    }
+  }
+  commandStart = 0u;
+  while ( commandStart <= length )
+  {
+    commandLength = ConsoleCommandEndline(&line[commandStart], length + 1 - commandStart);
+    ConsoleRunCommand(&line[commandStart], commandLength);
+    commandStart += commandLength + 1;
+  }
+}
+
 // ConsoleProcess
 // Looks for new inputs, checks for endline, then runs the matching command.
 // Call ConsoleProcess from a loop, it will handle commands as they become available
 void ConsoleProcess(void)
 {
-  const sConsoleCommandTable_T* commandTable;
   uint32_t received;
-  uint32_t cmdIndex;
   int32_t  cmdEndline;
-  int32_t  found;
-  eCommandResult_T result;
+  PROFILE_BEGIN(PROFILE_CONSOLE_PROCESS);
 
   ConsoleIoReceive((uint8_t*)&(mReceiveBuffer[mReceivedSoFar]), ( CONSOLE_COMMAND_MAX_LENGTH - mReceivedSoFar ), &received);
   if ( received > 0u || mReceiveBufferNeedsChecking)
@@ -144,47 +251,25 @@ void ConsoleProcess(void)
     cmdEndline = ConsoleCommandEndline(mReceiveBuffer, mReceivedSoFar);
     if ( cmdEndline >= 0 )  // have complete string, find command
     {
-      commandTable = ConsoleCommandsGetTable();
-      cmdIndex = 0u;
-      found = NOT_FOUND;
-      while ( ( NULL != commandTable[cmdIndex].name ) && ( NOT_FOUND == found ) )
-      {
-        if ( ConsoleCommandMatch(commandTable[cmdIndex].name, mReceiveBuffer) )
-        {
-          result = commandTable[cmdIndex].execute(mReceiveBuffer);
-          if ( COMMAND_SUCCESS != result )
-          {
-            ConsoleIoSendString("Error: ");
-            ConsoleIoSendString(mReceiveBuffer);
-
-            ConsoleIoSendString("Help: ");
-            ConsoleIoSendString(commandTable[cmdIndex].help);
-            ConsoleIoSendString(STR_ENDLINE);
-
-          }
-          found = cmdIndex;
-        }
-        else
-        {
-          cmdIndex++;
-
-        }
-      }
-      if ( ( cmdEndline != 0 ) && ( NOT_FOUND == found ) )
+      // While a macro is being recorded the line is stored rather than run
+      if ( !macroRecordLine(mReceiveBuffer, cmdEndline) )
       {
-        if (mReceivedSoFar > 2) /// shorter than that, it is probably nothing
-        {
-          ConsoleIoSendString("Command not found.");
-          ConsoleIoSendString(STR_ENDLINE);
-        }
+        ConsoleExecuteLine(mReceiveBuffer, cmdEndline);
       }
       //reset the buffer by moving over any leftovers and nulling the rest
       // clear up to and including the found end line character
       mReceivedSoFar = ConsoleResetBuffer(mReceiveBuffer, mReceivedSoFar, cmdEndline + 1);
       mReceiveBufferNeedsChecking = mReceivedSoFar > 0 ? true : false;
+      if (mReceiveBufferNeedsChecking)
+      {
+        // Another command may already be in the buffer, come back for it
+        schedulerPost(EVENT_CONSOLE);
+      }
       ConsoleIoSendString(CONSOLE_PROMPT);
     }
   }
+  macroProcess();
+  PROFILE_END(PROFILE_CONSOLE_PROCESS);
 }
 
 // ConsoleParamFindN
@@ -196,7 +281,10 @@ eCommandResult_T ConsoleParamFindN(const char * buffer, const uint8_t parameterN
   eCommandResult_T result = COMMAND_SUCCESS;
 
 
-  while ( ( parameterNumber != parameterIndex ) && ( bufferIndex < CONSOLE_COMMAND_MAX_LENGTH ) )
+  // The command ends at an endline, which in a batch has the next command after it
+  while ( ( parameterNumber != parameterIndex ) && ( bufferIndex < CONSOLE_COMMAND_MAX_LENGTH )
+      && ( LF_CHAR != buffer[bufferIndex] ) && ( CR_CHAR != buffer[bufferIndex] )
+      && ( NULL_CHAR != buffer[bufferIndex] ) )
   {
     if ( PARAMETER_SEPARATER == buffer[bufferIndex] )
     {
@@ -204,7 +292,10 @@ eCommandResult_T ConsoleParamFindN(const char * buffer, const uint8_t parameterN
     }
     bufferIndex++;
   }
-  if  ( CONSOLE_COMMAND_MAX_LENGTH == bufferIndex )
+  // A separator at the end of the command doesn't start a parameter
+  if  ( ( CONSOLE_COMMAND_MAX_LENGTH == bufferIndex )
+      || ( LF_CHAR == buffer[bufferIndex] ) || ( CR_CHAR == buffer[bufferIndex] )
+      || ( NULL_CHAR == buffer[bufferIndex] ) )
   {
     result = COMMAND_PARAMETER_ERROR;
   }
@@ -232,7 +323,7 @@ eCommandResult_T ConsoleReceiveParamInt16(const char * buffer, const uint8_t par
   i = 0;
   charVal = buffer[startIndex + i];
   while ( ( LF_CHAR != charVal ) && ( CR_CHAR != charVal )
-      && ( PARAMETER_SEPARATER != charVal )
+      && ( PARAMETER_SEPARATER != charVal ) && ( NULL_CHAR != charVal )
     && ( i < INT16_MAX_STR_LENGTH ) )
   {
     str[i] = charVal;         // copy the relevant part
@@ -251,6 +342,45 @@ eCommandResult_T ConsoleReceiveParamInt16(const char * buffer, const uint8_t par
   return result;
 }
 
+// ConsoleReceiveParamUInt32
+// Identify and obtain a parameter of type uint32_t, sent in in decimal.
+eCommandResult_T ConsoleReceiveParamUInt32(const char * buffer, const uint8_t parameterNumber, uint32_t* parameterUInt32)
+{
+  uint32_t startIndex = 0;
+  uint32_t i;
+  eCommandResult_T result;
+  char charVal;
+  char str[INT32_MAX_STR_LENGTH];
+
+  result = ConsoleParamFindN(buffer, parameterNumber, &startIndex);
+
+  i = 0;
+  charVal = buffer[startIndex + i];
+  while ( ( LF_CHAR != charVal ) && ( CR_CHAR != charVal )
+      && ( PARAMETER_SEPARATER != charVal ) && ( NULL_CHAR != charVal )
+    && ( i < INT32_MAX_STR_LENGTH ) )
+  {
+    str[i] = charVal;         // copy the relevant part
+    i++;
+    charVal = buffer[startIndex + i];
+  }
+  if ( ( i == 0 ) || ( i == INT32_MAX_STR_LENGTH ) )
+  {
+    result = COMMAND_PARAMETER_ERROR;
+  }
+  if ( COMMAND_SUCCESS == result )
+  {
+    char *end;
+    str[i] = NULL_CHAR;
+    *parameterUInt32 = strtoul(str, &end, 10);
+    if ( ( NULL_CHAR != *end ) || ( '-' == str[0] ) )  // only digits
+    {
+      result = COMMAND_PARAMETER_ERROR;
+    }
+  }
+  return result;
+}
+
 // ConsoleReceiveParamHexUint16
 // Identify and obtain a parameter of type uint16, sent in as hex. This parses the number and does not use
 // a library function to do it.
@@ -2,7 +2,8 @@
 // This is where you add commands:
 //    1. Add a protoype
 //      static eCommandResult_T ConsoleCommandVer(const char buffer[]);
-//    2. Add the command to mConsoleCommandTable
+//    2. Add the command to mConsoleCommandTable, which must be kept sorted by name (in strcmp order)
+//       as commands are looked up with a binary search
 //        {"ver", &ConsoleCommandVer, HELP("Get the version string")},
 //    3. Implement the function, using ConsoleReceiveParam<Type> to get the parameters from the buffer.
 
@@ -15,6 +16,13 @@
 #include "application.h"
 #include "audioTypes.h"
 #include "sequence.h"
+#include "cycles.h"
+#include "audio.h"
+#include "profile.h"
+#include "macro.h"
+#include "ui.h"
+#include "st7789.h"
+#include "screen.h"
 
 #define IGNORE_UNUSED_VARIABLE(x)     if ( &x == &x ) {}
 
@@ -51,43 +59,89 @@ static eCommandResult_T ConsoleCommandGetSequenceNum(const char buffer[]);
 static eCommandResult_T ConsoleCommandStoreSequence(const char buffer[]);
 static eCommandResult_T ConsoleCommandLoadSequence(const char buffer[]);
 static eCommandResult_T ConsoleCommandGetSequenceUsed(const char buffer[]);
+static eCommandResult_T ConsoleCommandSetSequenceLength(const char buffer[]);
+static eCommandResult_T ConsoleCommandSetSong(const char buffer[]);
+static eCommandResult_T ConsoleCommandStartSong(const char buffer[]);
+static eCommandResult_T ConsoleCommandCpu(const char buffer[]);
+static eCommandResult_T ConsoleCommandSched(const char buffer[]);
+static eCommandResult_T ConsoleCommandMixWCET(const char buffer[]);
+static eCommandResult_T ConsoleCommandProfile(const char buffer[]);
+static eCommandResult_T ConsoleCommandTraceDump(const char buffer[]);
+static eCommandResult_T ConsoleCommandStats(const char buffer[]);
+static eCommandResult_T ConsoleCommandTransfer(const char buffer[]);
+static eCommandResult_T ConsoleCommandTxTest(const char buffer[]);
+static eCommandResult_T ConsoleCommandBaud(const char buffer[]);
+static eCommandResult_T ConsoleCommandUiBench(const char buffer[]);
+static eCommandResult_T ConsoleCommandFillBench(const char buffer[]);
+static eCommandResult_T ConsoleCommandFrames(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroRun(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroDelete(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroEnd(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroList(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroRecord(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroShow(const char buffer[]);
+static eCommandResult_T ConsoleCommandMacroStop(const char buffer[]);
+static eCommandResult_T ConsoleCommandBaudConfirm(const char buffer[]);
 
 
 static const sConsoleCommandTable_T mConsoleCommandTable[] =
 {
     {";", &ConsoleCommandComment, HELP("Comment! You do need a space after the semicolon. ")},
-    {"help", &ConsoleCommandHelp, HELP("Lists the commands available")},
-    {"ver", &ConsoleCommandVer, HELP("Get the version string")},
-    {"int", &ConsoleCommandParamExampleInt16, HELP("How to get a signed int16 from params list: int -321")},
-    {"u16h", &ConsoleCommandParamExampleHexUint16, HELP("How to get a hex u16 from the params list: u16h aB12")},
-    {"led", &ConsoleCommandLEDToggle, HELP("Toggle LED")},
-    {"flashid", &ConsoleCommandFlashDeviceId, HELP("Read SPI Flash device ID")},
-    {"record", &ConsoleCommandRecordAudio, HELP("Recprd audio clip")},
-    {"play", &ConsoleCommandPlayAudio, HELP("Play audio clip")},
-    {"playflash", &ConsoleCommandPlayAudioFromFlash, HELP("Play audio clip from Flash")},
-    {"stop", &ConsoleCommandStopAudio, HELP("Stop audio playback")},
-    {"clipset", &ConsoleCommandSetAudioClipNum, HELP("Set audio clip number")},
+    {"baud", &ConsoleCommandBaud, HELP("Get or change baud rate, up to 3000000: baud 921600")},
+    {"baudok", &ConsoleCommandBaudConfirm, HELP("Confirm baud rate change (within 1s)")},
+    {"chrunning", &ConsoleCommandSetAudioChannelRunning, HELP("Set audio channel running state")},
     {"clipget", &ConsoleCommandGetAudioClipNum, HELP("Get audio clip number")},
+    {"clipset", &ConsoleCommandSetAudioClipNum, HELP("Set audio clip number")},
     {"clipused", &ConsoleCommandGetAudioClipUsed, HELP("Get whether audio clip has been used")},
-    {"setclipused", &ConsoleCommandSetAudioClipUsed, HELP("Set audio clip used flag")},
-    {"startsample", &ConsoleCommandSetAudioStartSample, HELP("Set start sample")},
+    {"cpu", &ConsoleCommandCpu, HELP("Show and reset duty cycle and handler latency (us)")},
     {"endsample", &ConsoleCommandSetAudioEndSample, HELP("Set start sample")},
-    {"loop", &ConsoleCommandSetAudioLoop, HELP("Set loop")},
-    {"store", &ConsoleCommandStoreAudio, HELP("Store audio data")},
+    {"fillbench", &ConsoleCommandFillBench, HELP("Time each display fill primitive, then redraw the menu")},
+    {"flashid", &ConsoleCommandFlashDeviceId, HELP("Read SPI Flash device ID")},
+    {"frames", &ConsoleCommandFrames, HELP("Show and reset UI frames rendered and updates skipped")},
+    {"gchparams", &ConsoleCommandGetAudioChannelParams, HELP("Get audio channel params")},
+    {"gchsparams", &ConsoleCommandGetAudioChannelStepParams, HELP("Get audio channel step params")},
+    {"help", &ConsoleCommandHelp, HELP("Lists the commands available")},
+    {"int", &ConsoleCommandParamExampleInt16, HELP("How to get a signed int16 from params list: int -321")},
+    {"led", &ConsoleCommandLEDToggle, HELP("Toggle LED")},
     {"load", &ConsoleCommandLoadAudio, HELP("Load audio data")},
+    {"loop", &ConsoleCommandSetAudioLoop, HELP("Set loop")},
+    {"macro", &ConsoleCommandMacroRun, HELP("Run a macro, $1-$4 are replaced by args: macro setup 3")},
+    {"macrodel", &ConsoleCommandMacroDelete, HELP("Delete a macro")},
+    {"macroend", &ConsoleCommandMacroEnd, HELP("Finish recording a macro")},
+    {"macrolist", &ConsoleCommandMacroList, HELP("List macros")},
+    {"macrorec", &ConsoleCommandMacroRecord, HELP("Record the lines up to macroend as a macro: macrorec setup")},
+    {"macroshow", &ConsoleCommandMacroShow, HELP("Show the lines of a macro")},
+    {"macrostop", &ConsoleCommandMacroStop, HELP("Stop the running macro")},
+    {"mixwcet", &ConsoleCommandMixWCET, HELP("Show and reset interrupt mix WCET and underruns")},
     {"output", &ConsoleCommandOutputAudioData, HELP("Output audio data")},
+    {"play", &ConsoleCommandPlayAudio, HELP("Play audio clip")},
+    {"playflash", &ConsoleCommandPlayAudioFromFlash, HELP("Play audio clip from Flash")},
+    {"prof", &ConsoleCommandProfile, HELP("Show profile zones (cycles), prof r to reset")},
+    {"record", &ConsoleCommandRecordAudio, HELP("Recprd audio clip")},
+    {"sched", &ConsoleCommandSched, HELP("Show handler deadlines (us) and deadline misses")},
     {"schparams", &ConsoleCommandSetAudioChannelParams, HELP("Set audio channel params")},
-    {"gchparams", &ConsoleCommandGetAudioChannelParams, HELP("Get audio channel params")},
-    {"chrunning", &ConsoleCommandSetAudioChannelRunning, HELP("Set audio channel running state")},
-    {"startseq", &ConsoleCommandStartSequence, HELP("Start sequence")},
-    {"stopseq", &ConsoleCommandStopSequence, HELP("Stop sequence")},
     {"schsparams", &ConsoleCommandSetAudioChannelStepParams, HELP("Set audio channel step params")},
-    {"gchsparams", &ConsoleCommandGetAudioChannelStepParams, HELP("Get audio channel step params")},
-    {"seqset", &ConsoleCommandSetSequenceNum, HELP("Set sequence number")},
     {"seqget", &ConsoleCommandGetSequenceNum, HELP("Get sequence number")},
-    {"seqstore", &ConsoleCommandStoreSequence, HELP("Store sequence")},
+    {"seqlen", &ConsoleCommandSetSequenceLength, HELP("Set sequence length in steps")},
     {"seqload", &ConsoleCommandLoadSequence, HELP("Load sequence")},
+    {"seqset", &ConsoleCommandSetSequenceNum, HELP("Set sequence number")},
+    {"seqstore", &ConsoleCommandStoreSequence, HELP("Store sequence")},
     {"seqused", &ConsoleCommandGetSequenceUsed, HELP("Load sequence")},
+    {"setclipused", &ConsoleCommandSetAudioClipUsed, HELP("Set audio clip used flag")},
+    {"song", &ConsoleCommandSetSong, HELP("Set song sequence numbers: song 1 2 2 3")},
+    {"songstart", &ConsoleCommandStartSong, HELP("Start song")},
+    {"startsample", &ConsoleCommandSetAudioStartSample, HELP("Set start sample")},
+    {"startseq", &ConsoleCommandStartSequence, HELP("Start sequence")},
+    {"stats", &ConsoleCommandStats, HELP("Show and reset underrun, overrun and latency counters")},
+    {"stop", &ConsoleCommandStopAudio, HELP("Stop audio playback")},
+    {"stopseq", &ConsoleCommandStopSequence, HELP("Stop sequence")},
+    {"store", &ConsoleCommandStoreAudio, HELP("Store audio data")},
+    {"tracedump", &ConsoleCommandTraceDump, HELP("Send trace buffer as binary (Tools/trace2chrome.py)")},
+    {"txtest", &ConsoleCommandTxTest, HELP("Print help 4 times and count underruns. Start a sequence first")},
+    {"u16h", &ConsoleCommandParamExampleHexUint16, HELP("How to get a hex u16 from the params list: u16h aB12")},
+    {"uibench", &ConsoleCommandUiBench, HELP("Time a menu redraw per pixel, blitted and anti-aliased")},
+    {"ver", &ConsoleCommandVer, HELP("Get the version string")},
+    {"xfer", &ConsoleCommandTransfer, HELP("Switch to binary clip/sequence transfer (Tools/mes_transfer.py)")},
 
   CONSOLE_COMMAND_TABLE_END // must be LAST
 };
@@ -898,7 +952,11 @@ static eCommandResult_T ConsoleCommandStoreSequence(const char buffer[])
 
   ConsoleIoSendString("Storing sequence");
   ConsoleIoSendString(STR_ENDLINE);
-  appStoreSequence();
+  if (!appStoreSequence()) {
+    ConsoleIoSendString("Sequence too large to store");
+    ConsoleIoSendString(STR_ENDLINE);
+    return COMMAND_ERROR;
+  }
   ConsoleIoSendString("Sequence stored");
   ConsoleIoSendString(STR_ENDLINE);
 
@@ -941,6 +999,649 @@ static eCommandResult_T ConsoleCommandGetSequenceUsed(const char buffer[])
 }
 
 
+static eCommandResult_T ConsoleCommandSetSequenceLength(const char buffer[])
+{
+  int16_t parameterInt;
+  eCommandResult_T result;
+  result = ConsoleReceiveParamInt16(buffer, 1, &parameterInt);
+  if (result != COMMAND_SUCCESS)
+  {
+    return result;
+  }
+
+  if (parameterInt < 1 || parameterInt > MAX_NUM_STEPS)
+  {
+    ConsoleIoSendString(STR_ENDLINE);
+    ConsoleIoSendString("Sequence length must be 1-" STRINGIZE(MAX_NUM_STEPS));
+    ConsoleIoSendString(STR_ENDLINE);
+    return COMMAND_PARAMETER_ERROR;
+  }
+
+  appSetSequenceLength((uint8_t)parameterInt);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Sequence length set");
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandSetSong(const char buffer[])
+{
+  uint8_t sequenceNums[MAX_SONG_LENGTH];
+  uint8_t length = 0;
+  int16_t parameterInt;
+  uint32_t startIndex = 0;
+
+  ConsoleIoSendString(STR_ENDLINE);
+
+  while (length < MAX_SONG_LENGTH && ConsoleParamFindN(buffer, length + 1, &startIndex) == COMMAND_SUCCESS)
+  {
+    if (ConsoleReceiveParamInt16(buffer, length + 1, &parameterInt) != COMMAND_SUCCESS ||
+        parameterInt < 1 || parameterInt > NUM_SEQUENCES)
+    {
+      ConsoleIoSendString("Sequence numbers must be 1-" STRINGIZE(NUM_SEQUENCES));
+      ConsoleIoSendString(STR_ENDLINE);
+      return COMMAND_PARAMETER_ERROR;
+    }
+    sequenceNums[length++] = (uint8_t) parameterInt;
+  }
+
+  // More sequence numbers than fit are rejected rather than cut off
+  if ((length == MAX_SONG_LENGTH && ConsoleParamFindN(buffer, length + 1, &startIndex) == COMMAND_SUCCESS) ||
+      !appSetSong(sequenceNums, length))
+  {
+    ConsoleIoSendString("Song must have 1-" STRINGIZE(MAX_SONG_LENGTH) " sequences");
+    ConsoleIoSendString(STR_ENDLINE);
+    return COMMAND_PARAMETER_ERROR;
+  }
+
+  ConsoleIoSendString("Song set");
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return COMMAND_SUCCESS;
+}
+
+
+static eCommandResult_T ConsoleCommandStartSong(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+
+  if (!appStartSong()) {
+    ConsoleIoSendString("No song set, set one with song");
+    ConsoleIoSendString(STR_ENDLINE);
+    return COMMAND_ERROR;
+  }
+
+  ConsoleIoSendString("Song started");
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+static void ConsoleSendCyclesAsUs(uint64_t cycles)
+{
+  ConsoleSendParamUInt32((uint32_t) (cycles / CYCLES_PER_US));
+}
+
+
+static eCommandResult_T ConsoleCommandCpu(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+
+  uint16_t dutyCycle = appGetDutyCycle();
+  ConsoleIoSendString("Duty cycle: ");
+  ConsoleSendParamUInt32(dutyCycle / 10);
+  ConsoleIoSendString(".");
+  ConsoleSendParamUInt32(dutyCycle % 10);
+  ConsoleIoSendString("%");
+  ConsoleIoSendString(STR_ENDLINE);
+
+  for (uint8_t i = 0; i < NUM_SCHEDULER_EVENTS; i++) {
+    const SchedulerHandlerStats_T *stats = appGetHandlerStats(i);
+    if (!stats->name) {
+      continue;
+    }
+    ConsoleIoSendString(stats->name);
+    ConsoleIoSendString(": runs ");
+    ConsoleSendParamUInt32(stats->runs);
+    if (stats->runs > 0) {
+      ConsoleIoSendString(", latency mean ");
+      ConsoleSendCyclesAsUs(stats->totalLatency / stats->runs);
+      ConsoleIoSendString(" max ");
+      ConsoleSendCyclesAsUs(stats->maxLatency);
+      ConsoleIoSendString(", run time mean ");
+      ConsoleSendCyclesAsUs(stats->totalRunTime / stats->runs);
+      ConsoleIoSendString(" max ");
+      ConsoleSendCyclesAsUs(stats->maxRunTime);
+    }
+    ConsoleIoSendString(STR_ENDLINE);
+  }
+
+  appResetHandlerStats();
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandSched(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+
+  for (uint8_t i = 0; i < NUM_SCHEDULER_EVENTS; i++) {
+    const SchedulerHandlerStats_T *stats = appGetHandlerStats(i);
+    uint32_t deadline = appGetHandlerDeadline(i);
+    if (!stats->name || deadline == 0) {
+      continue;
+    }
+    ConsoleIoSendString(stats->name);
+    ConsoleIoSendString(": deadline ");
+    ConsoleSendParamUInt32(deadline);
+    ConsoleIoSendString(", misses ");
+    ConsoleSendParamUInt32(appGetHandlerDeadlineMisses(i));
+    ConsoleIoSendString(STR_ENDLINE);
+  }
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandMixWCET(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+
+#ifdef AUDIO_REFILL_IN_ISR
+  uint32_t wcet = appGetAudioMixWCET();
+  ConsoleIoSendString("Mix WCET: ");
+  ConsoleSendParamUInt32(wcet);
+  ConsoleIoSendString(" cycles (");
+  ConsoleSendParamUInt32(wcet / CYCLES_PER_US);
+  ConsoleIoSendString(" us)");
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Underruns: ");
+  ConsoleSendParamUInt32(appGetAudioMixUnderruns());
+  ConsoleIoSendString(STR_ENDLINE);
+  appResetAudioMixStats();
+#else
+  ConsoleIoSendString("Audio is mixed in the main loop (AUDIO_REFILL_IN_ISR not defined)");
+  ConsoleIoSendString(STR_ENDLINE);
+#endif
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandProfile(const char buffer[])
+{
+  uint32_t startIndex = 0;
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+  ConsoleIoSendString(STR_ENDLINE);
+
+#ifdef PROFILE_ENABLED
+  if (ConsoleParamFindN(buffer, 1, &startIndex) == COMMAND_SUCCESS && buffer[startIndex] == 'r')
+  {
+    profileReset();
+    ConsoleIoSendString("Profile reset");
+    ConsoleIoSendString(STR_ENDLINE);
+    return result;
+  }
+
+  for (uint8_t i = 0; i < NUM_PROFILE_ZONES; i++) {
+    const ProfileZone_T *zone = profileGetZone(i);
+    ConsoleIoSendString(profileGetZoneName(i));
+    ConsoleIoSendString(": count ");
+    ConsoleSendParamUInt32(zone->count);
+    if (zone->count > 0) {
+      ConsoleIoSendString(", min ");
+      ConsoleSendParamUInt32(zone->minCycles);
+      ConsoleIoSendString(", mean ");
+      ConsoleSendParamUInt32((uint32_t) (zone->totalCycles / zone->count));
+      ConsoleIoSendString(", max ");
+      ConsoleSendParamUInt32(zone->maxCycles);
+    }
+    ConsoleIoSendString(STR_ENDLINE);
+
+    // Histogram, one line per non-empty bucket giving the upper bound of the bucket
+    for (uint8_t j = 0; j < PROFILE_NUM_BUCKETS; j++) {
+      if (zone->buckets[j] == 0) {
+        continue;
+      }
+      ConsoleIoSendString("  < 2^");
+      ConsoleSendParamUInt8(j);
+      ConsoleIoSendString(": ");
+      ConsoleSendParamUInt32(zone->buckets[j]);
+      ConsoleIoSendString(STR_ENDLINE);
+    }
+  }
+#else
+    IGNORE_UNUSED_VARIABLE(buffer);
+    IGNORE_UNUSED_VARIABLE(startIndex);
+
+  ConsoleIoSendString("Profiling not enabled (PROFILE_ENABLED not defined)");
+  ConsoleIoSendString(STR_ENDLINE);
+#endif
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandTraceDump(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  appTraceDump();
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandStats(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+  HealthStats_T stats;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  appGetAndClearStats(&stats);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("DAC underruns: ");
+  ConsoleSendParamUInt32(stats.dacUnderruns);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Mic overruns: ");
+  ConsoleSendParamUInt32(stats.micOverruns);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Max refill latency: ");
+  ConsoleSendParamUInt32(stats.maxRefillLatency / CYCLES_PER_US);
+  ConsoleIoSendString(" us");
+  ConsoleIoSendString(STR_ENDLINE);
+  for (uint8_t i = 0; i < NUM_CHANNELS; i++) {
+    ConsoleIoSendString("Max flash read ch ");
+    ConsoleSendParamUInt8(i + 1);
+    ConsoleIoSendString(": ");
+    ConsoleSendParamUInt32(stats.maxFlashReadTime[i] / CYCLES_PER_US);
+    ConsoleIoSendString(" us");
+    ConsoleIoSendString(STR_ENDLINE);
+  }
+  ConsoleIoSendString("Max step lateness: ");
+  ConsoleSendParamUInt32(stats.maxStepLateness);
+  ConsoleIoSendString(" samples");
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandTransfer(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Binary transfer mode");
+  ConsoleIoSendString(STR_ENDLINE);
+  appStartTransfer();
+
+  return result;
+}
+
+
+// ConsoleCommandTxTest
+// Prints the help text several times and then reports the underruns during it. Run while a
+// sequence is playing to check that long output doesn't hold up audio.
+static eCommandResult_T ConsoleCommandTxTest(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+  HealthStats_T stats;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  appGetAndClearStats(&stats);
+  uint32_t start = cyclesNow();
+  for (uint8_t i = 0; i < 4; i++) {
+    ConsoleCommandHelp(buffer);
+  }
+  uint32_t time = cyclesNow() - start;
+  appGetAndClearStats(&stats);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Time: ");
+  ConsoleSendParamUInt32(time / CYCLES_PER_US / 1000);
+  ConsoleIoSendString(" ms");
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("DAC underruns: ");
+  ConsoleSendParamUInt32(stats.dacUnderruns);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Max step lateness: ");
+  ConsoleSendParamUInt32(stats.maxStepLateness);
+  ConsoleIoSendString(" samples");
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+// ConsoleCommandBaud
+// Without a parameter shows the baud rate. With one switches to that rate once the reply has
+// been sent. The change must be confirmed with baudok at the new rate or the old rate returns.
+static eCommandResult_T ConsoleCommandBaud(const char buffer[])
+{
+  uint32_t baudRate;
+  uint32_t startIndex;
+  eCommandResult_T result;
+
+  ConsoleIoSendString(STR_ENDLINE);
+  if (COMMAND_SUCCESS != ConsoleParamFindN(buffer, 1, &startIndex)) {
+    ConsoleIoSendString("Baud rate: ");
+    ConsoleSendParamUInt32(ConsoleIoGetBaudRate());
+    ConsoleIoSendString(STR_ENDLINE);
+    return COMMAND_SUCCESS;
+  }
+  result = ConsoleReceiveParamUInt32(buffer, 1, &baudRate);
+  if (COMMAND_SUCCESS != result || !ConsoleIoBaudRateSupported(baudRate)) {
+    return COMMAND_PARAMETER_ERROR;
+  }
+
+  ConsoleIoSendString("Changing to ");
+  ConsoleSendParamUInt32(baudRate);
+  ConsoleIoSendString(" baud, confirm with baudok");
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSetBaudRate(baudRate);
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandBaudConfirm(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  if (ConsoleIoConfirmBaudRate()) {
+    ConsoleIoSendString("Baud rate confirmed");
+  } else {
+    ConsoleIoSendString("No baud rate change to confirm");
+  }
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+// ConsoleSendBenchTime
+// Sends a line with a name and a time in cycles, shown in microseconds
+static void ConsoleSendBenchTime(const char *name, uint32_t cycles)
+{
+  ConsoleIoSendString(name);
+  ConsoleIoSendString(": ");
+  ConsoleSendParamUInt32(cycles / CYCLES_PER_US);
+  ConsoleIoSendString(" us");
+  ConsoleIoSendString(STR_ENDLINE);
+}
+
+
+// ConsoleCommandUiBench
+// Redraws the current menu with text drawn a pixel at a time, then with whole glyph rows sent by
+// DMA, then in the anti-aliased font, showing how long each took. The redraws don't give way to
+// audio processing.
+static eCommandResult_T ConsoleCommandUiBench(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  screenSetAAFont(false);
+  ST7789_SetGlyphBlit(0);
+  uint32_t pixelTime = uiBenchRedraw();
+  ST7789_SetGlyphBlit(1);
+  uint32_t blitTime = uiBenchRedraw();
+  screenSetAAFont(true);
+  uint32_t aaTime = uiBenchRedraw();
+
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleSendBenchTime("Menu redraw per pixel", pixelTime);
+  ConsoleSendBenchTime("Menu redraw blitted", blitTime);
+  ConsoleSendBenchTime("Menu redraw anti-aliased", aaTime);
+
+  return result;
+}
+
+
+// ConsoleCommandFillBench
+// Times each of the display fill primitives, using a color with different high and low bytes.
+// The fills don't give way to audio processing.
+static eCommandResult_T ConsoleCommandFillBench(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+  uint32_t start;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  start = cyclesNow();
+  ST7789_Fill_Color(BLUE);
+  ConsoleSendBenchTime("Fill_Color 240x320", cyclesNow() - start);
+  start = cyclesNow();
+  ST7789_Fill_Rows(0, 39, RED);
+  ConsoleSendBenchTime("Fill_Rows 240x40", cyclesNow() - start);
+  start = cyclesNow();
+  ST7789_Fill(20, 60, 119, 159, GREEN);
+  ConsoleSendBenchTime("Fill 100x100", cyclesNow() - start);
+  start = cyclesNow();
+  ST7789_Fill(130, 60, 142, 85, YELLOW);
+  ConsoleSendBenchTime("Fill 13x26", cyclesNow() - start);
+  start = cyclesNow();
+  ST7789_DrawFilledRectangle(20, 180, 99, 99, MAGENTA);
+  ConsoleSendBenchTime("DrawFilledRectangle 100x100", cyclesNow() - start);
+  start = cyclesNow();
+  ST7789_DrawPixel_4px(200, 200, BLACK);
+  ConsoleSendBenchTime("DrawPixel_4px", cyclesNow() - start);
+
+  uiBenchRedraw();
+
+  return result;
+}
+
+
+// ConsoleSendMacroResult
+// Sends the reason a macro command failed, returning the console result for the command
+static eCommandResult_T ConsoleSendMacroResult(eMacroResult_T macroResult)
+{
+  switch (macroResult) {
+    case MACRO_OK:
+      return COMMAND_SUCCESS;
+    case MACRO_BAD_NAME:
+      ConsoleIoSendString("Macro names are 1 to 15 characters");
+      break;
+    case MACRO_NOT_FOUND:
+      ConsoleIoSendString("Macro not found");
+      break;
+    case MACRO_NO_SPACE:
+      ConsoleIoSendString("No space for macro");
+      break;
+    case MACRO_BUSY:
+      ConsoleIoSendString("Macro running or being recorded");
+      break;
+  }
+  ConsoleIoSendString(STR_ENDLINE);
+  return COMMAND_ERROR;
+}
+
+
+static eCommandResult_T ConsoleCommandMacroRun(const char buffer[])
+{
+  uint32_t nameStart;
+  uint32_t argsStart;
+  eCommandResult_T result;
+
+  ConsoleIoSendString(STR_ENDLINE);
+  result = ConsoleParamFindN(buffer, 1, &nameStart);
+  if (COMMAND_SUCCESS != result) {
+    return result;
+  }
+  if (COMMAND_SUCCESS != ConsoleParamFindN(buffer, 2, &argsStart)) {
+    return ConsoleSendMacroResult(macroRun(&buffer[nameStart], NULL));
+  }
+  return ConsoleSendMacroResult(macroRun(&buffer[nameStart], &buffer[argsStart]));
+}
+
+
+static eCommandResult_T ConsoleCommandMacroDelete(const char buffer[])
+{
+  uint32_t nameStart;
+  eCommandResult_T result;
+
+  ConsoleIoSendString(STR_ENDLINE);
+  result = ConsoleParamFindN(buffer, 1, &nameStart);
+  if (COMMAND_SUCCESS != result) {
+    return result;
+  }
+  return ConsoleSendMacroResult(macroDelete(&buffer[nameStart]));
+}
+
+
+static eCommandResult_T ConsoleCommandMacroEnd(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  result = ConsoleSendMacroResult(macroRecordEnd());
+  if (COMMAND_SUCCESS == result) {
+    ConsoleIoSendString("Macro stored");
+    ConsoleIoSendString(STR_ENDLINE);
+  }
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandMacroList(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+  char name[MACRO_NAME_MAX_LENGTH + 1];
+  uint16_t length;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  for (uint8_t i = 0; i < NUM_MACRO_SECTORS; i++) {
+    if (macroGetInfo(i, name, &length)) {
+      ConsoleIoSendString(name);
+      ConsoleIoSendString(" ");
+      ConsoleSendParamUInt32(length);
+      ConsoleIoSendString(" bytes");
+      ConsoleIoSendString(STR_ENDLINE);
+    }
+  }
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandMacroRecord(const char buffer[])
+{
+  uint32_t nameStart;
+  eCommandResult_T result;
+
+  ConsoleIoSendString(STR_ENDLINE);
+  result = ConsoleParamFindN(buffer, 1, &nameStart);
+  if (COMMAND_SUCCESS != result) {
+    return result;
+  }
+  result = ConsoleSendMacroResult(macroRecordStart(&buffer[nameStart]));
+  if (COMMAND_SUCCESS == result) {
+    ConsoleIoSendString("Recording, finish with macroend");
+    ConsoleIoSendString(STR_ENDLINE);
+  }
+
+  return result;
+}
+
+
+static eCommandResult_T ConsoleCommandMacroShow(const char buffer[])
+{
+  uint32_t nameStart;
+  eCommandResult_T result;
+
+  ConsoleIoSendString(STR_ENDLINE);
+  result = ConsoleParamFindN(buffer, 1, &nameStart);
+  if (COMMAND_SUCCESS != result) {
+    return result;
+  }
+  return ConsoleSendMacroResult(macroShow(&buffer[nameStart]));
+}
+
+
+static eCommandResult_T ConsoleCommandMacroStop(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  ConsoleIoSendString(STR_ENDLINE);
+  if (macroRunning()) {
+    macroStop();
+    ConsoleIoSendString("Macro stopped");
+  } else {
+    ConsoleIoSendString("No macro running");
+  }
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
+// ConsoleCommandFrames
+// Shows how many UI frames have been rendered, and how many updates were skipped and left to the
+// next frame, since this was last run
+static eCommandResult_T ConsoleCommandFrames(const char buffer[])
+{
+  eCommandResult_T result = COMMAND_SUCCESS;
+  uint32_t rendered;
+  uint32_t skipped;
+
+    IGNORE_UNUSED_VARIABLE(buffer);
+
+  uiGetAndResetFrameStats(&rendered, &skipped);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Frames rendered: ");
+  ConsoleSendParamUInt32(rendered);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString("Updates skipped: ");
+  ConsoleSendParamUInt32(skipped);
+  ConsoleIoSendString(STR_ENDLINE);
+
+  return result;
+}
+
+
 const sConsoleCommandTable_T* ConsoleCommandsGetTable(void)
 {
   return (mConsoleCommandTable);
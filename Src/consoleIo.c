@@ -3,78 +3,298 @@
 
 #include "consoleIo.h"
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
 #include "stm32f4xx_hal.h"
 #include "stm32f4xx_hal_uart.h"
+#include "scheduler.h"
+#include "transfer.h"
 
 // We have to get access to the UART handle defined in main.c
 extern UART_HandleTypeDef huart1;
 
-uint8_t receivedChar;
-// Size of buffer has been slightly arbitrarily chosen.
-// The buffer only needs to large enough to store characters that are received
-// between ConsoleIoReceive calls. It's unlikely this will be as many as 10 characters.
-uint8_t receivedBuffer[10];
-volatile uint8_t nextCharIdx;
+// Input is received by DMA into rxBuffer, which the DMA fills round and round. The UART
+// interrupts when the line goes idle after a burst of characters (and when the buffer is half
+// or completely full), so there is one interrupt per burst rather than one per character.
+// Characters stay in the buffer until they're read, so a pasted script or a binary payload
+// isn't lost as long as it's read within RX_BUFFER_SIZE characters (about 350ms at 115200 baud).
+// Binary transfers (see transfer.c) receive through the same buffer.
+#define RX_BUFFER_SIZE 4096
+static uint8_t rxBuffer[RX_BUFFER_SIZE];
+static volatile uint16_t rxReadPos;
 
+// Baud rates the console can be switched to. USART1 is clocked at 96MHz and oversamples by 16, so
+// each of these is within 0.2% of the rate asked for.
+static const uint32_t baudRates[] = {115200, 230400, 460800, 921600, 1000000, 2000000, 3000000};
+#define NUM_BAUD_RATES (sizeof(baudRates) / sizeof(baudRates[0]))
+// A change of baud rate has to be confirmed at the new rate within BAUD_CONFIRM_MS or the previous
+// rate is restored, so a host that can't use the new rate can still talk to the console.
+#define BAUD_CONFIRM_MS 1000
+static uint32_t previousBaudRate;
+static volatile bool baudConfirmPending;
+static uint32_t baudChangeTick;
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+// Output is queued in txBuffer and sent by DMA so sending doesn't wait for the UART. The
+// DMA sends the bytes from txTail up to txHead (or to the end of the buffer, when they wrap
+// round). If the buffer fills up the sender waits for space, running higher priority
+// handlers (such as audio) while it waits.
+// At 115200 baud the buffer holds about 180ms of output.
+#define TX_BUFFER_SIZE 2048
+static uint8_t txBuffer[TX_BUFFER_SIZE];
+static volatile uint16_t txHead;
+static volatile uint16_t txTail;
+// Number of bytes being sent by DMA, 0 when no console DMA transfer is in progress
+static volatile uint16_t txSending;
+
+
+// txStart
+// Starts sending the queued bytes if there are any and the UART isn't already sending.
+// Called from the main loop and the DMA complete callback.
+static void txStart(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint16_t head = txHead;
+  if (txSending == 0 && head != txTail && huart1.gState == HAL_UART_STATE_READY) {
+    uint16_t length = head > txTail ? head - txTail : TX_BUFFER_SIZE - txTail;
+    if (HAL_UART_Transmit_DMA(&huart1, &txBuffer[txTail], length) == HAL_OK) {
+      txSending = length;
+    }
+  }
+
+  __set_PRIMASK(primask);
+}
+
+
+// txWrite
+// Copies bytes into the transmit buffer, waiting for space when it's full.
+static void txWrite(const uint8_t *data, uint32_t length)
+{
+  while (length > 0) {
+    uint16_t head = txHead;
+    uint16_t space = (txTail + TX_BUFFER_SIZE - head - 1) % TX_BUFFER_SIZE;
+    if (space == 0) {
+      // The DMA may not have been started if the UART was busy
+      txStart();
+      schedulerYield();
+      continue;
+    }
+
+    uint32_t chunk = TX_BUFFER_SIZE - head;
+    if (chunk > space) {
+      chunk = space;
+    }
+    if (chunk > length) {
+      chunk = length;
+    }
+    memcpy(&txBuffer[head], data, chunk);
+    txHead = (head + chunk) % TX_BUFFER_SIZE;
+    data += chunk;
+    length -= chunk;
+  }
+
+  txStart();
+}
+
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
-  // Echo back the received character. This should maybe also use transmit using interrupts.
-  HAL_UART_Transmit(huart, &receivedChar, 1, 10);
+  // Binary transfers also send by DMA, in which case txSending is 0
+  if (txSending) {
+    txTail = (txTail + txSending) % TX_BUFFER_SIZE;
+    txSending = 0;
+  }
+  txStart();
 
-  receivedBuffer[nextCharIdx] = receivedChar;
-  // If we fill the buffer we start again at the beginning.
-  // This would mean we lose characters. If this happens frequently we'd need to increase
-  // the size of the buffer.
-  if (++nextCharIdx == 10) {
-    nextCharIdx = 0;
+  // The transfer waits for each frame to be sent before sending the next
+  if (transferIsActive()) {
+    schedulerPost(EVENT_TRANSFER);
   }
+}
+
 
-  HAL_UART_Receive_IT(huart, &receivedChar, 1);
+static void rxStart(void)
+{
+  rxReadPos = 0;
+  HAL_UARTEx_ReceiveToIdle_DMA(&huart1, rxBuffer, RX_BUFFER_SIZE);
+}
+
+
+static uint16_t rxWritePos(void)
+{
+  uint16_t pos = RX_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(huart1.hdmarx);
+  return pos == RX_BUFFER_SIZE ? 0 : pos;
+}
+
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  // During a binary transfer the received data is for the transfer rather than the console
+  schedulerPost(transferIsActive() ? EVENT_TRANSFER : EVENT_CONSOLE);
+}
+
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  // A receive error such as an overrun stops the DMA. Start again, dropping anything not yet read.
+  if (huart->RxState == HAL_UART_STATE_READY) {
+    rxStart();
+  }
+  // A transmit error also stops the DMA, send the same bytes again
+  if (txSending && huart->gState == HAL_UART_STATE_READY) {
+    txSending = 0;
+    txStart();
+  }
+}
+
+// setBaudRate
+// Waits for any queued output to be sent at the current rate and then switches to the new one.
+// Input not yet read is dropped.
+static void setBaudRate(uint32_t baudRate)
+{
+  while (txHead != txTail || huart1.gState != HAL_UART_STATE_READY) {
+    txStart();
+    schedulerYield();
+  }
+
+  HAL_UART_AbortReceive(&huart1);
+  huart1.Init.BaudRate = baudRate;
+  HAL_UART_Init(&huart1);
+  rxStart();
+}
+
+
+// checkBaudConfirmed
+// Goes back to the previous baud rate if a change hasn't been confirmed in time
+static void checkBaudConfirmed(void)
+{
+  if (baudConfirmPending && HAL_GetTick() - baudChangeTick >= BAUD_CONFIRM_MS) {
+    baudConfirmPending = false;
+    setBaudRate(previousBaudRate);
+    ConsoleIoSendString("\r\nBaud rate not confirmed\r\n> ");
+  }
 }
 
 eConsoleError ConsoleIoInit()
 {
-  HAL_UART_Receive_IT(&huart1, &receivedChar, 1);
+  rxStart();
 
 	return CONSOLE_SUCCESS;
 }
 
-eConsoleError ConsoleIoReceive(uint8_t *buffer, const uint32_t bufferLength, uint32_t *readLength)
+// ConsoleIoReceiveData
+// Takes received bytes out of the receive buffer without echoing them
+eConsoleError ConsoleIoReceiveData(uint8_t *buffer, const uint32_t bufferLength, uint32_t *readLength)
 {
 	uint32_t i = 0;
-	uint8_t ch;
-	
-	// Disable the UART interrupts while we transfer characters from the receivedBuffer
-	// so that we don't risk losing in transit characters.
-	HAL_NVIC_DisableIRQ(USART1_IRQn);
-	ch = receivedBuffer[i];
-	while (( i < bufferLength ) && ( i < nextCharIdx ))
+	uint16_t writePos = rxWritePos();
+	uint16_t readPos = rxReadPos;
+
+	while (( i < bufferLength ) && ( readPos != writePos ))
 	{
-		buffer[i] = (uint8_t) ch;
+		buffer[i] = rxBuffer[readPos];
 		i++;
-		ch = receivedBuffer[i];
+		readPos = (readPos + 1) % RX_BUFFER_SIZE;
 	}
+	rxReadPos = readPos;
 	*readLength = i;
 
-	nextCharIdx = 0;
-	HAL_NVIC_EnableIRQ(USART1_IRQn);
+	return CONSOLE_SUCCESS;
+}
+
+eConsoleError ConsoleIoReceive(uint8_t *buffer, const uint32_t bufferLength, uint32_t *readLength)
+{
+	checkBaudConfirmed();
+
+	// The transfer has the received data while it's active
+	if (transferIsActive())
+	{
+		*readLength = 0;
+		return CONSOLE_SUCCESS;
+	}
+
+	ConsoleIoReceiveData(buffer, bufferLength, readLength);
+
+	// If there wasn't room for everything come back for the rest
+	if (rxReadPos != rxWritePos())
+	{
+		schedulerPost(EVENT_CONSOLE);
+	}
+
+	// Echo back the received characters
+	txWrite(buffer, *readLength);
 
 	return CONSOLE_SUCCESS;
 }
 
 eConsoleError ConsoleIoSendString(const char *buffer)
 {
-  uint32_t i = 0;
-  uint8_t ch;
+  txWrite((const uint8_t *) buffer, strlen(buffer));
+
+	return CONSOLE_SUCCESS;
+}
+
+eConsoleError ConsoleIoSendData(const uint8_t *buffer, const uint32_t length)
+{
+  txWrite(buffer, length);
 
-  ch = (uint8_t) buffer[i];
-  while (ch != '\0')
+	return CONSOLE_SUCCESS;
+}
+
+bool ConsoleIoBaudRateSupported(uint32_t baudRate)
+{
+  for (uint8_t i = 0; i < NUM_BAUD_RATES; i++) {
+    if (baudRates[i] == baudRate) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ConsoleIoSetBaudRate
+// Switches to a new baud rate once the output queued so far has been sent. The change has to be
+// confirmed with ConsoleIoConfirmBaudRate within BAUD_CONFIRM_MS, otherwise the previous rate is
+// restored.
+eConsoleError ConsoleIoSetBaudRate(uint32_t baudRate)
+{
+  if (!ConsoleIoBaudRateSupported(baudRate))
+  {
+    return CONSOLE_ERROR;
+  }
+
+  // If an earlier change is still waiting to be confirmed go back from this one to its previous rate
+  if (!baudConfirmPending)
   {
-    HAL_UART_Transmit(&huart1, &ch, 1, 10);
-    i++;
-    ch = buffer[i];
+    previousBaudRate = huart1.Init.BaudRate;
   }
+  setBaudRate(baudRate);
+  baudChangeTick = HAL_GetTick();
+  baudConfirmPending = true;
 
 	return CONSOLE_SUCCESS;
 }
+
+// ConsoleIoConfirmBaudRate
+// Keeps the current baud rate. Returns false if there was no change waiting to be confirmed.
+bool ConsoleIoConfirmBaudRate(void)
+{
+  bool pending = baudConfirmPending;
+  baudConfirmPending = false;
+  return pending;
+}
+
+uint32_t ConsoleIoGetBaudRate(void)
+{
+  return huart1.Init.BaudRate;
+}
+
+// ConsoleIoTick
+// Called every millisecond from the SysTick interrupt. Runs the console handler when a baud rate
+// change is due to be undone.
+void ConsoleIoTick(void)
+{
+  if (baudConfirmPending && HAL_GetTick() - baudChangeTick == BAUD_CONFIRM_MS) {
+    schedulerPost(EVENT_CONSOLE);
+  }
+}
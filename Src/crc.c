@@ -0,0 +1,18 @@
+#include "crc.h"
+
+// Processing a nibble at a time keeps the table small (32 bytes) while still avoiding
+// the bit-by-bit loop.
+static const uint16_t crcNibbleTable[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+
+uint16_t crc16Update(uint16_t crc, const uint8_t *data, uint16_t length)
+{
+  for (uint16_t i = 0; i < length; i++) {
+    crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (data[i] >> 4)];
+    crc = (crc << 4) ^ crcNibbleTable[(crc >> 12) ^ (data[i] & 0x0F)];
+  }
+  return crc;
+}
@@ -1,5 +1,7 @@
 #include "flash.h"
 #include "main.h"
+#include "profile.h"
+#include "trace.h"
 
 /* SPI Flash used: W25Q32BV
  * 32-MBit
@@ -24,6 +26,12 @@
  *  	- taking a block index, byte data array (to fill), and number of bytes to read as parameters
  *  - Read offset into data aligned to 32KB block (flashReadDataBlockOffset)
  *  	- taking a block index, byte data array (to fill), byte offset, and number of bytes to read as parameters
+ *  - Write data at an offset into a 4KB sector (flashWriteDataSectorOffset)
+ *  	- taking a sector index, byte data array, page aligned byte offset, and number of bytes to write as parameters
+ *  - Read offset into data aligned to 4KB sector (flashReadDataSectorOffset)
+ *  	- taking a sector index, byte data array (to fill), byte offset, and number of bytes to read as parameters
+ *  - Write data at an offset into a 32KB block (flashWriteDataBlockOffset)
+ *  	- taking a block index, byte data array, page aligned byte offset, and number of bytes to write as parameters
  *
  */
 
@@ -104,6 +112,7 @@ static void flashErase(uint8_t cmd, uint32_t address24)
   bufferOut[2] = (address24 >> 8) & 0xFF;
   bufferOut[3] = address24 & 0xFF;
 
+  TRACE(TRACE_FLASH_ERASE_BEGIN, cmd);
   flashWriteEnable();
   HAL_GPIO_WritePin(SPI_NSS_GPIO_Port, SPI_NSS_Pin, GPIO_PIN_RESET);
   if (HAL_SPI_Transmit(spiFlash, bufferOut, sizeof(bufferOut), 1000) !=HAL_OK)
@@ -114,12 +123,14 @@ static void flashErase(uint8_t cmd, uint32_t address24)
 
   // Wait until busy flag is cleared
   while (flashReadStatusRegister() & 0x01);
+  TRACE(TRACE_FLASH_ERASE_END, 0);
 }
 
 
 static void flashWriteData(uint32_t address24, uint8_t *data, uint16_t size)
 {
   uint16_t currentByte = 0;
+  TRACE(TRACE_FLASH_WRITE_BEGIN, size);
 
   uint8_t bufferOut[260];
   bufferOut[0] = CMD_PAGE_PROGRAM;
@@ -152,11 +163,14 @@ static void flashWriteData(uint32_t address24, uint8_t *data, uint16_t size)
     // Wait until busy flag is cleared
     while (flashReadStatusRegister() & 0x01);
   }
+  TRACE(TRACE_FLASH_WRITE_END, 0);
 }
 
 
 void flashReadData(uint32_t address24, uint8_t *data, uint16_t length)
 {
+  PROFILE_BEGIN(PROFILE_FLASH_READ);
+  TRACE(TRACE_FLASH_READ_BEGIN, length);
   uint8_t bufferOut[4];
   bufferOut[0] = CMD_READ;
   bufferOut[1] = (address24 >> 16) & 0xFF;
@@ -173,6 +187,8 @@ void flashReadData(uint32_t address24, uint8_t *data, uint16_t length)
     Error_Handler();
   }
   HAL_GPIO_WritePin(SPI_NSS_GPIO_Port, SPI_NSS_Pin, GPIO_PIN_SET);
+  TRACE(TRACE_FLASH_READ_END, 0);
+  PROFILE_END(PROFILE_FLASH_READ);
 }
 
 
@@ -214,12 +230,34 @@ void flashWriteDataBlock(uint8_t blockIdx, uint8_t *data, uint16_t size)
 }
 
 
+void flashWriteDataSectorOffset(uint16_t sectorIdx, uint8_t *data, uint16_t offset, uint16_t size)
+{
+  // Pages are always programmed in full so offset must be a multiple of the 256 byte page size
+  flashWriteData(sectorIdxToAddress(sectorIdx) + offset, data, size);
+}
+
+
+void flashWriteDataBlockOffset(uint8_t blockIdx, uint8_t *data, uint16_t offset, uint16_t size)
+{
+  // Pages are always programmed in full so offset must be a multiple of the 256 byte page size
+  flashWriteData(blockIdxToAddress(blockIdx) + offset, data, size);
+}
+
+
 void flashReadDataSector(uint16_t sectorIdx, uint8_t *data, uint16_t length)
 {
   flashReadData(sectorIdxToAddress(sectorIdx), data, length);
 }
 
 
+void flashReadDataSectorOffset(uint16_t sectorIdx, uint8_t *data, uint16_t offset, uint16_t length)
+{
+  uint32_t address24 = sectorIdxToAddress(sectorIdx);
+  address24 += offset;
+  flashReadData(address24, data, length);
+}
+
+
 void flashReadDataBlock(uint8_t blockIdx, uint8_t *data, uint16_t length)
 {
   flashReadData(blockIdxToAddress(blockIdx), data, length);
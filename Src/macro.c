@@ -0,0 +1,599 @@
+#include "macro.h"
+#include "flash.h"
+#include "crc.h"
+#include "console.h"
+#include "consoleIo.h"
+#include "consoleCommands.h"
+#include "scheduler.h"
+#include <string.h>
+
+// Console macros
+// "macrorec <name>" starts recording a macro: the console lines that follow are stored instead of
+// being run, until "macroend". "macro <name> [args]" then replays the lines on the device through
+// the same command table as lines typed at the console, so a long setup takes one command instead
+// of a round trip per line.
+//
+// As well as console lines (including ';' batches) a macro can hold these lines, which are only
+// recognised on a line of their own:
+//   repeat <count> [first]   runs the lines up to the matching endrepeat count times
+//   endrepeat
+//   wait <ms>                pauses the macro while everything else carries on
+// In any line $i is replaced by the count of the innermost repeat, which goes up from first (or 1),
+// and $1 to $4 by the arguments the macro was run with. For example
+//   repeat 16
+//   schsparams 1 $i 5 0 16000 1
+//   endrepeat
+//   seqstore
+//
+// The macro runs from the console handler, a few lines each time (see macroProcess), so the console
+// still works while it runs and "macrostop" can stop it.
+//
+// Each macro has a 4KB flash sector. The first page holds a header with the name and the length
+// and CRC of the text, which follows from the second page with '\n' after each line. The header is
+// only written when recording ends, so an unfinished recording leaves an unused sector. There is a
+// sector more than there are macros, so a macro recorded again always has a free sector to go in
+// and its old copy is only erased once the new one has been stored.
+
+// The sectors at the top of the 4MB flash, above the sequences (see sequence.c)
+#define BOTTOM_MACRO_SECTOR (1024 - NUM_MACRO_SECTORS)
+#define FLASH_SECTOR_SIZE 4096
+#define FLASH_PAGE_SIZE 256
+#define MACRO_TEXT_OFFSET FLASH_PAGE_SIZE
+#define MACRO_MAX_LENGTH (FLASH_SECTOR_SIZE - MACRO_TEXT_OFFSET)
+#define MACRO_MAGIC_0 'M'
+#define MACRO_MAGIC_1 'C'
+#define MACRO_VERSION 1
+#define MAX_REPEAT_DEPTH 4
+#define ARG_MAX_LENGTH 15
+#define LINE_MAX_LENGTH (CONSOLE_COMMAND_MAX_LENGTH - 1)
+
+typedef struct {
+  uint8_t magic[2];
+  uint8_t version;
+  // Goes up each time the macro is recorded again, so that the newer copy is used if a power cut
+  // left the old one behind
+  uint8_t generation;
+  uint16_t length;
+  uint16_t crc;
+  char name[MACRO_NAME_MAX_LENGTH + 1];
+} MacroHeader_T;
+
+typedef struct {
+  // Text position of the line after the repeat
+  uint16_t bodyPos;
+  uint32_t remaining;
+  uint32_t count;
+} Repeat_T;
+
+static bool recording = false;
+static uint8_t recordIdx;
+static MacroHeader_T recordHeader;
+static uint8_t recordPage[FLASH_PAGE_SIZE];
+static uint16_t recordLength;
+static uint16_t recordCrc;
+static bool recordFull;
+
+static bool running = false;
+static uint8_t runIdx;
+static uint16_t runLength;
+static uint16_t runPos;
+static Repeat_T repeats[MAX_REPEAT_DEPTH];
+static uint8_t repeatDepth;
+// Number of repeats being skipped because their count was 0
+static uint8_t skipDepth;
+static volatile bool waiting = false;
+static uint32_t waitStart;
+static uint32_t waitTime;
+static char runArgs[MACRO_MAX_ARGS][ARG_MAX_LENGTH + 1];
+
+static char rawLine[LINE_MAX_LENGTH + 1];
+static char line[CONSOLE_COMMAND_MAX_LENGTH + 1];
+
+
+static uint16_t macroSector(uint8_t macroIdx)
+{
+  return BOTTOM_MACRO_SECTOR + macroIdx;
+}
+
+
+// wordLength
+// Length of the word (a name or a command) at the start of text
+static uint8_t wordLength(const char *text)
+{
+  uint8_t length = 0;
+  while (text[length] != ' ' && text[length] != '\r' && text[length] != '\n' && text[length] != '\0'
+      && length < 255) {
+    length++;
+  }
+  return length;
+}
+
+
+static bool isWord(const char *text, const char *word)
+{
+  uint8_t length = wordLength(text);
+  return length == strlen(word) && memcmp(text, word, length) == 0;
+}
+
+
+static bool readHeader(uint8_t macroIdx, MacroHeader_T *header)
+{
+  flashReadDataSector(macroSector(macroIdx), (uint8_t *) header, sizeof(MacroHeader_T));
+  return header->magic[0] == MACRO_MAGIC_0 && header->magic[1] == MACRO_MAGIC_1 &&
+      header->version == MACRO_VERSION && header->length <= MACRO_MAX_LENGTH;
+}
+
+
+static bool nameValid(const char *name)
+{
+  uint8_t length = wordLength(name);
+  return length > 0 && length <= MACRO_NAME_MAX_LENGTH;
+}
+
+
+// findMacro
+// Returns the index of the newest macro with the name at the start of text, or -1
+static int8_t findMacro(const char *name)
+{
+  MacroHeader_T header;
+  uint8_t length = wordLength(name);
+  int8_t macroIdx = -1;
+  uint8_t generation = 0;
+
+  if (!nameValid(name)) {
+    return -1;
+  }
+  for (uint8_t i = 0; i < NUM_MACRO_SECTORS; i++) {
+    if (readHeader(i, &header) && memcmp(header.name, name, length) == 0 && header.name[length] == '\0' &&
+        (macroIdx < 0 || (int8_t) (header.generation - generation) > 0)) {
+      macroIdx = i;
+      generation = header.generation;
+    }
+  }
+  return macroIdx;
+}
+
+
+static uint16_t textCrc(uint8_t macroIdx, uint16_t length)
+{
+  uint16_t crc = CRC16_INIT;
+  uint16_t pos = 0;
+
+  while (pos < length) {
+    uint16_t chunk = length - pos > LINE_MAX_LENGTH ? LINE_MAX_LENGTH : length - pos;
+    flashReadDataSectorOffset(macroSector(macroIdx), (uint8_t *) rawLine, MACRO_TEXT_OFFSET + pos, chunk);
+    crc = crc16Update(crc, (uint8_t *) rawLine, chunk);
+    pos += chunk;
+  }
+  return crc;
+}
+
+
+// macroRecordStart
+// Starts recording a macro into a free sector. Any macro with the same name is kept until the new
+// one is stored by macroRecordEnd.
+eMacroResult_T macroRecordStart(const char *name)
+{
+  MacroHeader_T header;
+  int8_t macroIdx = -1;
+  uint8_t used = 0;
+
+  if (recording || running) {
+    return MACRO_BUSY;
+  }
+  if (!nameValid(name)) {
+    return MACRO_BAD_NAME;
+  }
+
+  for (uint8_t i = 0; i < NUM_MACRO_SECTORS; i++) {
+    if (readHeader(i, &header)) {
+      used++;
+    } else if (macroIdx < 0) {
+      macroIdx = i;
+    }
+  }
+  int8_t replaceIdx = findMacro(name);
+  if (macroIdx < 0 || (replaceIdx < 0 && used >= NUM_MACROS)) {
+    return MACRO_NO_SPACE;
+  }
+
+  flashEraseSector(macroSector(macroIdx));
+
+  memset(&recordHeader, 0, sizeof(recordHeader));
+  memcpy(recordHeader.name, name, wordLength(name));
+  if (replaceIdx >= 0 && readHeader(replaceIdx, &header)) {
+    recordHeader.generation = header.generation + 1;
+  }
+  recordIdx = macroIdx;
+  recordLength = 0;
+  recordCrc = CRC16_INIT;
+  recordFull = false;
+  recording = true;
+  return MACRO_OK;
+}
+
+
+static void recordAppend(const uint8_t *data, uint16_t length)
+{
+  recordCrc = crc16Update(recordCrc, data, length);
+
+  while (length > 0) {
+    uint16_t pagePos = recordLength % FLASH_PAGE_SIZE;
+    uint16_t chunk = FLASH_PAGE_SIZE - pagePos;
+    if (chunk > length) {
+      chunk = length;
+    }
+    memcpy(&recordPage[pagePos], data, chunk);
+    recordLength += chunk;
+    data += chunk;
+    length -= chunk;
+
+    if (recordLength % FLASH_PAGE_SIZE == 0) {
+      flashWriteDataSectorOffset(macroSector(recordIdx), recordPage,
+          MACRO_TEXT_OFFSET + recordLength - FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+    }
+  }
+}
+
+
+// macroRecordLine
+// Called by the console for each line it receives. While recording stores the line and returns
+// true, except for macroend, which is left for the console to run.
+bool macroRecordLine(const char *line, uint32_t length)
+{
+  if (!recording || isWord(line, "macroend")) {
+    return false;
+  }
+  if (length == 0) {
+    return true;
+  }
+
+  if (recordLength + length + 1 > MACRO_MAX_LENGTH) {
+    recordFull = true;
+    return true;
+  }
+  recordAppend((const uint8_t *) line, length);
+  recordAppend((const uint8_t *) "\n", 1);
+  return true;
+}
+
+
+// macroRecordEnd
+// Stores the macro being recorded, then erases any older macro with the same name. If it didn't
+// fit nothing is stored, the older macro is kept and MACRO_NO_SPACE returned.
+eMacroResult_T macroRecordEnd(void)
+{
+  MacroHeader_T header;
+
+  if (!recording) {
+    return MACRO_NOT_FOUND;
+  }
+  recording = false;
+
+  if (recordFull) {
+    flashEraseSector(macroSector(recordIdx));
+    return MACRO_NO_SPACE;
+  }
+
+  // The rest of the last page is programmed with zeros, after the end of the text
+  if (recordLength % FLASH_PAGE_SIZE != 0) {
+    flashWriteDataSectorOffset(macroSector(recordIdx), recordPage,
+        MACRO_TEXT_OFFSET + recordLength - recordLength % FLASH_PAGE_SIZE, recordLength % FLASH_PAGE_SIZE);
+  }
+
+  recordHeader.magic[0] = MACRO_MAGIC_0;
+  recordHeader.magic[1] = MACRO_MAGIC_1;
+  recordHeader.version = MACRO_VERSION;
+  recordHeader.length = recordLength;
+  recordHeader.crc = recordCrc;
+  flashWriteDataSector(macroSector(recordIdx), (uint8_t *) &recordHeader, sizeof(recordHeader));
+
+  for (uint8_t i = 0; i < NUM_MACRO_SECTORS; i++) {
+    if (i != recordIdx && readHeader(i, &header) &&
+        memcmp(header.name, recordHeader.name, sizeof(header.name)) == 0) {
+      flashEraseSector(macroSector(i));
+    }
+  }
+  return MACRO_OK;
+}
+
+
+bool macroRecording(void)
+{
+  return recording;
+}
+
+
+// macroRun
+// Starts replaying a macro. args holds up to MACRO_MAX_ARGS words for $1 to $4, and can be NULL.
+eMacroResult_T macroRun(const char *name, const char *args)
+{
+  MacroHeader_T header;
+
+  if (recording || running) {
+    return MACRO_BUSY;
+  }
+  if (!nameValid(name)) {
+    return MACRO_BAD_NAME;
+  }
+  int8_t macroIdx = findMacro(name);
+  if (macroIdx < 0 || !readHeader(macroIdx, &header) || textCrc(macroIdx, header.length) != header.crc) {
+    return MACRO_NOT_FOUND;
+  }
+
+  memset(runArgs, 0, sizeof(runArgs));
+  for (uint8_t i = 0; args && i < MACRO_MAX_ARGS; i++) {
+    while (*args == ' ') {
+      args++;
+    }
+    uint8_t length = wordLength(args);
+    if (length == 0) {
+      break;
+    }
+    memcpy(runArgs[i], args, length > ARG_MAX_LENGTH ? ARG_MAX_LENGTH : length);
+    args += length;
+  }
+
+  runIdx = macroIdx;
+  runLength = header.length;
+  runPos = 0;
+  repeatDepth = 0;
+  skipDepth = 0;
+  waiting = false;
+  running = true;
+  schedulerPost(EVENT_CONSOLE);
+  return MACRO_OK;
+}
+
+
+static void runFinish(const char *message)
+{
+  running = false;
+  waiting = false;
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString(message);
+  ConsoleIoSendString(STR_ENDLINE);
+  ConsoleIoSendString(CONSOLE_PROMPT);
+}
+
+
+void macroStop(void)
+{
+  running = false;
+  waiting = false;
+}
+
+
+bool macroRunning(void)
+{
+  return running;
+}
+
+
+// expandLine
+// Copies rawLine to line replacing $i and $1 to $4, and ends it with a CR like a console line.
+// Returns the length without the CR.
+static uint16_t expandLine(uint16_t rawLength)
+{
+  uint16_t length = 0;
+  char number[11];
+
+  memset(line, 0, sizeof(line));
+  for (uint16_t i = 0; i < rawLength; i++) {
+    const char *substitute = NULL;
+    if (rawLine[i] == '$' && i + 1 < rawLength) {
+      char name = rawLine[i + 1];
+      if (name == 'i' && repeatDepth > 0) {
+        uint32_t count = repeats[repeatDepth - 1].count;
+        uint8_t digits = 0;
+        do {
+          digits++;
+        } while ((count /= 10) > 0);
+        count = repeats[repeatDepth - 1].count;
+        number[digits] = '\0';
+        while (digits > 0) {
+          number[--digits] = '0' + count % 10;
+          count /= 10;
+        }
+        substitute = number;
+      } else if (name >= '1' && name < '1' + MACRO_MAX_ARGS) {
+        substitute = runArgs[name - '1'];
+      }
+    }
+
+    if (substitute) {
+      while (*substitute && length < LINE_MAX_LENGTH) {
+        line[length++] = *substitute++;
+      }
+      i++;
+    } else if (length < LINE_MAX_LENGTH) {
+      line[length++] = rawLine[i];
+    }
+  }
+  line[length] = '\r';
+  return length;
+}
+
+
+// runLine
+// Runs the next line of the macro. Returns false at the end of the macro or on an error.
+static bool runLine(void)
+{
+  uint32_t value;
+
+  if (runPos >= runLength) {
+    runFinish("Macro done");
+    return false;
+  }
+
+  uint16_t rawLength = runLength - runPos > LINE_MAX_LENGTH ? LINE_MAX_LENGTH : runLength - runPos;
+  flashReadDataSectorOffset(macroSector(runIdx), (uint8_t *) rawLine, MACRO_TEXT_OFFSET + runPos, rawLength);
+  char *end = memchr(rawLine, '\n', rawLength);
+  if (end) {
+    rawLength = end - rawLine;
+  }
+  runPos += rawLength + 1;
+  uint16_t length = expandLine(rawLength);
+
+  if (isWord(line, "repeat")) {
+    if (skipDepth > 0) {
+      skipDepth++;
+      return true;
+    }
+    if (repeatDepth == MAX_REPEAT_DEPTH || ConsoleReceiveParamUInt32(line, 1, &value) != COMMAND_SUCCESS) {
+      runFinish("Macro stopped: bad repeat");
+      return false;
+    }
+    if (value == 0) {
+      skipDepth = 1;
+      return true;
+    }
+    Repeat_T *repeat = &repeats[repeatDepth++];
+    repeat->bodyPos = runPos;
+    repeat->remaining = value;
+    if (ConsoleReceiveParamUInt32(line, 2, &repeat->count) != COMMAND_SUCCESS) {
+      repeat->count = 1;
+    }
+    return true;
+  }
+
+  if (isWord(line, "endrepeat")) {
+    if (skipDepth > 0) {
+      skipDepth--;
+    } else if (repeatDepth > 0) {
+      Repeat_T *repeat = &repeats[repeatDepth - 1];
+      if (--repeat->remaining > 0) {
+        repeat->count++;
+        runPos = repeat->bodyPos;
+      } else {
+        repeatDepth--;
+      }
+    }
+    return true;
+  }
+
+  if (skipDepth > 0) {
+    return true;
+  }
+
+  if (isWord(line, "wait")) {
+    if (ConsoleReceiveParamUInt32(line, 1, &value) == COMMAND_SUCCESS && value > 0) {
+      waitStart = HAL_GetTick();
+      waitTime = value;
+      waiting = true;
+    }
+    return true;
+  }
+
+  ConsoleExecuteLine(line, length);
+  return true;
+}
+
+
+// macroProcess
+// Called by the console handler. Runs lines of the running macro until it has to wait or other
+// handlers need to run, posting EVENT_CONSOLE to carry on.
+void macroProcess(void)
+{
+  if (!running) {
+    return;
+  }
+  if (waiting) {
+    if (HAL_GetTick() - waitStart < waitTime) {
+      return;
+    }
+    waiting = false;
+  }
+
+  while (running && !waiting && runLine()) {
+    if (schedulerShouldYield()) {
+      schedulerPost(EVENT_CONSOLE);
+      return;
+    }
+  }
+}
+
+
+// macroTick
+// Called every millisecond from the SysTick interrupt. Runs the console handler when a wait ends.
+void macroTick(void)
+{
+  if (running && waiting && HAL_GetTick() - waitStart == waitTime) {
+    schedulerPost(EVENT_CONSOLE);
+  }
+}
+
+
+// macroDelete
+// Erases a macro, and any older copy of it left by a power cut while it was being stored
+eMacroResult_T macroDelete(const char *name)
+{
+  if (recording || running) {
+    return MACRO_BUSY;
+  }
+  if (!nameValid(name)) {
+    return MACRO_BAD_NAME;
+  }
+  int8_t macroIdx = findMacro(name);
+  if (macroIdx < 0) {
+    return MACRO_NOT_FOUND;
+  }
+  while (macroIdx >= 0) {
+    flashEraseSector(macroSector(macroIdx));
+    macroIdx = findMacro(name);
+  }
+  return MACRO_OK;
+}
+
+
+// macroGetInfo
+// Gets the name (at least MACRO_NAME_MAX_LENGTH + 1 chars) and text length of the macro in sector
+// macroIdx, 0 to NUM_MACRO_SECTORS - 1. Returns false if the sector is unused.
+bool macroGetInfo(uint8_t macroIdx, char *name, uint16_t *length)
+{
+  MacroHeader_T header;
+
+  if (macroIdx >= NUM_MACRO_SECTORS || !readHeader(macroIdx, &header)) {
+    return false;
+  }
+  memcpy(name, header.name, MACRO_NAME_MAX_LENGTH);
+  name[MACRO_NAME_MAX_LENGTH] = '\0';
+  *length = header.length;
+  return true;
+}
+
+
+// macroShow
+// Sends the text of a macro to the console, one line per line
+eMacroResult_T macroShow(const char *name)
+{
+  MacroHeader_T header;
+
+  if (running) {
+    return MACRO_BUSY;
+  }
+  if (!nameValid(name)) {
+    return MACRO_BAD_NAME;
+  }
+  int8_t macroIdx = findMacro(name);
+  if (macroIdx < 0 || !readHeader(macroIdx, &header)) {
+    return MACRO_NOT_FOUND;
+  }
+
+  uint16_t pos = 0;
+  while (pos < header.length) {
+    uint16_t chunk = header.length - pos > LINE_MAX_LENGTH ? LINE_MAX_LENGTH : header.length - pos;
+    flashReadDataSectorOffset(macroSector(macroIdx), (uint8_t *) rawLine, MACRO_TEXT_OFFSET + pos, chunk);
+    uint16_t start = 0;
+    for (uint16_t i = 0; i < chunk; i++) {
+      if (rawLine[i] == '\n') {
+        ConsoleIoSendData((uint8_t *) &rawLine[start], i - start);
+        ConsoleIoSendString(STR_ENDLINE);
+        start = i + 1;
+      }
+    }
+    ConsoleIoSendData((uint8_t *) &rawLine[start], chunk - start);
+    pos += chunk;
+  }
+  return MACRO_OK;
+}
@@ -0,0 +1,71 @@
+#include "profile.h"
+
+#ifdef PROFILE_ENABLED
+#include <stddef.h>
+
+static const char *zoneNames[NUM_PROFILE_ZONES] = {
+  "audioProcessData",
+  "flashReadData",
+  "step",
+  "uiUpdate",
+  "ST7789 text",
+  "ConsoleProcess"
+};
+
+static ProfileZone_T zones[NUM_PROFILE_ZONES];
+
+
+void profileRecord(eProfileZone_T zone, uint32_t cycles)
+{
+  ProfileZone_T *z = &zones[zone];
+
+  if (z->count == 0 || cycles < z->minCycles) {
+    z->minCycles = cycles;
+  }
+  if (cycles > z->maxCycles) {
+    z->maxCycles = cycles;
+  }
+  z->count++;
+  z->totalCycles += cycles;
+
+  // Bucket n holds times of 2^(n-1) to 2^n - 1 cycles, bucket 0 is for 0 cycles.
+  // The top bucket also holds anything longer.
+  uint8_t bucket = 32 - __CLZ(cycles);
+  if (bucket >= PROFILE_NUM_BUCKETS) {
+    bucket = PROFILE_NUM_BUCKETS - 1;
+  }
+  z->buckets[bucket]++;
+}
+
+
+const char * profileGetZoneName(eProfileZone_T zone)
+{
+  if (zone >= NUM_PROFILE_ZONES) {
+    return NULL;
+  }
+  return zoneNames[zone];
+}
+
+
+const ProfileZone_T * profileGetZone(eProfileZone_T zone)
+{
+  if (zone >= NUM_PROFILE_ZONES) {
+    return NULL;
+  }
+  return &zones[zone];
+}
+
+
+void profileReset(void)
+{
+  for (uint8_t i = 0; i < NUM_PROFILE_ZONES; i++) {
+    zones[i].count = 0;
+    zones[i].minCycles = 0;
+    zones[i].maxCycles = 0;
+    zones[i].totalCycles = 0;
+    for (uint8_t j = 0; j < PROFILE_NUM_BUCKETS; j++) {
+      zones[i].buckets[j] = 0;
+    }
+  }
+}
+#endif
@@ -0,0 +1,276 @@
+#include "scheduler.h"
+#include "main.h"
+#include "cycles.h"
+#include "trace.h"
+
+// Event driven main loop
+// Interrupt handlers post events rather than the main loop polling every module. Each time
+// round the loop the highest priority pending event is taken and its handler run, so a
+// higher priority event posted while a handler is running is handled next. When nothing is
+// pending the core sleeps until the next interrupt.
+//
+// Timing is measured with the DWT cycle counter. Idle time is the time spent in WFI, which
+// gives the duty cycle (the fraction of time spent doing something), and for each event we
+// record how long it waited to be handled and how long its handler took.
+//
+// Handlers run to completion so a handler with a deadline can only be late by as much as the
+// handler running when its event is posted. Long work (such as redrawing a menu) is split
+// into pieces using schedulerShouldYield. Events can be given a deadline, measured from the
+// event being posted to its handler finishing, and each miss is counted.
+
+static volatile uint32_t pendingEvents = 0;
+static uint32_t postTimes[NUM_SCHEDULER_EVENTS];
+static schedulerHandler handlers[NUM_SCHEDULER_EVENTS];
+static SchedulerHandlerStats_T handlerStats[NUM_SCHEDULER_EVENTS];
+static uint32_t deadlines[NUM_SCHEDULER_EVENTS];
+static volatile uint32_t deadlineMisses[NUM_SCHEDULER_EVENTS];
+
+static uint8_t currentIdx = NUM_SCHEDULER_EVENTS;
+static uint32_t currentStart = 0;
+
+static uint64_t totalCycles = 0;
+static uint64_t idleCycles = 0;
+static uint32_t lastCycles = 0;
+
+
+static uint8_t eventToIdx(uint32_t event)
+{
+  uint8_t idx = 0;
+  while (!(event & 1) && idx < NUM_SCHEDULER_EVENTS) {
+    event >>= 1;
+    idx++;
+  }
+  return idx;
+}
+
+
+void schedulerInit(void)
+{
+  cyclesInit();
+  lastCycles = cyclesNow();
+}
+
+
+void schedulerRegister(eSchedulerEvent_T event, const char *name, schedulerHandler handler)
+{
+  uint8_t idx = eventToIdx(event);
+  if (idx >= NUM_SCHEDULER_EVENTS) {
+    return;
+  }
+  handlers[idx] = handler;
+  handlerStats[idx].name = name;
+}
+
+
+// schedulerPost
+// Marks events as pending. Safe to call from interrupt handlers and the main loop.
+void schedulerPost(uint32_t events)
+{
+  uint32_t now = cyclesNow();
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  // Latency is measured from when an event is first posted, not from later posts of an
+  // event that's already pending
+  uint32_t newEvents = events & ~pendingEvents;
+  for (uint8_t i = 0; i < NUM_SCHEDULER_EVENTS; i++) {
+    if (newEvents & (1 << i)) {
+      postTimes[i] = now;
+    }
+  }
+  pendingEvents |= events;
+
+  __set_PRIMASK(primask);
+}
+
+
+static void schedulerUpdateTotal(void)
+{
+  uint32_t now = cyclesNow();
+  totalCycles += now - lastCycles;
+  lastCycles = now;
+}
+
+
+// schedulerDispatch
+// Runs the handler for one event and records its timing.
+static void schedulerDispatch(uint8_t idx, uint32_t postTime)
+{
+  if (!handlers[idx]) {
+    return;
+  }
+
+  SchedulerHandlerStats_T *stats = &handlerStats[idx];
+  uint32_t start = cyclesNow();
+  currentIdx = idx;
+  currentStart = start;
+  TRACE(TRACE_HANDLER_BEGIN, idx);
+  handlers[idx]();
+  TRACE(TRACE_HANDLER_END, idx);
+  currentIdx = NUM_SCHEDULER_EVENTS;
+  uint32_t runTime = cyclesNow() - start;
+  uint32_t latency = start - postTime;
+
+  if (deadlines[idx] && latency + runTime > deadlines[idx]) {
+    deadlineMisses[idx]++;
+  }
+
+  stats->runs++;
+  stats->totalLatency += latency;
+  if (latency > stats->maxLatency) {
+    stats->maxLatency = latency;
+  }
+  stats->totalRunTime += runTime;
+  if (runTime > stats->maxRunTime) {
+    stats->maxRunTime = runTime;
+  }
+}
+
+
+// schedulerRun
+// Runs the event handlers. This never returns.
+void schedulerRun(void)
+{
+  while (1) {
+    schedulerUpdateTotal();
+
+    // Interrupts are disabled between checking for pending events and sleeping so an event
+    // posted in between can't be missed. WFI still wakes on a pending interrupt with
+    // interrupts disabled, and the interrupt is taken as soon as they're enabled again.
+    __disable_irq();
+    uint32_t events = pendingEvents;
+    if (events == 0) {
+      uint32_t sleepStart = cyclesNow();
+      __WFI();
+      idleCycles += cyclesNow() - sleepStart;
+      __enable_irq();
+      continue;
+    }
+
+    uint32_t event = events & -events;
+    uint8_t idx = eventToIdx(event);
+    pendingEvents &= ~event;
+    uint32_t postTime = postTimes[idx];
+    __enable_irq();
+
+    schedulerDispatch(idx, postTime);
+  }
+}
+
+
+// schedulerYield
+// Runs any pending handlers with a higher priority than the running handler and then
+// returns to it. For handlers that have to wait for something (such as space in a buffer)
+// and can't easily be split into pieces. The waiting handler's run time includes the time
+// spent in the handlers run here.
+void schedulerYield(void)
+{
+  uint8_t idx = currentIdx;
+  uint32_t start = currentStart;
+  if (idx >= NUM_SCHEDULER_EVENTS) {
+    return;
+  }
+
+  while (1) {
+    __disable_irq();
+    uint32_t events = pendingEvents & ((1 << idx) - 1);
+    if (events == 0) {
+      __enable_irq();
+      break;
+    }
+    uint32_t event = events & -events;
+    uint8_t higherIdx = eventToIdx(event);
+    pendingEvents &= ~event;
+    uint32_t postTime = postTimes[higherIdx];
+    __enable_irq();
+
+    schedulerDispatch(higherIdx, postTime);
+  }
+
+  currentIdx = idx;
+  currentStart = start;
+}
+
+
+// schedulerShouldYield
+// Returns true if the running handler should stop and post its event again to carry on
+// later, because a higher priority event is pending or its time slice has been used.
+bool schedulerShouldYield(void)
+{
+  if (currentIdx >= NUM_SCHEDULER_EVENTS) {
+    return false;
+  }
+  if (pendingEvents & ((1 << currentIdx) - 1)) {
+    return true;
+  }
+  return cyclesNow() - currentStart > SCHEDULER_TIME_SLICE_US * CYCLES_PER_US;
+}
+
+
+void schedulerSetDeadline(eSchedulerEvent_T event, uint32_t deadlineUs)
+{
+  uint8_t idx = eventToIdx(event);
+  if (idx >= NUM_SCHEDULER_EVENTS) {
+    return;
+  }
+  deadlines[idx] = deadlineUs * CYCLES_PER_US;
+}
+
+
+// schedulerGetDeadline
+// Returns the deadline of a handler in microseconds, or 0 if it doesn't have one.
+uint32_t schedulerGetDeadline(uint8_t handlerIdx)
+{
+  if (handlerIdx >= NUM_SCHEDULER_EVENTS) {
+    return 0;
+  }
+  return deadlines[handlerIdx] / CYCLES_PER_US;
+}
+
+
+// schedulerGetDeadlineMisses
+// Returns the number of times a handler has finished after its deadline since startup.
+uint32_t schedulerGetDeadlineMisses(uint8_t handlerIdx)
+{
+  if (handlerIdx >= NUM_SCHEDULER_EVENTS) {
+    return 0;
+  }
+  return deadlineMisses[handlerIdx];
+}
+
+
+// schedulerGetDutyCycle
+// Returns the fraction of time spent outside of sleep since the stats were last reset,
+// in tenths of a percent.
+uint16_t schedulerGetDutyCycle(void)
+{
+  schedulerUpdateTotal();
+  if (totalCycles == 0) {
+    return 0;
+  }
+  return (uint16_t) (((totalCycles - idleCycles) * 1000) / totalCycles);
+}
+
+
+const SchedulerHandlerStats_T * schedulerGetHandlerStats(uint8_t handlerIdx)
+{
+  if (handlerIdx >= NUM_SCHEDULER_EVENTS) {
+    return NULL;
+  }
+  return &handlerStats[handlerIdx];
+}
+
+
+void schedulerResetStats(void)
+{
+  for (uint8_t i = 0; i < NUM_SCHEDULER_EVENTS; i++) {
+    handlerStats[i].runs = 0;
+    handlerStats[i].maxLatency = 0;
+    handlerStats[i].totalLatency = 0;
+    handlerStats[i].maxRunTime = 0;
+    handlerStats[i].totalRunTime = 0;
+  }
+  schedulerUpdateTotal();
+  totalCycles = 0;
+  idleCycles = 0;
+}
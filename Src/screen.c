@@ -0,0 +1,116 @@
+#include "screen.h"
+#include "st7789.h"
+
+// Screen fields
+// A field is a line of character cells at a fixed place on the display, holding what the cells
+// show (or will once the field is drawn). Setting a field's text compares it with the cells and
+// marks the ones that change as dirty, and drawing the field sends each run of dirty cells as one
+// window of glyphs. So a value changing from 1234 to 1235 sends one glyph, and switching between
+// menus only sends the cells that differ rather than clearing and redrawing the whole panel.
+//
+// Cells past the end of the text are set to spaces, which draw as the background colour. A new
+// field is taken to be showing spaces, so it must be on a cleared part of the display.
+//
+// Text is drawn in the anti-aliased version of the font (made by Tools/fontgen.py), which has the
+// same cell size, unless the 1bpp font is chosen with screenSetAAFont.
+
+#define SCREEN_FONT Font_11x18
+#define SCREEN_AA_FONT AAFont_11x18
+
+static bool aaFont = true;
+
+
+// screenSetAAFont
+// Chooses between the anti-aliased and 1bpp fonts, so the two can be compared. Fields already
+// drawn keep the font they were drawn in until they change or are invalidated.
+void screenSetAAFont(bool enable)
+{
+  aaFont = enable;
+}
+
+
+void screenFieldInit(ScreenField_T *field, uint16_t x, uint16_t y, uint8_t numCells, uint16_t bgColor)
+{
+  field->x = x;
+  field->y = y;
+  field->numCells = numCells > SCREEN_FIELD_MAX_CELLS ? SCREEN_FIELD_MAX_CELLS : numCells;
+  field->color = bgColor;
+  field->bgColor = bgColor;
+  field->dirty = 0;
+  for (uint8_t i = 0; i < field->numCells; i++) {
+    field->cells[i] = ' ';
+  }
+}
+
+
+// screenFieldSet
+// Sets the text of a field, marking the cells that look different as dirty. Text longer than the
+// field is cut short.
+void screenFieldSet(ScreenField_T *field, const char *str, uint16_t color, uint16_t bgColor)
+{
+  bool bgChanged = bgColor != field->bgColor;
+  bool colorChanged = color != field->color;
+
+  field->color = color;
+  field->bgColor = bgColor;
+  for (uint8_t i = 0; i < field->numCells; i++) {
+    char ch = *str ? *str++ : ' ';
+    // Spaces are all background, so they don't change with the text colour
+    if (ch != field->cells[i] || bgChanged || (colorChanged && ch != ' ')) {
+      field->cells[i] = ch;
+      field->dirty |= 1u << i;
+    }
+  }
+}
+
+
+// screenFieldInvalidate
+// Marks the whole field for drawing, for when something else has drawn over it
+void screenFieldInvalidate(ScreenField_T *field)
+{
+  field->dirty = (1u << field->numCells) - 1;
+}
+
+
+bool screenFieldDirty(const ScreenField_T *field)
+{
+  return field->dirty != 0;
+}
+
+
+// screenFieldDraw
+// Starts sending the dirty cells of a field to the display, a run of neighbouring cells at a time.
+// Runs are sent without waiting for the display, so this returns false if the display was still
+// busy before the whole field was started. Call it again once the display has finished (see
+// ST7789_SetAsyncCallback) to carry on.
+bool screenFieldDraw(ScreenField_T *field)
+{
+  uint8_t i = 0;
+
+  while (field->dirty) {
+    if (!(field->dirty & (1u << i))) {
+      i++;
+      continue;
+    }
+    uint8_t start = i;
+    uint32_t runMask = 0;
+    while (i < field->numCells && (field->dirty & (1u << i))) {
+      runMask |= 1u << i;
+      i++;
+    }
+    uint8_t started;
+    if (aaFont) {
+      started = ST7789_WriteCharsAAAsync(field->x + start * SCREEN_AA_FONT.width, field->y, &field->cells[start],
+          i - start, &SCREEN_AA_FONT, field->color, field->bgColor);
+    } else {
+      started = ST7789_WriteCharsAsync(field->x + start * SCREEN_FONT.width, field->y, &field->cells[start],
+          i - start, SCREEN_FONT, field->color, field->bgColor);
+    }
+    if (!started) {
+      return false;
+    }
+    // The cells have been copied, so any that change from now on are drawn again
+    field->dirty &= ~runMask;
+  }
+  return true;
+}
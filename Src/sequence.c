@@ -3,6 +3,11 @@
 #include "audioTypes.h"
 #include "audio.h"
 #include "flash.h"
+#include "crc.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "trace.h"
+#include <string.h>
 
 // Step timer config
 // BPM: 90
@@ -19,15 +24,148 @@
 // per 32K block by the number of clips and dividing by the number of pages per 4K sector
 #define BOTTOM_SEQUENCE_SECTOR (NUM_CLIPS * 128) / 16
 
-static uint8_t sequenceIdx = 0;
-static bool sequenceUsed = false;
+// Legacy layout, one sequence per 4KB flash sector starting at BOTTOM_SEQUENCE_SECTOR.
+// Each bar of steps is the raw ChannelParams_T array in its own pair of pages, with the length
+// after them. Sequences stored before lengths were added have an erased (0xFF) length byte and
+// are a single bar of NUM_STEPS steps.
+// These sectors are only read now, as a fallback for sequences that haven't been stored again
+// since the packed format was introduced.
+#define LEGACY_BAR_FLASH_SIZE 512
+#define LEGACY_LENGTH_FLASH_OFFSET (NUM_BARS * LEGACY_BAR_FLASH_SIZE)
+
+// Packed sequence records
+// Each sequence has a fixed slot of whole pages big enough for the largest record (a full length
+// sequence with sample points on every step), so 3 sequences share one 4KB sector and 150
+// sequences need 50 sectors (instead of 150). The slots follow the legacy sectors.
+// Storing to a slot that isn't blank rebuilds its sector through a scratch sector so the other
+// sequences in the sector are preserved (see slotWrite). The last page of the scratch sector is
+// a journal saying which sector the image in it belongs to, so a rebuild cut short by a power
+// loss is finished at the next boot.
+//
+// Record layout (multi-byte values are little endian):
+//   0  'S' 'Q'        magic
+//   2  version        RECORD_VERSION
+//   3  length         sequence length in steps (1-64)
+//   4  payload size   number of bytes of entries that follow the header
+//   6  CRC            CRC-16 of bytes 0-5 and the payload
+//   8  entries        one per non-empty step (clip number > 0), ordered by channel then step
+//
+// Entry layout:
+//   0  channel index (top 2 bits) | step index (bottom 6 bits)
+//   1  clip number (bottom 7 bits) | extended flag (top bit)
+// Entries with the extended flag set are followed by 4 bytes, otherwise the step plays the whole
+// clip without looping:
+//   2  start sample
+//   4  end sample (bottom 15 bits) | loop flag (top bit)
+#define FLASH_SECTOR_SIZE 4096
+#define FLASH_PAGE_SIZE 256
+#define SEQUENCE_SLOT_SIZE ((SEQUENCE_RECORD_MAX_SIZE + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE)
+#define SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / SEQUENCE_SLOT_SIZE)
+#define BOTTOM_SLOT_SECTOR (BOTTOM_SEQUENCE_SECTOR + NUM_SEQUENCES)
+#define NUM_SLOT_SECTORS ((NUM_SEQUENCES + SLOTS_PER_SECTOR - 1) / SLOTS_PER_SECTOR)
+#define SCRATCH_SECTOR (BOTTOM_SLOT_SECTOR + NUM_SLOT_SECTORS)
+
+// Scratch sector journal page: magic, slot sector index, CRC-16 of the image before it
+#define JOURNAL_OFFSET (SLOTS_PER_SECTOR * SEQUENCE_SLOT_SIZE)
+#define JOURNAL_MAGIC_0 'S'
+#define JOURNAL_MAGIC_1 'J'
+#if JOURNAL_OFFSET + FLASH_PAGE_SIZE > FLASH_SECTOR_SIZE
+#error "No room for the journal page after the slots"
+#endif
+
+#define RECORD_MAGIC_0 'S'
+#define RECORD_MAGIC_1 'Q'
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 8
+#define RECORD_CRC_OFFSET 6
+#define RECORD_MAX_PAYLOAD_SIZE (SEQUENCE_RECORD_MAX_SIZE - RECORD_HEADER_SIZE)
+#define ENTRY_SIZE 2
+#define ENTRY_EXTENDED_SIZE 6
+#define ENTRY_EXTENDED_FLAG 0x80
+#define ENTRY_LOOP_FLAG 0x8000
+// Number of record bytes read from flash per loader step
+#define LOAD_CHUNK_SIZE 64
+// Size of the live record hit queue, must be a power of two
+#define RECORD_QUEUE_SIZE 16
+// Number of step fields a parameter lock can change (RECORD_CLIP, RECORD_START and RECORD_END)
+#define RECORD_NUM_FIELDS 3
+
+typedef struct {
+  ChannelParams_T steps[NUM_BARS][NUM_CHANNELS][NUM_STEPS];
+  uint8_t length;
+  uint8_t sequenceIdx;
+  bool used;
+} Pattern_T;
+
+typedef enum {
+  LOAD_IDLE     = 0u,
+  LOAD_RECORD   = 1u,
+  LOAD_LEGACY   = 2u,
+  LOAD_READY    = 3u
+} eLoadState_T;
+
+// Incremental record decoder. Bytes are fed in as they're read from flash and each entry is
+// validated and written into the pattern as soon as it's complete. If anything doesn't validate
+// (including the CRC once the last byte has been read) the pattern is reset to empty.
+typedef struct {
+  Pattern_T *pattern;
+  eLoadState_T state;
+  uint16_t offset;
+  uint16_t recordSize;
+  uint16_t crc;
+  uint8_t header[RECORD_HEADER_SIZE];
+  uint8_t entry[ENTRY_EXTENDED_SIZE];
+  uint8_t entryPos;
+  uint8_t legacyBar;
+} SequenceLoader_T;
+
+// Two pattern buffers. The active pattern is the one played by step() and edited through the UI
+// and console. When a song is playing the other buffer is filled with the next sequence of the song
+// in the background (one loader step per sequenceProcess call) so that moving to it at the end of
+// the pattern is just a buffer swap and no flash access is needed on the step path.
+static Pattern_T patterns[2];
+static uint8_t activePattern = 0;
+static SequenceLoader_T loader;
+static uint8_t recordBuffer[SEQUENCE_SLOT_SIZE];
+
 static uint16_t currStep = 0;
 static bool sequencePlaying = false;
-// stepParams size, if NUM_CHANNELS=3 and NUM_STEPS=16 and ChannelParams_T size=48 bytes
-// 3*16*48 = 2304 bytes
-// 2304 bytes = 9 flash pages (256 bytes) which means each sequence will use one 4KiB sector (16 pages)
-// as this is the smallest number of pages we can erase at a time.
-static ChannelParams_T stepParams[NUM_CHANNELS][NUM_STEPS];
+
+static uint8_t songSequenceIdxs[MAX_SONG_LENGTH];
+static uint8_t songLength = 0;
+static uint8_t songPos = 0;
+static bool songPlaying = false;
+
+// Live record hits are queued by the UI and applied by step() before it fires the triggers for
+// the current step. The queue has a single producer and a single consumer so the head and tail
+// are each only written by one side and no locking is needed.
+typedef struct {
+  uint8_t channelIdx;
+  uint8_t stepIdx;
+  uint8_t fields;
+  bool hit;
+  ChannelParams_T params;
+} RecordEvent_T;
+
+static RecordEvent_T recordQueue[RECORD_QUEUE_SIZE];
+static volatile uint8_t recordQueueHead = 0;
+static volatile uint8_t recordQueueTail = 0;
+
+// Parameter locks aren't queued. Each channel has a slot per field holding the latest value and
+// the step it's for, so sweeping a value with the encoder can't fill the queue. Like the queue the
+// slots need no locking: sequenceRecord() makes a slot's count odd while it writes the slot and
+// even again when it's done, and step() applies a slot when its count is even and has changed
+// since it last applied it, leaving one that is being written or changes while being read to the
+// next step.
+typedef struct {
+  volatile uint16_t count;
+  uint8_t stepIdx;
+  uint16_t value;
+} RecordLock_T;
+
+static RecordLock_T recordLocks[NUM_CHANNELS][RECORD_NUM_FIELDS];
+// Only written by step()
+static uint16_t recordLocksApplied[NUM_CHANNELS][RECORD_NUM_FIELDS];
 
 static uiChangeCallback uiChangeCB;
 
@@ -38,46 +176,521 @@ static uint16_t sequenceIdxToFlashSectorIdx(uint8_t sequenceIdx)
 }
 
 
+static uint16_t sequenceIdxToSlotSectorIdx(uint8_t sequenceIdx)
+{
+  return BOTTOM_SLOT_SECTOR + sequenceIdx / SLOTS_PER_SECTOR;
+}
+
+
+static uint16_t sequenceIdxToSlotOffset(uint8_t sequenceIdx)
+{
+  return (sequenceIdx % SLOTS_PER_SECTOR) * SEQUENCE_SLOT_SIZE;
+}
+
+
+static Pattern_T * activePatternPtr(void)
+{
+  return &patterns[activePattern];
+}
+
+
+static Pattern_T * nextPatternPtr(void)
+{
+  return &patterns[activePattern ^ 1];
+}
+
+
+static void patternClear(Pattern_T *pattern)
+{
+  for (uint8_t barIdx=0; barIdx < NUM_BARS; barIdx++) {
+    for (uint8_t channelIdx=0; channelIdx < NUM_CHANNELS; channelIdx++) {
+      for (uint8_t stepIdx=0; stepIdx < NUM_STEPS; stepIdx++) {
+        pattern->steps[barIdx][channelIdx][stepIdx].clipNum = 0;
+        pattern->steps[barIdx][channelIdx][stepIdx].startSample = 0;
+        pattern->steps[barIdx][channelIdx][stepIdx].endSample = MAX_SAMPLE_IDX;
+        pattern->steps[barIdx][channelIdx][stepIdx].loop = false;
+      }
+    }
+  }
+  pattern->length = NUM_STEPS;
+  pattern->used = false;
+}
+
+
+static void legacyLoadBar(Pattern_T *pattern, uint8_t barIdx)
+{
+  flashReadDataSectorOffset(
+      sequenceIdxToFlashSectorIdx(pattern->sequenceIdx),
+      (uint8_t *) pattern->steps[barIdx],
+      barIdx * LEGACY_BAR_FLASH_SIZE,
+      sizeof(pattern->steps[barIdx])
+  );
+}
+
+
+static void legacyLoadLength(Pattern_T *pattern)
+{
+  uint8_t length;
+  flashReadDataSectorOffset(
+      sequenceIdxToFlashSectorIdx(pattern->sequenceIdx),
+      &length,
+      LEGACY_LENGTH_FLASH_OFFSET,
+      1
+  );
+
+  // If we load sequence data from an empty flash sector all bytes will be
+  // initialised to 0xFF. We can check this by checking the clip number of
+  // the first step of the first channel.
+  if (pattern->steps[0][0][0].clipNum == 255) {
+    // We need to reset all values if we've loading an empty sequence
+    patternClear(pattern);
+    return;
+  }
+
+  pattern->used = true;
+  pattern->length = length;
+  if (length == 255) {
+    // Sequence stored before variable lengths were added. Only the first bar is valid.
+    ChannelParams_T firstBar[NUM_CHANNELS][NUM_STEPS];
+    memcpy(firstBar, pattern->steps[0], sizeof(firstBar));
+    patternClear(pattern);
+    memcpy(pattern->steps[0], firstBar, sizeof(firstBar));
+    pattern->used = true;
+  } else if (length < 1 || length > MAX_NUM_STEPS) {
+    pattern->length = NUM_STEPS;
+  }
+}
+
+
+static void loaderFail(void)
+{
+  patternClear(loader.pattern);
+  loader.state = LOAD_READY;
+}
+
+
+static void loaderCheckHeader(void)
+{
+  uint8_t *header = loader.header;
+
+  if (header[0] == 0xFF && header[1] == 0xFF) {
+    // Blank slot, fall back to the legacy sector for this sequence
+    loader.state = LOAD_LEGACY;
+    loader.legacyBar = 0;
+    return;
+  }
+
+  uint16_t payloadSize = header[4] | (header[5] << 8);
+  if (header[0] != RECORD_MAGIC_0 || header[1] != RECORD_MAGIC_1 ||
+      header[2] != RECORD_VERSION ||
+      header[3] < 1 || header[3] > MAX_NUM_STEPS ||
+      payloadSize > RECORD_MAX_PAYLOAD_SIZE) {
+    loaderFail();
+    return;
+  }
+
+  loader.pattern->length = header[3];
+  loader.recordSize = RECORD_HEADER_SIZE + payloadSize;
+  loader.crc = crc16Update(CRC16_INIT, header, RECORD_CRC_OFFSET);
+}
+
+
+static bool loaderApplyEntry(void)
+{
+  uint8_t *entry = loader.entry;
+  uint8_t channelIdx = entry[0] >> 6;
+  uint8_t stepIdx = entry[0] & 0x3F;
+  ChannelParams_T params;
+
+  params.clipNum = entry[1] & ~ENTRY_EXTENDED_FLAG;
+  if (entry[1] & ENTRY_EXTENDED_FLAG) {
+    uint16_t endWord = entry[4] | (entry[5] << 8);
+    params.startSample = entry[2] | (entry[3] << 8);
+    params.endSample = endWord & ~ENTRY_LOOP_FLAG;
+    params.loop = (endWord & ENTRY_LOOP_FLAG) != 0;
+  } else {
+    params.startSample = 0;
+    params.endSample = MAX_SAMPLE_IDX;
+    params.loop = false;
+  }
+
+  if (channelIdx >= NUM_CHANNELS || stepIdx >= loader.pattern->length ||
+      params.clipNum < 1 || params.clipNum > NUM_CLIPS ||
+      params.endSample > MAX_SAMPLE_IDX || params.startSample >= params.endSample) {
+    return false;
+  }
+
+  loader.pattern->steps[stepIdx / NUM_STEPS][channelIdx][stepIdx % NUM_STEPS] = params;
+  return true;
+}
+
+
+static void loaderFinish(void)
+{
+  uint16_t storedCrc = loader.header[RECORD_CRC_OFFSET] | (loader.header[RECORD_CRC_OFFSET + 1] << 8);
+  if (loader.entryPos != 0 || loader.crc != storedCrc) {
+    loaderFail();
+    return;
+  }
+  loader.pattern->used = true;
+  loader.state = LOAD_READY;
+}
+
+
+static void loaderFeed(const uint8_t *data, uint16_t length)
+{
+  for (uint16_t i = 0; i < length && loader.state == LOAD_RECORD; i++) {
+    if (loader.offset < RECORD_HEADER_SIZE) {
+      loader.header[loader.offset++] = data[i];
+      if (loader.offset == RECORD_HEADER_SIZE) {
+        loaderCheckHeader();
+        if (loader.state == LOAD_RECORD && loader.offset == loader.recordSize) {
+          loaderFinish();
+        }
+      }
+      continue;
+    }
+
+    loader.crc = crc16Update(loader.crc, &data[i], 1);
+    loader.offset++;
+    loader.entry[loader.entryPos++] = data[i];
+    if ((loader.entryPos == ENTRY_SIZE && !(loader.entry[1] & ENTRY_EXTENDED_FLAG)) ||
+        loader.entryPos == ENTRY_EXTENDED_SIZE) {
+      loader.entryPos = 0;
+      if (!loaderApplyEntry()) {
+        loaderFail();
+        return;
+      }
+    }
+    if (loader.offset == loader.recordSize) {
+      loaderFinish();
+    }
+  }
+}
+
+
+static void loaderStart(Pattern_T *pattern, uint8_t sequenceIdx)
+{
+  patternClear(pattern);
+  pattern->sequenceIdx = sequenceIdx;
+  loader.pattern = pattern;
+  loader.state = LOAD_RECORD;
+  loader.offset = 0;
+  loader.recordSize = SEQUENCE_SLOT_SIZE;
+  loader.entryPos = 0;
+}
+
+
+// loaderStep
+// Does one bounded piece of loading work. Returns true once the pattern is loaded.
+static bool loaderStep(void)
+{
+  uint8_t chunk[LOAD_CHUNK_SIZE];
+
+  switch (loader.state) {
+  case LOAD_RECORD: {
+    uint16_t chunkSize = loader.recordSize - loader.offset;
+    if (chunkSize > LOAD_CHUNK_SIZE) {
+      chunkSize = LOAD_CHUNK_SIZE;
+    }
+    flashReadDataSectorOffset(
+        sequenceIdxToSlotSectorIdx(loader.pattern->sequenceIdx),
+        chunk,
+        sequenceIdxToSlotOffset(loader.pattern->sequenceIdx) + loader.offset,
+        chunkSize
+    );
+    loaderFeed(chunk, chunkSize);
+    break;
+  }
+  case LOAD_LEGACY:
+    if (loader.legacyBar < NUM_BARS) {
+      legacyLoadBar(loader.pattern, loader.legacyBar++);
+    } else {
+      legacyLoadLength(loader.pattern);
+      loader.state = LOAD_READY;
+    }
+    break;
+  default:
+    break;
+  }
+
+  return loader.state == LOAD_READY || loader.state == LOAD_IDLE;
+}
+
+
+static void patternLoad(Pattern_T *pattern, uint8_t sequenceIdx)
+{
+  loaderStart(pattern, sequenceIdx);
+  while (!loaderStep());
+  loader.state = LOAD_IDLE;
+}
+
+
+// sequenceSerialise
+// Packs the pattern into recordBuffer. Returns the record size, or 0 if the record wouldn't fit
+// (which SEQUENCE_RECORD_MAX_SIZE allows for, so shouldn't happen).
+static uint16_t sequenceSerialise(const Pattern_T *pattern)
+{
+  uint16_t offset = RECORD_HEADER_SIZE;
+
+  for (uint8_t channelIdx=0; channelIdx < NUM_CHANNELS; channelIdx++) {
+    for (uint8_t stepIdx=0; stepIdx < pattern->length; stepIdx++) {
+      ChannelParams_T params = pattern->steps[stepIdx / NUM_STEPS][channelIdx][stepIdx % NUM_STEPS];
+      if (params.clipNum == 0) {
+        continue;
+      }
+      bool extended = params.startSample != 0 || params.endSample != MAX_SAMPLE_IDX || params.loop;
+      if (offset + (extended ? ENTRY_EXTENDED_SIZE : ENTRY_SIZE) > SEQUENCE_RECORD_MAX_SIZE) {
+        return 0;
+      }
+      recordBuffer[offset++] = (channelIdx << 6) | stepIdx;
+      recordBuffer[offset++] = params.clipNum | (extended ? ENTRY_EXTENDED_FLAG : 0);
+      if (extended) {
+        uint16_t endWord = params.endSample | (params.loop ? ENTRY_LOOP_FLAG : 0);
+        recordBuffer[offset++] = params.startSample & 0xFF;
+        recordBuffer[offset++] = params.startSample >> 8;
+        recordBuffer[offset++] = endWord & 0xFF;
+        recordBuffer[offset++] = endWord >> 8;
+      }
+    }
+  }
+
+  uint16_t payloadSize = offset - RECORD_HEADER_SIZE;
+  recordBuffer[0] = RECORD_MAGIC_0;
+  recordBuffer[1] = RECORD_MAGIC_1;
+  recordBuffer[2] = RECORD_VERSION;
+  recordBuffer[3] = pattern->length;
+  recordBuffer[4] = payloadSize & 0xFF;
+  recordBuffer[5] = payloadSize >> 8;
+  uint16_t crc = crc16Update(CRC16_INIT, recordBuffer, RECORD_CRC_OFFSET);
+  crc = crc16Update(crc, &recordBuffer[RECORD_HEADER_SIZE], payloadSize);
+  recordBuffer[RECORD_CRC_OFFSET] = crc & 0xFF;
+  recordBuffer[RECORD_CRC_OFFSET + 1] = crc >> 8;
+
+  return offset;
+}
+
+
+static bool flashPageBlank(const uint8_t *page)
+{
+  for (uint16_t i = 0; i < FLASH_PAGE_SIZE; i++) {
+    if (page[i] != 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// scratchCopyBack
+// Replaces a slot sector with the image in the scratch sector, then erases the scratch sector so
+// its journal page no longer applies.
+static void scratchCopyBack(uint16_t sectorIdx)
+{
+  uint8_t page[FLASH_PAGE_SIZE];
+
+  flashEraseSector(sectorIdx);
+  for (uint16_t offset = 0; offset < JOURNAL_OFFSET; offset += FLASH_PAGE_SIZE) {
+    flashReadDataSectorOffset(SCRATCH_SECTOR, page, offset, FLASH_PAGE_SIZE);
+    if (!flashPageBlank(page)) {
+      flashWriteDataSectorOffset(sectorIdx, page, offset, FLASH_PAGE_SIZE);
+    }
+  }
+  flashEraseSector(SCRATCH_SECTOR);
+}
+
+
+// slotWrite
+// Writes a record to a sequence slot. A blank slot is programmed in place. Otherwise, as erasing
+// clears the whole sector, the new image of the sector (the other slots and the record) is built
+// in the scratch sector and the journal page is written after it. Only then is the slot sector
+// erased and the image copied back. Until the journal page is complete the slot sector hasn't
+// been touched, and once it is slotRecover can finish the copy.
+static void slotWrite(uint8_t sequenceIdx, uint8_t *record, uint16_t size)
+{
+  uint8_t page[FLASH_PAGE_SIZE];
+  uint16_t sectorIdx = sequenceIdxToSlotSectorIdx(sequenceIdx);
+  uint16_t slotOffset = sequenceIdxToSlotOffset(sequenceIdx);
+  bool slotBlank = true;
+
+  for (uint16_t offset = slotOffset; offset < slotOffset + SEQUENCE_SLOT_SIZE; offset += FLASH_PAGE_SIZE) {
+    flashReadDataSectorOffset(sectorIdx, page, offset, FLASH_PAGE_SIZE);
+    if (!flashPageBlank(page)) {
+      slotBlank = false;
+    }
+  }
+
+  if (slotBlank) {
+    flashWriteDataSectorOffset(sectorIdx, record, slotOffset, size);
+    return;
+  }
+
+  uint16_t crc = CRC16_INIT;
+  flashEraseSector(SCRATCH_SECTOR);
+  for (uint16_t offset = 0; offset < JOURNAL_OFFSET; offset += FLASH_PAGE_SIZE) {
+    if (offset >= slotOffset && offset < slotOffset + SEQUENCE_SLOT_SIZE) {
+      uint16_t recordPos = offset - slotOffset;
+      memset(page, 0xFF, FLASH_PAGE_SIZE);
+      if (recordPos < size) {
+        memcpy(page, &record[recordPos], size - recordPos < FLASH_PAGE_SIZE ? size - recordPos : FLASH_PAGE_SIZE);
+      }
+    } else {
+      flashReadDataSectorOffset(sectorIdx, page, offset, FLASH_PAGE_SIZE);
+    }
+    crc = crc16Update(crc, page, FLASH_PAGE_SIZE);
+    if (!flashPageBlank(page)) {
+      flashWriteDataSectorOffset(SCRATCH_SECTOR, page, offset, FLASH_PAGE_SIZE);
+    }
+  }
+
+  memset(page, 0xFF, FLASH_PAGE_SIZE);
+  page[0] = JOURNAL_MAGIC_0;
+  page[1] = JOURNAL_MAGIC_1;
+  page[2] = sectorIdx & 0xFF;
+  page[3] = sectorIdx >> 8;
+  page[4] = crc & 0xFF;
+  page[5] = crc >> 8;
+  flashWriteDataSectorOffset(SCRATCH_SECTOR, page, JOURNAL_OFFSET, FLASH_PAGE_SIZE);
+
+  scratchCopyBack(sectorIdx);
+}
+
+
+// slotRecover
+// Finishes a slotWrite that was cut short by a power loss. If the scratch sector holds a journal
+// page and the image before it matches the journal's CRC, the slot sector it names may have been
+// erased and not yet copied back, so the copy is done again. Otherwise the slot sector hasn't
+// been touched and the scratch sector is just cleared.
+static void slotRecover(void)
+{
+  uint8_t page[FLASH_PAGE_SIZE];
+
+  flashReadDataSectorOffset(SCRATCH_SECTOR, page, JOURNAL_OFFSET, FLASH_PAGE_SIZE);
+  if (flashPageBlank(page)) {
+    return;
+  }
+
+  uint16_t sectorIdx = page[2] | (page[3] << 8);
+  uint16_t storedCrc = page[4] | (page[5] << 8);
+  bool valid = page[0] == JOURNAL_MAGIC_0 && page[1] == JOURNAL_MAGIC_1 &&
+      sectorIdx >= BOTTOM_SLOT_SECTOR && sectorIdx < SCRATCH_SECTOR;
+
+  uint16_t crc = CRC16_INIT;
+  for (uint16_t offset = 0; valid && offset < JOURNAL_OFFSET; offset += FLASH_PAGE_SIZE) {
+    flashReadDataSectorOffset(SCRATCH_SECTOR, page, offset, FLASH_PAGE_SIZE);
+    crc = crc16Update(crc, page, FLASH_PAGE_SIZE);
+  }
+
+  if (valid && crc == storedCrc) {
+    scratchCopyBack(sectorIdx);
+  } else {
+    flashEraseSector(SCRATCH_SECTOR);
+  }
+}
+
+
+static void songQueueNextLoad(void)
+{
+  uint8_t nextPos = songPos + 1;
+  if (nextPos >= songLength) {
+    nextPos = 0;
+  }
+  loaderStart(nextPatternPtr(), songSequenceIdxs[nextPos]);
+  schedulerPost(EVENT_SEQUENCE);
+}
+
+
+static void songAdvance(void)
+{
+  // If the next pattern hasn't finished loading in time we repeat the current pattern
+  // rather than block the step path waiting for flash.
+  if (loader.pattern != nextPatternPtr() || loader.state != LOAD_READY) {
+    return;
+  }
+
+  activePattern ^= 1;
+  if (++songPos >= songLength) {
+    songPos = 0;
+  }
+  songQueueNextLoad();
+  uiChangeCB(UI_SEQ | UI_SEQ_CLIP | UI_SEQ_CLIP_START | UI_SEQ_CLIP_END | UI_SEQ_LENGTH);
+}
+
+
 void sequenceInit(uiChangeCallback _uiChangeCB)
 {
   uiChangeCB = _uiChangeCB;
+  slotRecover();
   sequenceLoad();
 }
 
 
+// sequenceProcess
+// Loads the next pattern of a playing song in the background. This is the handler for
+// EVENT_SEQUENCE, which is posted again until the pattern has loaded.
+// Only one chunk is read from flash per call to keep the time spent away from audio processing short.
+void sequenceProcess(void)
+{
+  if (loader.state != LOAD_RECORD && loader.state != LOAD_LEGACY) return;
+
+  if (!loaderStep()) {
+    schedulerPost(EVENT_SEQUENCE);
+  }
+}
+
+
 void sequenceSetNum(uint8_t sequenceNum)
 {
   if (sequenceNum < 1 || sequenceNum > NUM_SEQUENCES) {
       return;
   }
-  sequenceIdx = sequenceNum - 1;
+  activePatternPtr()->sequenceIdx = sequenceNum - 1;
   currStep = 0;
   sequenceLoad();
-  uiChangeCB(UI_SEQ);
+  uiChangeCB(UI_SEQ | UI_SEQ_LENGTH);
 }
 
 
 uint8_t sequenceGetNum(void)
 {
-  return sequenceIdx + 1;
+  return activePatternPtr()->sequenceIdx + 1;
+}
+
+
+void sequenceSetLength(uint8_t length)
+{
+  if (length < 1 || length > MAX_NUM_STEPS) {
+    return;
+  }
+  activePatternPtr()->length = length;
+  if (currStep >= length) {
+    currStep = 0;
+  }
+  uiChangeCB(UI_SEQ_LENGTH);
+}
+
+
+uint8_t sequenceGetLength(void)
+{
+  return activePatternPtr()->length;
 }
 
 
 ChannelParams_T getStepChannelParams(uint8_t channelIdx, uint8_t stepIdx)
 {
-  return stepParams[channelIdx][stepIdx];
+  return activePatternPtr()->steps[stepIdx / NUM_STEPS][channelIdx][stepIdx % NUM_STEPS];
 }
 
 
 ChannelParams_T getCurrStepChannelParams(uint8_t channelIdx)
 {
-  return stepParams[channelIdx][currStep];
+  return getStepChannelParams(channelIdx, currStep);
 }
 
 
 void setStepChannelParams(uint8_t channelIdx, uint8_t stepIdx, ChannelParams_T channelParams)
 {
-  stepParams[channelIdx][stepIdx] = channelParams;
+  activePatternPtr()->steps[stepIdx / NUM_STEPS][channelIdx][stepIdx % NUM_STEPS] = channelParams;
 }
 
 
@@ -87,8 +700,117 @@ uint8_t getStepIdx()
 }
 
 
+static void recordEventApply(const RecordEvent_T *event)
+{
+  Pattern_T *pattern = activePatternPtr();
+  if (event->stepIdx >= pattern->length) {
+    return;
+  }
+
+  ChannelParams_T *params = &pattern->steps[event->stepIdx / NUM_STEPS][event->channelIdx][event->stepIdx % NUM_STEPS];
+  if (event->hit) {
+    *params = event->params;
+    return;
+  }
+
+  // Parameter locks only change steps that already have a trigger
+  if (params->clipNum == 0) {
+    return;
+  }
+  ChannelParams_T locked = *params;
+  if (event->fields & RECORD_CLIP) {
+    locked.clipNum = event->params.clipNum;
+  }
+  if (event->fields & RECORD_START) {
+    locked.startSample = event->params.startSample;
+  }
+  if (event->fields & RECORD_END) {
+    locked.endSample = event->params.endSample;
+  }
+  if (locked.clipNum > 0 && locked.startSample < locked.endSample) {
+    *params = locked;
+  }
+}
+
+
+// recordLocksApply
+// Applies the parameter locks written since the last call, one event for each step they're for
+static void recordLocksApply(void)
+{
+  for (uint8_t channelIdx = 0; channelIdx < NUM_CHANNELS; channelIdx++) {
+    RecordLock_T locks[RECORD_NUM_FIELDS];
+    uint8_t pending = 0;
+
+    for (uint8_t field = 0; field < RECORD_NUM_FIELDS; field++) {
+      RecordLock_T *lock = &recordLocks[channelIdx][field];
+      uint16_t count = lock->count;
+      if ((count & 1) || count == recordLocksApplied[channelIdx][field]) {
+        continue;
+      }
+      // Make sure the count is read before the slot
+      __DMB();
+      locks[field].stepIdx = lock->stepIdx;
+      locks[field].value = lock->value;
+      // Make sure the slot is read before checking it hasn't been written meanwhile
+      __DMB();
+      if (lock->count != count) {
+        continue;
+      }
+      recordLocksApplied[channelIdx][field] = count;
+      pending |= 1u << field;
+    }
+
+    while (pending) {
+      RecordEvent_T event = {.channelIdx = channelIdx, .fields = 0, .hit = false};
+      uint8_t field = 0;
+      while (!(pending & (1u << field))) {
+        field++;
+      }
+      event.stepIdx = locks[field].stepIdx;
+      for (; field < RECORD_NUM_FIELDS; field++) {
+        if (!(pending & (1u << field)) || locks[field].stepIdx != event.stepIdx) {
+          continue;
+        }
+        pending &= ~(1u << field);
+        event.fields |= 1u << field;
+        if ((1u << field) == RECORD_CLIP) {
+          event.params.clipNum = locks[field].value;
+        } else if ((1u << field) == RECORD_START) {
+          event.params.startSample = locks[field].value;
+        } else {
+          event.params.endSample = locks[field].value;
+        }
+      }
+      recordEventApply(&event);
+    }
+  }
+}
+
+
+// recordQueueDrain
+// Applies the queued hits and then the pending parameter locks. The locks hold the latest values,
+// so they win over a hit recorded before them.
+static void recordQueueDrain(void)
+{
+  uint8_t tail = recordQueueTail;
+  while (tail != recordQueueHead) {
+    recordEventApply(&recordQueue[tail]);
+    tail = (tail + 1) & (RECORD_QUEUE_SIZE - 1);
+  }
+  recordQueueTail = tail;
+  recordLocksApply();
+}
+
+
 void step()
 {
+  PROFILE_BEGIN(PROFILE_STEP);
+  TRACE(TRACE_STEP, currStep);
+  // Recorded changes are applied first so a hit quantised forward onto this step plays with it.
+  // That delays the triggers by up to RECORD_QUEUE_SIZE - 1 hits and NUM_CHANNELS *
+  // RECORD_NUM_FIELDS locks (15 and 9), each copying a few bytes into the pattern.
+  recordQueueDrain();
+
   for (int i=0; i < NUM_CHANNELS; i++) {
     ChannelParams_T params = getCurrStepChannelParams(i);
     if (params.clipNum > 0) {
@@ -105,9 +827,72 @@ void step()
       HAL_GPIO_WritePin(STATUS_LED_GPIO_Port, STATUS_LED_Pin, GPIO_PIN_RESET);
   }
 
-  if (++currStep >= NUM_STEPS) {
+  if (++currStep >= activePatternPtr()->length) {
     currStep = 0;
+    if (songPlaying) {
+      songAdvance();
+    }
   }
+  PROFILE_END(PROFILE_STEP);
+}
+
+
+// sequenceRecord
+// Records a live change for the step nearest to now, which is either the step that has just
+// played or the next one to play. A hit writes all of params to the step, otherwise only the
+// given fields of an existing trigger are changed (a parameter lock). Hits are queued, a lock
+// replaces any earlier lock of the same field on the channel that step() hasn't applied yet.
+// Returns false if the sequence isn't playing or a hit doesn't fit in the queue.
+bool sequenceRecord(uint8_t channelIdx, uint8_t fields, bool hit, ChannelParams_T params, bool nextStep)
+{
+  if (!sequencePlaying || channelIdx >= NUM_CHANNELS) {
+    return false;
+  }
+
+  uint8_t stepIdx = currStep;
+  if (!nextStep) {
+    stepIdx = (currStep == 0 ? activePatternPtr()->length : currStep) - 1;
+  }
+
+  if (!hit) {
+    for (uint8_t field = 0; field < RECORD_NUM_FIELDS; field++) {
+      if (!(fields & (1u << field))) {
+        continue;
+      }
+      RecordLock_T *lock = &recordLocks[channelIdx][field];
+      lock->count++;
+      // Make sure step() sees the slot as being written before it changes
+      __DMB();
+      lock->stepIdx = stepIdx;
+      if ((1u << field) == RECORD_CLIP) {
+        lock->value = params.clipNum;
+      } else if ((1u << field) == RECORD_START) {
+        lock->value = params.startSample;
+      } else {
+        lock->value = params.endSample;
+      }
+      // Make sure the slot is written before it's published to step()
+      __DMB();
+      lock->count++;
+    }
+    return true;
+  }
+
+  uint8_t head = recordQueueHead;
+  uint8_t nextHead = (head + 1) & (RECORD_QUEUE_SIZE - 1);
+  if (nextHead == recordQueueTail) {
+    return false;
+  }
+
+  recordQueue[head].channelIdx = channelIdx;
+  recordQueue[head].stepIdx = stepIdx;
+  recordQueue[head].fields = fields;
+  recordQueue[head].hit = hit;
+  recordQueue[head].params = params;
+  // Make sure the event is written before it's published to step()
+  __DMB();
+  recordQueueHead = nextHead;
+  return true;
 }
 
 
@@ -127,6 +912,11 @@ void sequenceStop(void)
 {
   audioStop();
   sequencePlaying = false;
+  songPlaying = false;
+  loader.state = LOAD_IDLE;
+  // Apply any recorded events step() hasn't got to yet so they aren't lost. This is safe as
+  // step() is also called from the main loop.
+  recordQueueDrain();
 }
 
 
@@ -136,42 +926,139 @@ bool getSequencePlaying(void)
 }
 
 
-void sequenceStore(void)
+bool sequenceStore(void)
 {
-  uint16_t sectorIdx = sequenceIdxToFlashSectorIdx(sequenceIdx);
+  Pattern_T *pattern = activePatternPtr();
 
-  flashEraseSector(sectorIdx);
-  flashWriteDataSector(sectorIdx, (uint8_t *) stepParams, sizeof(stepParams));
+  uint16_t recordSize = sequenceSerialise(pattern);
+  if (recordSize == 0) {
+    return false;
+  }
+  slotWrite(pattern->sequenceIdx, recordBuffer, recordSize);
+  pattern->used = true;
+  // If the next pattern of the song is this sequence, what has been loaded of it is out of date,
+  // and a load part way through would fail its CRC and leave a silent pattern, so load it again
+  if (songPlaying && loader.pattern == nextPatternPtr() && loader.pattern->sequenceIdx == pattern->sequenceIdx) {
+    songQueueNextLoad();
+  }
+  return true;
 }
 
 
 void sequenceLoad(void)
 {
-  uint16_t sectorIdx = sequenceIdxToFlashSectorIdx(sequenceIdx);
-  flashReadDataSector(sectorIdx, (uint8_t *) stepParams, sizeof(stepParams));
-  // If we load sequence data from an empty flash sector all bytes will be
-  // initialised to 0xFF. We can check this by checking the clip number of
-  // the first step of the first channel.
-  if (stepParams[0][0].clipNum == 255) {
-    sequenceUsed = false;
-  } else {
-    sequenceUsed = true;
+  Pattern_T *pattern = activePatternPtr();
+  patternLoad(pattern, pattern->sequenceIdx);
+  if (currStep >= pattern->length) {
+    currStep = 0;
   }
-  // We need to reset all values if we've loading an empty sequence
-  if (!sequenceUsed) {
-    for (uint8_t channelIdx=0; channelIdx < NUM_CHANNELS; channelIdx++) {
-      for (uint8_t stepIdx=0; stepIdx < NUM_STEPS; stepIdx++) {
-        stepParams[channelIdx][stepIdx].clipNum = 0;
-        stepParams[channelIdx][stepIdx].startSample = 0;
-        stepParams[channelIdx][stepIdx].endSample = MAX_SAMPLE_IDX;
-        stepParams[channelIdx][stepIdx].loop = false;
-      }
-    }
+  // The loader is shared with the background load of the next song pattern, so restart it
+  if (songPlaying) {
+    songQueueNextLoad();
   }
 }
 
 
 bool getSequenceUsed(void)
 {
-  return sequenceUsed;
+  return activePatternPtr()->used;
+}
+
+
+// sequenceExport
+// Copies a stored sequence into record in the packed record format, converting it if it is still
+// in a legacy sector. The inactive pattern buffer is only used while a song is playing so it's
+// borrowed for the conversion. Returns the record size, or 0 if the sequence isn't used or can't be
+// exported.
+uint16_t sequenceExport(uint8_t sequenceNum, uint8_t *record)
+{
+  if (sequenceNum < 1 || sequenceNum > NUM_SEQUENCES || songPlaying) {
+    return 0;
+  }
+  Pattern_T *pattern = nextPatternPtr();
+  patternLoad(pattern, sequenceNum - 1);
+  if (!pattern->used) {
+    return 0;
+  }
+  uint16_t recordSize = sequenceSerialise(pattern);
+  memcpy(record, recordBuffer, recordSize);
+  return recordSize;
+}
+
+
+// sequenceImport
+// Stores a record in the packed record format as a sequence. The record is run through the loader
+// first so that only a record that would load without errors is stored.
+bool sequenceImport(uint8_t sequenceNum, const uint8_t *record, uint16_t size)
+{
+  if (sequenceNum < 1 || sequenceNum > NUM_SEQUENCES || songPlaying || size > SEQUENCE_RECORD_MAX_SIZE) {
+    return false;
+  }
+  Pattern_T *pattern = nextPatternPtr();
+  loaderStart(pattern, sequenceNum - 1);
+  loaderFeed(record, size);
+  bool valid = loader.state == LOAD_READY && pattern->used && loader.recordSize <= size;
+  loader.state = LOAD_IDLE;
+  if (!valid) {
+    return false;
+  }
+
+  memcpy(recordBuffer, record, loader.recordSize);
+  slotWrite(sequenceNum - 1, recordBuffer, loader.recordSize);
+  if (activePatternPtr()->sequenceIdx == sequenceNum - 1) {
+    sequenceLoad();
+    uiChangeCB(UI_SEQ | UI_SEQ_LENGTH);
+  }
+  return true;
+}
+
+
+bool songSet(const uint8_t *sequenceNums, uint8_t length)
+{
+  if (length < 1 || length > MAX_SONG_LENGTH) {
+    return false;
+  }
+  for (uint8_t i=0; i < length; i++) {
+    if (sequenceNums[i] < 1 || sequenceNums[i] > NUM_SEQUENCES) {
+      return false;
+    }
+  }
+  for (uint8_t i=0; i < length; i++) {
+    songSequenceIdxs[i] = sequenceNums[i] - 1;
+  }
+  songLength = length;
+  return true;
+}
+
+
+uint8_t songGetLength(void)
+{
+  return songLength;
+}
+
+
+uint8_t songGetPos(void)
+{
+  return songPos;
+}
+
+
+void songStart(void)
+{
+  if (songLength == 0) {
+    return;
+  }
+  songPos = 0;
+  // The first pattern is loaded straight away as we're not on the step path yet
+  patternLoad(activePatternPtr(), songSequenceIdxs[0]);
+  songQueueNextLoad();
+  sequenceStart();
+  songPlaying = true;
+  uiChangeCB(UI_SEQ | UI_SEQ_CLIP | UI_SEQ_CLIP_START | UI_SEQ_CLIP_END | UI_SEQ_LENGTH);
+}
+
+
+bool getSongPlaying(void)
+{
+  return songPlaying;
 }
@@ -0,0 +1,59 @@
+#include "stats.h"
+#include "main.h"
+#include <string.h>
+
+static volatile HealthStats_T healthStats;
+
+
+void statsDacUnderrun(void)
+{
+  healthStats.dacUnderruns++;
+}
+
+
+void statsMicOverrun(void)
+{
+  healthStats.micOverruns++;
+}
+
+
+void statsRefillLatency(uint32_t cycles)
+{
+  if (cycles > healthStats.maxRefillLatency) {
+    healthStats.maxRefillLatency = cycles;
+  }
+}
+
+
+void statsFlashReadTime(uint8_t channelIdx, uint32_t cycles)
+{
+  if (channelIdx >= NUM_CHANNELS) {
+    return;
+  }
+  if (cycles > healthStats.maxFlashReadTime[channelIdx]) {
+    healthStats.maxFlashReadTime[channelIdx] = cycles;
+  }
+}
+
+
+// statsStepLateness
+// Records how late a step was, converting cycles to samples at the 16 kHz sample rate
+void statsStepLateness(uint32_t cycles)
+{
+  uint32_t samples = (uint32_t) (((uint64_t) cycles * 16000) / SystemCoreClock);
+  if (samples > healthStats.maxStepLateness) {
+    healthStats.maxStepLateness = samples;
+  }
+}
+
+
+// statsGetAndClear
+// Copies the counters and clears them in one go so no counts are lost in between
+void statsGetAndClear(HealthStats_T *stats)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(stats, (const void *) &healthStats, sizeof(HealthStats_T));
+  memset((void *) &healthStats, 0, sizeof(HealthStats_T));
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,68 @@
+#include "trace.h"
+#include "main.h"
+#include "cycles.h"
+#include "consoleIo.h"
+#include <stdbool.h>
+
+// Circular buffer of trace records
+// Records can be added from interrupt handlers and the main loop, so claiming a slot is done
+// with interrupts disabled. The buffer is dumped over the console UART as raw binary:
+//
+//   "TRACE"             5 byte marker
+//   count               2 bytes, number of records that follow
+//   cycles per second   4 bytes, core clock for converting timestamps
+//   records             8 bytes each, oldest first
+//
+// All multi-byte values are little endian (the records are sent as they are in RAM).
+
+static TraceRecord_T records[TRACE_NUM_RECORDS];
+static uint32_t nextRecord = 0;
+static volatile bool tracePaused = false;
+
+
+void traceRecord(uint16_t id, uint16_t arg)
+{
+  if (tracePaused) return;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  TraceRecord_T *record = &records[nextRecord & (TRACE_NUM_RECORDS - 1)];
+  nextRecord++;
+  record->timestamp = cyclesNow();
+  record->id = id;
+  record->arg = arg;
+  __set_PRIMASK(primask);
+}
+
+
+// traceDump
+// Sends the contents of the trace buffer over the console UART. Tracing is paused while the
+// buffer is sent so the records don't change underneath it.
+void traceDump(void)
+{
+  tracePaused = true;
+
+  uint16_t count = nextRecord < TRACE_NUM_RECORDS ? nextRecord : TRACE_NUM_RECORDS;
+  uint32_t first = nextRecord - count;
+  uint32_t clock = SystemCoreClock;
+  uint8_t header[11] = {'T', 'R', 'A', 'C', 'E'};
+  header[5] = count & 0xFF;
+  header[6] = count >> 8;
+  for (uint8_t i = 0; i < 4; i++) {
+    header[7 + i] = (clock >> (i * 8)) & 0xFF;
+  }
+  ConsoleIoSendData(header, sizeof(header));
+
+  // Send the oldest records first, in at most two pieces either side of the end of the buffer
+  uint32_t firstIdx = first & (TRACE_NUM_RECORDS - 1);
+  uint32_t firstPiece = TRACE_NUM_RECORDS - firstIdx;
+  if (firstPiece > count) {
+    firstPiece = count;
+  }
+  ConsoleIoSendData((uint8_t *) &records[firstIdx], firstPiece * sizeof(TraceRecord_T));
+  if (count > firstPiece) {
+    ConsoleIoSendData((uint8_t *) &records[0], (count - firstPiece) * sizeof(TraceRecord_T));
+  }
+
+  tracePaused = false;
+}
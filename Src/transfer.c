@@ -0,0 +1,546 @@
+#include "transfer.h"
+#include "main.h"
+#include "consoleIo.h"
+#include "flash.h"
+#include "audio.h"
+#include "sequence.h"
+#include "scheduler.h"
+#include "crc.h"
+#include <string.h>
+
+// Binary transfer of clips and sequences over the console UART
+// The "xfer" console command switches the UART from the console to this protocol until the host
+// closes the session (or nothing has been received for IDLE_TIMEOUT_MS). Frames are received through
+// the console's circular DMA buffer (which must hold a full window of data frames so that none are
+// lost while pages are being programmed) and sent with DMA, and clip data goes straight between the
+// frames and flash. The handler runs when data is received or a frame has been sent, and every
+// TIMEOUT_CHECK_MS to check for timeouts.
+//
+// Frame layout (multi-byte values are little endian):
+//   0  sync           TRANSFER_SYNC
+//   1  type           eTransferFrame_T
+//   2  seq            data frame sequence number (the low 8 bits of the frame index)
+//   3  length         payload length, 0 to TRANSFER_MAX_PAYLOAD
+//   5  payload
+//   5 + length  CRC   CRC-16 of bytes 1 to 4 + length
+// Frames with a bad CRC are dropped and recovered by the sliding window below.
+//
+// Requests from the host, each answered with a single frame:
+//   HELLO                              -> INFO (see sendInfo)
+//   OPEN_READ  object, number          -> OPEN_OK size (4 bytes), or ERROR code
+//   OPEN_WRITE object, number, size    -> OPEN_OK size, or ERROR code
+//   CLOSE                              -> CLOSE, then back to the console
+// Clips and sequences are numbered from 1. A clip is CLIP_SAMPLES samples of raw audio, a sequence
+// is a record in the packed format described in sequence.c. Opening an unused sequence for reading
+// gives an INVALID_DATA error. Nothing can be opened while audio or a sequence is playing.
+//
+// After an open the object is sent as DATA frames of up to TRANSFER_MAX_PAYLOAD bytes, with up to
+// TRANSFER_WINDOW frames sent ahead of the acknowledgements. The receiver acknowledges with an ACK
+// frame whose seq is that of the next frame it expects, which covers every frame before it, and
+// drops frames that are out of order. If the sender gets a repeated ACK, or hears nothing new for
+// RETRY_TIMEOUT_MS, it sends again from the first frame that hasn't been acknowledged. When the device is the receiver it
+// answers the final frame with DONE (or ERROR if the data can't be stored) instead of an ACK, and
+// when it is the sender it sends DONE once every frame has been acknowledged.
+
+#define FRAME_HEADER_SIZE 5
+#define FRAME_CRC_SIZE 2
+#define FRAME_MAX_SIZE (FRAME_HEADER_SIZE + TRANSFER_MAX_PAYLOAD + FRAME_CRC_SIZE)
+#define RETRY_TIMEOUT_MS 250
+#define IDLE_TIMEOUT_MS 10000
+#define TIMEOUT_CHECK_MS 50
+
+// Clips are stored at the start of a 32KB block (8 sectors) with the used flag after the audio
+#define CLIP_SIZE (CLIP_SAMPLES * 2)
+#define FLASH_SECTOR_SIZE 4096
+#define SECTORS_PER_BLOCK 8
+
+typedef enum {
+  SESSION_IDLE      = 0u,
+  SESSION_OPEN      = 1u,
+  SESSION_READING   = 2u,
+  SESSION_WRITING   = 3u,
+  SESSION_CLOSING   = 4u
+} eSessionState_T;
+
+typedef enum {
+  PARSE_SYNC    = 0u,
+  PARSE_HEADER  = 1u,
+  PARSE_BODY    = 2u
+} eParseState_T;
+
+// We have to get access to the UART handle defined in main.c
+extern UART_HandleTypeDef huart1;
+
+static eSessionState_T sessionState = SESSION_IDLE;
+
+static eParseState_T parseState;
+static uint8_t rxFrame[FRAME_MAX_SIZE];
+static uint16_t rxFramePos;
+static uint16_t rxFrameSize;
+static uint32_t lastFrameTick;
+
+static uint8_t txFrame[FRAME_MAX_SIZE];
+
+// The open object
+static eTransferObject_T objectType;
+static uint8_t objectNum;
+static uint32_t objectSize;
+static uint16_t numFrames;
+static uint8_t sequenceData[SEQUENCE_RECORD_MAX_SIZE];
+
+// Sliding window, in frame indexes. When sending, windowBase is the first frame that hasn't been
+// acknowledged and windowNext the next frame to send. When receiving, windowNext is the next frame
+// expected.
+static uint16_t windowBase;
+static uint16_t windowNext;
+static uint32_t lastProgressTick;
+static bool resent;
+static bool ackPending;
+
+// Result of the last completed transfer, sent again if the host missed it and repeats data
+static uint8_t lastResultType;
+static uint8_t lastResultCode;
+
+
+static bool txIdle(void)
+{
+  return huart1.gState == HAL_UART_STATE_READY;
+}
+
+
+// sendFrame
+// Sends txFrame with a payload of length bytes, which the caller has already put in place
+static void sendFrame(uint8_t type, uint8_t seq, uint16_t length)
+{
+  txFrame[0] = TRANSFER_SYNC;
+  txFrame[1] = type;
+  txFrame[2] = seq;
+  txFrame[3] = length & 0xFF;
+  txFrame[4] = length >> 8;
+  uint16_t crc = crc16Update(CRC16_INIT, &txFrame[1], FRAME_HEADER_SIZE - 1 + length);
+  txFrame[FRAME_HEADER_SIZE + length] = crc & 0xFF;
+  txFrame[FRAME_HEADER_SIZE + length + 1] = crc >> 8;
+  HAL_UART_Transmit_DMA(&huart1, txFrame, FRAME_HEADER_SIZE + length + FRAME_CRC_SIZE);
+}
+
+
+static void sendError(uint8_t code)
+{
+  txFrame[FRAME_HEADER_SIZE] = code;
+  sendFrame(FRAME_ERROR, 0, 1);
+}
+
+
+static void sendSize(uint8_t type, uint32_t size)
+{
+  for (uint8_t i = 0; i < 4; i++) {
+    txFrame[FRAME_HEADER_SIZE + i] = (size >> (8 * i)) & 0xFF;
+  }
+  sendFrame(type, 0, 4);
+}
+
+
+// sendResult
+// Ends the open transfer with DONE, or ERROR if code isn't 0
+static void sendResult(uint8_t code)
+{
+  lastResultType = code == 0 ? FRAME_DONE : FRAME_ERROR;
+  lastResultCode = code;
+  sessionState = SESSION_OPEN;
+  if (code == 0) {
+    sendFrame(FRAME_DONE, 0, 0);
+  } else {
+    sendError(code);
+  }
+}
+
+
+// sendInfo
+// INFO payload:
+//   0  protocol version
+//   1  window size in frames
+//   2  maximum payload length
+//   4  number of clips
+//   5  number of sequences
+//   6  clip used bitmap, clip n is bit (n - 1) % 8 of byte (n - 1) / 8
+static void sendInfo(void)
+{
+  uint8_t *payload = &txFrame[FRAME_HEADER_SIZE];
+  payload[0] = TRANSFER_PROTOCOL_VERSION;
+  payload[1] = TRANSFER_WINDOW;
+  payload[2] = TRANSFER_MAX_PAYLOAD & 0xFF;
+  payload[3] = TRANSFER_MAX_PAYLOAD >> 8;
+  payload[4] = NUM_CLIPS;
+  payload[5] = NUM_SEQUENCES;
+  memset(&payload[6], 0, (NUM_CLIPS + 7) / 8);
+  for (uint8_t clipNum = 1; clipNum <= NUM_CLIPS; clipNum++) {
+    if (audioClipUsed(clipNum)) {
+      payload[6 + (clipNum - 1) / 8] |= 1 << ((clipNum - 1) % 8);
+    }
+  }
+  sendFrame(FRAME_INFO, 0, 6 + (NUM_CLIPS + 7) / 8);
+}
+
+
+static uint16_t frameLength(uint16_t frameIdx)
+{
+  uint32_t remaining = objectSize - (uint32_t) frameIdx * TRANSFER_MAX_PAYLOAD;
+  return remaining < TRANSFER_MAX_PAYLOAD ? remaining : TRANSFER_MAX_PAYLOAD;
+}
+
+
+static bool objectNumValid(uint8_t type, uint8_t num)
+{
+  if (type == TRANSFER_OBJECT_CLIP) {
+    return num >= 1 && num <= NUM_CLIPS;
+  }
+  if (type == TRANSFER_OBJECT_SEQUENCE) {
+    return num >= 1 && num <= NUM_SEQUENCES;
+  }
+  return false;
+}
+
+
+static void openRead(const uint8_t *payload, uint16_t length)
+{
+  if (length != 2 || !objectNumValid(payload[0], payload[1])) {
+    sendError(TRANSFER_ERROR_BAD_REQUEST);
+    return;
+  }
+  objectType = payload[0];
+  objectNum = payload[1];
+
+  if (objectType == TRANSFER_OBJECT_CLIP) {
+    objectSize = CLIP_SIZE;
+  } else {
+    objectSize = sequenceExport(objectNum, sequenceData);
+    if (objectSize == 0) {
+      sendError(TRANSFER_ERROR_INVALID_DATA);
+      return;
+    }
+  }
+
+  numFrames = (objectSize + TRANSFER_MAX_PAYLOAD - 1) / TRANSFER_MAX_PAYLOAD;
+  windowBase = 0;
+  windowNext = 0;
+  resent = false;
+  lastProgressTick = HAL_GetTick();
+  sessionState = SESSION_READING;
+  sendSize(FRAME_OPEN_OK, objectSize);
+}
+
+
+static void openWrite(const uint8_t *payload, uint16_t length)
+{
+  if (length != 6 || !objectNumValid(payload[0], payload[1])) {
+    sendError(TRANSFER_ERROR_BAD_REQUEST);
+    return;
+  }
+  uint32_t size = payload[2] | (payload[3] << 8) | (payload[4] << 16) | ((uint32_t) payload[5] << 24);
+  uint32_t maxSize = payload[0] == TRANSFER_OBJECT_CLIP ? CLIP_SIZE : SEQUENCE_RECORD_MAX_SIZE;
+  if (size == 0 || size > maxSize) {
+    sendError(TRANSFER_ERROR_BAD_REQUEST);
+    return;
+  }
+  objectType = payload[0];
+  objectNum = payload[1];
+  objectSize = size;
+
+  if (objectType == TRANSFER_OBJECT_CLIP) {
+    // The whole block is erased now so each frame can be programmed as it arrives
+    flashEraseBlock(objectNum - 1);
+  }
+
+  numFrames = (objectSize + TRANSFER_MAX_PAYLOAD - 1) / TRANSFER_MAX_PAYLOAD;
+  windowNext = 0;
+  ackPending = false;
+  sessionState = SESSION_WRITING;
+  sendSize(FRAME_OPEN_OK, objectSize);
+}
+
+
+static void writeFrameData(uint16_t frameIdx, uint8_t *data, uint16_t length)
+{
+  uint32_t offset = (uint32_t) frameIdx * TRANSFER_MAX_PAYLOAD;
+
+  if (objectType == TRANSFER_OBJECT_CLIP) {
+    flashWriteDataSectorOffset(
+        (objectNum - 1) * SECTORS_PER_BLOCK + offset / FLASH_SECTOR_SIZE,
+        data,
+        offset % FLASH_SECTOR_SIZE,
+        length
+    );
+  } else {
+    memcpy(&sequenceData[offset], data, length);
+  }
+}
+
+
+// writeFinish
+// Stores the object once every frame has been received. Returns 0 or an error code.
+static uint8_t writeFinish(void)
+{
+  if (objectType == TRANSFER_OBJECT_CLIP) {
+    // Sets the used flag and stores the clip's overview after the audio
+    audioFinishClip(objectNum);
+    return 0;
+  }
+  if (!sequenceImport(objectNum, sequenceData, objectSize)) {
+    return TRANSFER_ERROR_INVALID_DATA;
+  }
+  return 0;
+}
+
+
+static void handleData(uint8_t seq, uint8_t *payload, uint16_t length)
+{
+  if (sessionState != SESSION_WRITING) {
+    // The host may have missed the result of the last transfer and be sending its data again
+    if (lastResultType == FRAME_DONE) {
+      sendFrame(FRAME_DONE, 0, 0);
+    } else {
+      sendError(lastResultType == FRAME_ERROR ? lastResultCode : TRANSFER_ERROR_BAD_REQUEST);
+    }
+    return;
+  }
+
+  // Anything other than the next frame is dropped, the ACK tells the host where to carry on from
+  ackPending = true;
+  if (seq != (windowNext & 0xFF) || length != frameLength(windowNext)) {
+    return;
+  }
+  writeFrameData(windowNext, payload, length);
+  windowNext++;
+
+  if (windowNext == numFrames) {
+    ackPending = false;
+    sendResult(writeFinish());
+  }
+}
+
+
+static void handleAck(uint8_t seq)
+{
+  if (sessionState != SESSION_READING) {
+    return;
+  }
+  uint8_t acked = (seq - windowBase) & 0xFF;
+  if (acked == 0 && windowNext != windowBase && !resent) {
+    // The host has dropped a frame, send again from it without waiting for the timeout. Later
+    // duplicates are for frames that will be sent again anyway so are ignored.
+    windowNext = windowBase;
+    resent = true;
+    return;
+  }
+  if (acked == 0 || acked > windowNext - windowBase) {
+    return;
+  }
+  windowBase += acked;
+  resent = false;
+  lastProgressTick = HAL_GetTick();
+
+  if (windowBase == numFrames) {
+    sendResult(0);
+  }
+}
+
+
+// handleFrame
+// Acts on a complete frame in rxFrame. Only called when the transmitter is idle so any reply
+// can be sent straight away.
+static void handleFrame(void)
+{
+  uint8_t type = rxFrame[1];
+  uint8_t seq = rxFrame[2];
+  uint16_t length = rxFrame[3] | (rxFrame[4] << 8);
+  uint8_t *payload = &rxFrame[FRAME_HEADER_SIZE];
+
+  switch (type) {
+  case FRAME_HELLO:
+    sendInfo();
+    break;
+  case FRAME_OPEN_READ:
+  case FRAME_OPEN_WRITE:
+    if (getAudioRunning() || getSequencePlaying()) {
+      sessionState = SESSION_OPEN;
+      sendError(TRANSFER_ERROR_BUSY);
+    } else if (type == FRAME_OPEN_READ) {
+      openRead(payload, length);
+    } else {
+      openWrite(payload, length);
+    }
+    break;
+  case FRAME_DATA:
+    handleData(seq, payload, length);
+    break;
+  case FRAME_ACK:
+    handleAck(seq);
+    break;
+  case FRAME_CLOSE:
+    sessionState = SESSION_CLOSING;
+    sendFrame(FRAME_CLOSE, 0, 0);
+    break;
+  default:
+    sendError(TRANSFER_ERROR_BAD_REQUEST);
+    break;
+  }
+}
+
+
+// receiveFrame
+// Parses received bytes until a frame with a good CRC is complete. Returns true if there is one
+// in rxFrame.
+static bool receiveFrame(void)
+{
+  uint32_t received;
+
+  while (1) {
+    switch (parseState) {
+    case PARSE_SYNC:
+      ConsoleIoReceiveData(rxFrame, 1, &received);
+      if (received == 0) {
+        return false;
+      }
+      if (rxFrame[0] == TRANSFER_SYNC) {
+        rxFramePos = 1;
+        parseState = PARSE_HEADER;
+      }
+      break;
+    case PARSE_HEADER:
+      ConsoleIoReceiveData(&rxFrame[rxFramePos], FRAME_HEADER_SIZE - rxFramePos, &received);
+      if (received == 0) {
+        return false;
+      }
+      rxFramePos += received;
+      if (rxFramePos == FRAME_HEADER_SIZE) {
+        uint16_t length = rxFrame[3] | (rxFrame[4] << 8);
+        if (length > TRANSFER_MAX_PAYLOAD) {
+          parseState = PARSE_SYNC;
+        } else {
+          rxFrameSize = FRAME_HEADER_SIZE + length + FRAME_CRC_SIZE;
+          parseState = PARSE_BODY;
+        }
+      }
+      break;
+    case PARSE_BODY:
+      ConsoleIoReceiveData(&rxFrame[rxFramePos], rxFrameSize - rxFramePos, &received);
+      if (received == 0) {
+        return false;
+      }
+      rxFramePos += received;
+      if (rxFramePos == rxFrameSize) {
+        parseState = PARSE_SYNC;
+        uint16_t crc = crc16Update(CRC16_INIT, &rxFrame[1], rxFrameSize - FRAME_CRC_SIZE - 1);
+        uint16_t frameCrc = rxFrame[rxFrameSize - 2] | (rxFrame[rxFrameSize - 1] << 8);
+        if (crc == frameCrc) {
+          lastFrameTick = HAL_GetTick();
+          return true;
+        }
+      }
+      break;
+    }
+  }
+}
+
+
+static void sendNextData(void)
+{
+  if (windowNext >= numFrames || windowNext - windowBase >= TRANSFER_WINDOW) {
+    return;
+  }
+  uint32_t offset = (uint32_t) windowNext * TRANSFER_MAX_PAYLOAD;
+  uint16_t length = frameLength(windowNext);
+
+  if (objectType == TRANSFER_OBJECT_CLIP) {
+    flashReadDataBlockOffset(objectNum - 1, &txFrame[FRAME_HEADER_SIZE], offset, length);
+  } else {
+    memcpy(&txFrame[FRAME_HEADER_SIZE], &sequenceData[offset], length);
+  }
+  sendFrame(FRAME_DATA, windowNext & 0xFF, length);
+  windowNext++;
+}
+
+
+static void transferStop(void)
+{
+  // Hand the UART back to the console
+  sessionState = SESSION_IDLE;
+}
+
+
+// transferStart
+// Takes the UART over from the console and waits for the host to send frames
+void transferStart(void)
+{
+  if (sessionState != SESSION_IDLE) {
+    return;
+  }
+  parseState = PARSE_SYNC;
+  lastResultType = 0;
+  lastFrameTick = HAL_GetTick();
+  sessionState = SESSION_OPEN;
+  schedulerPost(EVENT_TRANSFER);
+}
+
+
+bool transferIsActive(void)
+{
+  return sessionState != SESSION_IDLE;
+}
+
+
+// transferProcess
+// The handler for EVENT_TRANSFER. While a session is open this handles the frames received and
+// keeps the transmitter busy with replies and data frames.
+void transferProcess(void)
+{
+  if (sessionState == SESSION_IDLE) return;
+
+  if (sessionState == SESSION_CLOSING) {
+    if (txIdle()) {
+      transferStop();
+    }
+    return;
+  }
+
+  if (HAL_GetTick() - lastFrameTick > IDLE_TIMEOUT_MS) {
+    if (txIdle()) {
+      transferStop();
+      return;
+    }
+  }
+
+  while (txIdle() && receiveFrame()) {
+    handleFrame();
+    if (schedulerShouldYield()) {
+      // Carry on with the rest later
+      schedulerPost(EVENT_TRANSFER);
+      break;
+    }
+  }
+
+  if (txIdle()) {
+    if (ackPending) {
+      ackPending = false;
+      sendFrame(FRAME_ACK, windowNext & 0xFF, 0);
+    } else if (sessionState == SESSION_READING) {
+      if (windowNext != windowBase && HAL_GetTick() - lastProgressTick > RETRY_TIMEOUT_MS) {
+        // Go back to the first frame that hasn't been acknowledged
+        windowNext = windowBase;
+        lastProgressTick = HAL_GetTick();
+      }
+      sendNextData();
+    }
+  }
+}
+
+
+// transferTick
+// Called every millisecond from the SysTick interrupt. Runs the handler every TIMEOUT_CHECK_MS
+// while a session is open so that retries and the idle timeout happen when nothing is received.
+void transferTick(void)
+{
+  if (sessionState != SESSION_IDLE && HAL_GetTick() % TIMEOUT_CHECK_MS == 0) {
+    schedulerPost(EVENT_TRANSFER);
+  }
+}
@@ -3,7 +3,12 @@
 #include "audio.h"
 #include "application.h"
 #include "sequence.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "trace.h"
+#include "cycles.h"
 #include "st7789.h"
+#include "screen.h"
 #include "stdbool.h"
 
 
@@ -11,6 +16,25 @@
 #define MENU_Y_OFFSET 45
 #define MENU_ITEM_HEIGHT 25
 #define MENU_MARKER_X 10
+#define MENU_VALUE_X_OFFSET 130
+#define MAX_MENU_ITEMS 8
+#define TITLE_Y 5
+#define TITLE_CELLS 21
+#define LABEL_CELLS 11
+#define VALUE_CELLS 6
+#define NUM_FIELDS (1 + 3 * MAX_MENU_ITEMS)
+#define WAVE_Y 252
+#define WAVE_HEIGHT 64
+#define WAVE_DIRTY_WORDS ((AUDIO_PEAK_COLUMNS + 31) / 32)
+#define GRID_X 8
+#define GRID_Y 125
+#define GRID_CELL_WIDTH 14
+#define GRID_CELL_HEIGHT 24
+#define GRID_PLAYHEAD_Y (GRID_Y + NUM_CHANNELS * GRID_CELL_HEIGHT + 2)
+#define GRID_PLAYHEAD_HEIGHT 6
+#define GRID_NO_STEP 0xFF
+// Rows cleared at a time when the waveform or grid is hidden, 1.3ms at the 48MHz SPI clock
+#define CLEAR_BAND_ROWS 16
 
 
 static void switchMainMenu(void);
@@ -19,6 +43,11 @@ static void switchAudioClipPlayMenu(void);
 static void switchAudioClipRecordMenu(void);
 static void switchSequenceMenu(void);
 static void switchSequenceEditMenu(void);
+static void switchSequenceRecordMenu(void);
+static void switchSequenceGridMenu(void);
+static void uiSequenceStore(void);
+static void setTitle(char *text, uint16_t color);
+static void uiRecordHit(void);
 
 typedef enum {
   ACTION      = 1,
@@ -42,13 +71,41 @@ typedef struct {
   menuItemT   items[];
 } menuT;
 
+// Each value shown by the menus is bound to functions that get and change it, looked up by its
+// uiValueType (see uiValues)
+typedef struct {
+  int16_t       uiValueType;
+  uint16_t      (*get)(void);
+  void          (*change)(int16_t changeAmt);
+  // Whether the value is marked with a '*', NULL if it never is
+  bool          (*marked)(uint16_t value);
+} uiValueT;
+
+// Writes a value into the VALUE_CELLS cells of a value field
+typedef void (*formatFuncPtr)(uint16_t value, char *str);
+
+typedef struct {
+  uint16_t color;
+  uint16_t bgColor;
+} valueStyleT;
+
+// Each menu row keeps what its value field was last set to, so a row whose value and style
+// haven't changed is skipped without setting the field
+typedef struct {
+  char    valueStr[VALUE_CELLS];
+  uint8_t selectState;
+  bool    valid;
+} itemWidgetT;
+
 typedef enum {
   MAIN_MENU               = 0,
   AUDIO_CLIP_MENU         = 1,
   AUDIO_CLIP_PLAY_MENU    = 2,
   AUDIO_CLIP_RECORD_MENU  = 3,
   SEQUENCE_MENU           = 4,
-  SEQUENCE_EDIT_MENU      = 5
+  SEQUENCE_EDIT_MENU      = 5,
+  SEQUENCE_RECORD_MENU    = 6,
+  SEQUENCE_GRID_MENU      = 7
 } menuIndexT;
 
 static menuT mainMenu = {
@@ -97,25 +154,58 @@ static menuT audioClipRecordMenu = {
 
 static menuT sequenceMenu = {
   .title="Sequences",
-  .numItems=4,
+  .numItems=7,
   .items={
       {"Sequence", INT_VALUE, UI_SEQ, false, NULL},
       {"Play / stop", ACTION, 0, false, &appToggleSequencePlay},
+      {"Play song", ACTION, 0, false, &appToggleSongPlay},
       {"Edit", ACTION, 0, false, &switchSequenceEditMenu},
+      {"Live record", ACTION, 0, false, &switchSequenceRecordMenu},
+      {"Grid", ACTION, 0, false, &switchSequenceGridMenu},
       {"Back", ACTION, 0, false, &switchMainMenu},
   }
 };
 
 static menuT sequenceEditMenu = {
   .title="Sequence Edit",
-  .numItems=7,
+  .numItems=8,
   .items={
+      {"Length", INT_VALUE, UI_SEQ_LENGTH, false, NULL},
       {"Channel", INT_VALUE, UI_SEQ_CHANNEL, false, NULL},
       {"Step", INT_VALUE, UI_SEQ_STEP, false, NULL},
       {"Clip", INT_VALUE, UI_SEQ_CLIP, false, NULL},
       {"Start", INT_VALUE, UI_SEQ_CLIP_START, false, NULL},
       {"End", INT_VALUE, UI_SEQ_CLIP_END, false, NULL},
-      {"Store", ACTION, 0, false, &appStoreSequence},
+      {"Store", ACTION, 0, false, &uiSequenceStore},
+      {"Back", ACTION, 0, false, &switchSequenceMenu},
+  }
+};
+
+// While the sequence plays, pressing Hit records a trigger of the clip on the selected channel
+// and changing Clip, Start or End locks the new value to the trigger on that channel, both on the
+// nearest step.
+static menuT sequenceRecordMenu = {
+  .title="Live Record",
+  .numItems=7,
+  .items={
+      {"Channel", INT_VALUE, UI_SEQ_CHANNEL, false, NULL},
+      {"Clip", INT_VALUE, UI_REC_CLIP, false, NULL},
+      {"Start", INT_VALUE, UI_REC_CLIP_START, false, NULL},
+      {"End", INT_VALUE, UI_REC_CLIP_END, false, NULL},
+      {"Hit", ACTION, 0, false, &uiRecordHit},
+      {"Play / stop", ACTION, 0, false, &appToggleSequencePlay},
+      {"Back", ACTION, 0, false, &switchSequenceMenu},
+  }
+};
+
+// Shows the bar of the sequence being played as a grid of channels by steps, with a playhead
+// under the step that was played last
+static menuT sequenceGridMenu = {
+  .title="Sequence Grid",
+  .numItems=3,
+  .items={
+      {"Sequence", INT_VALUE, UI_SEQ, false, NULL},
+      {"Play / stop", ACTION, 0, false, &appToggleSequencePlay},
       {"Back", ACTION, 0, false, &switchSequenceMenu},
   }
 };
@@ -126,77 +216,80 @@ static menuT *menus[] = {
     &audioClipPlayMenu,
     &audioClipRecordMenu,
     &sequenceMenu,
-    &sequenceEditMenu
+    &sequenceEditMenu,
+    &sequenceRecordMenu,
+    &sequenceGridMenu
 };
 
 static menuIndexT menuIdx = MAIN_MENU;
 static int8_t menuPos = 0;
 static int8_t itemSelectState = 0;
 static bool menuRenderRequired = true;
-static int16_t uiValuesChanged = 0;
+// Values changed since the last frame, added to by uiValueChangeCB
+static volatile int16_t uiValuesChanged = 0;
 static bool buttonActioned = false;
 static uint8_t sequenceChannel = 0;
 static uint8_t sequenceStep = 0;
+static ChannelParams_T recordParams = {1, 0, MAX_SAMPLE_IDX, false};
+
+// The menu is drawn as screen fields, so only the parts that change are sent to the display.
+// Each menu row has a marker, label and value field.
+static ScreenField_T titleField;
+static ScreenField_T markerFields[MAX_MENU_ITEMS];
+static ScreenField_T labelFields[MAX_MENU_ITEMS];
+static ScreenField_T valueFields[MAX_MENU_ITEMS];
+// All of the fields, in the order they are drawn
+static ScreenField_T *fields[NUM_FIELDS];
+static itemWidgetT itemWidgets[MAX_MENU_ITEMS];
+
+// The audio clip menus show the waveform of the clip below the menu, with the start and end
+// samples marked. Columns are filled in from the peaks found as the clip is played or recorded,
+// and only the columns that change are drawn. Rows are relative to WAVE_Y.
+static bool waveVisible = false;
+static uint8_t waveTop[AUDIO_PEAK_COLUMNS];
+static uint8_t waveBottom[AUDIO_PEAK_COLUMNS];
+// Bit per column that has changed since it was last drawn
+static uint32_t waveDirty[WAVE_DIRTY_WORDS];
+static uint8_t waveStartColumn = 0;
+static uint8_t waveEndColumn = AUDIO_PEAK_COLUMNS - 1;
+
+// The grid menu shows a bar of the sequence as a cell for each channel and step. Each cell keeps
+// what it was last drawn as and is only drawn again when that changes. When the sequence moves on
+// a step, just the old and new playhead markers are drawn.
+typedef enum {
+  GRID_CELL_UNDRAWN   = 0,
+  GRID_CELL_OFF_END   = 1,
+  GRID_CELL_EMPTY     = 2,
+  GRID_CELL_TRIGGER   = 3
+} gridCellT;
+
+static const uint16_t gridChannelColors[NUM_CHANNELS] = {BLUE, GREEN, MAGENTA};
+static bool gridVisible = false;
+static gridCellT gridCells[NUM_CHANNELS][NUM_STEPS];
+// Bar being shown
+static uint8_t gridBar = 0;
+// Step in the bar the playhead marker is drawn under, or GRID_NO_STEP
+static uint8_t gridPlayhead = GRID_NO_STEP;
+// Set when the cells may have changed, so they're compared with the sequence
+static bool gridCheckRequired = false;
+
+// When a menu hides the waveform or grid its area is cleared a band of rows at a time, so
+// clearing it doesn't hold up the audio. Each area is only drawn again once it has been cleared.
+typedef struct {
+  uint16_t nextRow;
+  uint16_t endRow;
+} clearAreaT;
 
+static clearAreaT waveClear = {0, 0};
+static clearAreaT gridClear = {0, 0};
 
-static uint16_t expnt(uint8_t power)
-{
-  // Exponent implementation from StackOverflow: https://stackoverflow.com/a/101613
-
-  uint16_t base = 10;
-  uint16_t result = 1;
-
-  for (;;) {
-    if (power & 1) {
-      result *= base;
-    }
-    power >>= 1;
-    if (!power) {
-      break;
-    }
-    base *= base;
-  }
-
-  return result;
-}
-
-
-static uint16_t getUIValueInt(int16_t uiValueType)
-{
-  switch (uiValueType) {
-
-  case UI_CLIP:
-    return appGetAudioChannelParams(0).clipNum;
-  case UI_CLIP_START:
-    return appGetAudioChannelParams(0).startSample;
-  case UI_CLIP_END:
-    return appGetAudioChannelParams(0).endSample;
-  case UI_SEQ:
-    return appGetSequenceNum();
-  case UI_SEQ_CHANNEL:
-    return sequenceChannel;
-  case UI_SEQ_STEP:
-    return sequenceStep;
-  case UI_SEQ_CLIP:
-    return appGetSequenceStepChannelParams(sequenceStep, sequenceChannel).clipNum;
-  case UI_SEQ_CLIP_START:
-    return appGetSequenceStepChannelParams(sequenceStep, sequenceChannel).startSample;
-  case UI_SEQ_CLIP_END:
-    return appGetSequenceStepChannelParams(sequenceStep, sequenceChannel).endSample;
-  }
-
-  return 0;
-}
-
-static bool getUIValueBool(int16_t uiValueType)
-{
-  switch (uiValueType) {
-  case UI_CLIP_LOOP:
-    return appGetAudioChannelParams(0).loop;
-  }
+// Frames are started at most every UI_FRAME_MS. Updates in between that have input or changes to
+// show set framePending and are skipped, and uiTick runs the UI again when the next frame is due.
+static volatile uint32_t lastFrameTime = 0;
+static volatile bool framePending = false;
+static uint32_t framesRendered = 0;
+static uint32_t framesSkipped = 0;
 
-  return false;
-}
 
 static void uiAudioClipChange(int16_t changeAmt)
 {
@@ -253,8 +346,9 @@ static void uiAudioEndChange(int16_t changeAmt)
 }
 
 
-static void uiAudioLoopToggle(void)
+static void uiAudioLoopChange(int16_t changeAmt)
 {
+  // Any change toggles the value
   ChannelParams_T params = appGetAudioChannelParams(0);
   params.loop = !params.loop;
   appSetAudioChannelParams(0, params);
@@ -276,6 +370,25 @@ static void uiSequenceChange(int16_t changeAmt)
 }
 
 
+static void uiSequenceLengthChange(int16_t changeAmt)
+{
+  uint8_t length = appGetSequenceLength();
+  if (changeAmt > 0 && length + changeAmt > MAX_NUM_STEPS) {
+    length = MAX_NUM_STEPS;
+  } else if (changeAmt < 0 && length + changeAmt < 1) {
+    length = 1;
+  } else {
+    length += changeAmt;
+  }
+  appSetSequenceLength(length);
+  // Keep the step being edited within the sequence
+  if (sequenceStep >= length) {
+    sequenceStep = length - 1;
+    uiValueChangeCB(UI_SEQ_LENGTH | UI_SEQ_STEP | UI_SEQ_CLIP | UI_SEQ_CLIP_START | UI_SEQ_CLIP_END);
+  }
+}
+
+
 static void uiSequenceChannelChange(int16_t changeAmt)
 {
   if (changeAmt > 0 && sequenceChannel + changeAmt > MAX_CHANNEL_IDX) {
@@ -291,8 +404,9 @@ static void uiSequenceChannelChange(int16_t changeAmt)
 
 static void uiSequenceStepChange(int16_t changeAmt)
 {
-  if (changeAmt > 0 && sequenceStep + changeAmt > MAX_STEP_IDX) {
-    sequenceStep = MAX_STEP_IDX;
+  uint8_t maxStepIdx = appGetSequenceLength() - 1;
+  if (changeAmt > 0 && sequenceStep + changeAmt > maxStepIdx) {
+    sequenceStep = maxStepIdx;
   } else if (changeAmt < 0 && sequenceStep + changeAmt < 0) {
     sequenceStep = 0;
   } else {
@@ -353,65 +467,289 @@ static void uiSequenceEndChange(int16_t changeAmt)
 }
 
 
-static void renderMenuItem(uint8_t itemPos, const char *str, itemTypeT itemType, int16_t uiValueType, uint8_t selectState)
+// uiSequenceStore
+// Stores the sequence, showing in the title if it failed. The title goes back to the menu's when a
+// store succeeds or the menu changes.
+static void uiSequenceStore(void)
+{
+  if (appStoreSequence()) {
+    setTitle(menus[menuIdx]->title, BLUE);
+  } else {
+    setTitle("Store failed", RED);
+  }
+  schedulerPost(EVENT_UI);
+}
+
+
+static void uiRecordClipChange(int16_t changeAmt)
 {
-  uint16_t y = MENU_Y_OFFSET + itemPos * MENU_ITEM_HEIGHT;
+  if (changeAmt > 0 && recordParams.clipNum + changeAmt > NUM_CLIPS) {
+    recordParams.clipNum = NUM_CLIPS;
+  } else if (changeAmt < 0 && recordParams.clipNum + changeAmt < 1) {
+    recordParams.clipNum = 1;
+  } else {
+    recordParams.clipNum += changeAmt;
+  }
+  recordParams.startSample = 0;
+  recordParams.endSample = MAX_SAMPLE_IDX;
+  appRecordStep(sequenceChannel, RECORD_CLIP | RECORD_START | RECORD_END, false, recordParams);
+  uiValueChangeCB(UI_REC_CLIP | UI_REC_CLIP_START | UI_REC_CLIP_END);
+}
 
-  char valStr[] = "      ";
 
-  switch (itemType) {
-  case INT_VALUE:
-    uint16_t val = getUIValueInt(uiValueType);
+static void uiRecordStartChange(int16_t changeAmt)
+{
+  if (changeAmt > 0 && recordParams.startSample + changeAmt > MAX_SAMPLE_IDX - 1) {
+    recordParams.startSample = MAX_SAMPLE_IDX - 1;
+  } else if (changeAmt < 0 && recordParams.startSample + changeAmt < 0) {
+    recordParams.startSample = 0;
+  } else if (recordParams.startSample + changeAmt >= recordParams.endSample) {
+    recordParams.startSample = recordParams.endSample - 1;
+  } else {
+    recordParams.startSample += changeAmt;
+  }
+  appRecordStep(sequenceChannel, RECORD_START, false, recordParams);
+  uiValueChangeCB(UI_REC_CLIP_START);
+}
 
-    uint8_t numDigits = 5;
-    for (int i = 0; i < numDigits; i++) {
-      uint16_t divisor = expnt(i);
-      uint8_t digit = (val / divisor) % 10;
-      valStr[numDigits - i - 1] = '0' + digit;
-    }
 
-    // FIXME: This doesn't really belong here.
-    // This function shouldn't know about special conditions for different value types.
-    // Perhaps a pointer to the function to call should be passed in.
-    if (uiValueType == UI_CLIP && appGetAudioClipUsed((uint8_t) val)) {
-	valStr[5] = '*';
-    } else if (uiValueType == UI_SEQ && appGetSequenceUsed()) {
-	valStr[5] = '*';
-    }
-    break;
-  case BOOL_VALUE:
-    if (getUIValueBool(uiValueType)) {
-      valStr[0] = 'Y';
-      valStr[1] = 'e';
-      valStr[2] = 's';
-    } else {
-      valStr[0] = 'N';
-      valStr[1] = 'o';
+static void uiRecordEndChange(int16_t changeAmt)
+{
+  if (changeAmt > 0 && recordParams.endSample + changeAmt > MAX_SAMPLE_IDX) {
+    recordParams.endSample = MAX_SAMPLE_IDX;
+  } else if (changeAmt < 0 && recordParams.endSample + changeAmt < 1) {
+    recordParams.endSample = 1;
+  } else if (recordParams.endSample + changeAmt <= recordParams.startSample) {
+    recordParams.endSample = recordParams.startSample + 1;
+  } else {
+    recordParams.endSample += changeAmt;
+  }
+  appRecordStep(sequenceChannel, RECORD_END, false, recordParams);
+  uiValueChangeCB(UI_REC_CLIP_END);
+}
+
+
+// uiRecordHit
+// Records a trigger on the selected channel. Parameter locks can't be dropped, but hits are queued
+// until the next step, so if too many come in at once the title shows the one that didn't fit.
+static void uiRecordHit(void)
+{
+  if (appRecordStep(sequenceChannel, RECORD_CLIP | RECORD_START | RECORD_END, true, recordParams)) {
+    setTitle(menus[menuIdx]->title, BLUE);
+  } else if (appGetSequencePlaying()) {
+    setTitle("Hit dropped", RED);
+  }
+  schedulerPost(EVENT_UI);
+}
+
+
+static uint16_t getClip(void)
+{
+  return appGetAudioChannelParams(0).clipNum;
+}
+
+
+static uint16_t getClipStart(void)
+{
+  return appGetAudioChannelParams(0).startSample;
+}
+
+
+static uint16_t getClipEnd(void)
+{
+  return appGetAudioChannelParams(0).endSample;
+}
+
+
+static uint16_t getClipLoop(void)
+{
+  return appGetAudioChannelParams(0).loop;
+}
+
+
+static uint16_t getSequence(void)
+{
+  return appGetSequenceNum();
+}
+
+
+static uint16_t getSequenceLength(void)
+{
+  return appGetSequenceLength();
+}
+
+
+static uint16_t getSequenceChannel(void)
+{
+  return sequenceChannel;
+}
+
+
+static uint16_t getSequenceStep(void)
+{
+  return sequenceStep;
+}
+
+
+static uint16_t getSequenceClip(void)
+{
+  return appGetSequenceStepChannelParams(sequenceStep, sequenceChannel).clipNum;
+}
+
+
+static uint16_t getSequenceClipStart(void)
+{
+  return appGetSequenceStepChannelParams(sequenceStep, sequenceChannel).startSample;
+}
+
+
+static uint16_t getSequenceClipEnd(void)
+{
+  return appGetSequenceStepChannelParams(sequenceStep, sequenceChannel).endSample;
+}
+
+
+static uint16_t getRecordClip(void)
+{
+  return recordParams.clipNum;
+}
+
+
+static uint16_t getRecordClipStart(void)
+{
+  return recordParams.startSample;
+}
+
+
+static uint16_t getRecordClipEnd(void)
+{
+  return recordParams.endSample;
+}
+
+
+static bool clipMarked(uint16_t clipNum)
+{
+  return appGetAudioClipUsed((uint8_t) clipNum);
+}
+
+
+static bool sequenceMarked(uint16_t sequenceNum)
+{
+  return appGetSequenceUsed();
+}
+
+
+static const uiValueT uiValues[] = {
+    {UI_CLIP, &getClip, &uiAudioClipChange, &clipMarked},
+    {UI_CLIP_START, &getClipStart, &uiAudioStartChange, NULL},
+    {UI_CLIP_END, &getClipEnd, &uiAudioEndChange, NULL},
+    {UI_CLIP_LOOP, &getClipLoop, &uiAudioLoopChange, NULL},
+    {UI_SEQ, &getSequence, &uiSequenceChange, &sequenceMarked},
+    {UI_SEQ_LENGTH, &getSequenceLength, &uiSequenceLengthChange, NULL},
+    {UI_SEQ_CHANNEL, &getSequenceChannel, &uiSequenceChannelChange, NULL},
+    {UI_SEQ_STEP, &getSequenceStep, &uiSequenceStepChange, NULL},
+    {UI_SEQ_CLIP, &getSequenceClip, &uiSequenceClipChange, NULL},
+    {UI_SEQ_CLIP_START, &getSequenceClipStart, &uiSequenceStartChange, NULL},
+    {UI_SEQ_CLIP_END, &getSequenceClipEnd, &uiSequenceEndChange, NULL},
+    {UI_REC_CLIP, &getRecordClip, &uiRecordClipChange, NULL},
+    {UI_REC_CLIP_START, &getRecordClipStart, &uiRecordStartChange, NULL},
+    {UI_REC_CLIP_END, &getRecordClipEnd, &uiRecordEndChange, NULL},
+};
+
+#define NUM_UI_VALUES (sizeof(uiValues) / sizeof(uiValues[0]))
+
+
+static const uiValueT * findValue(int16_t uiValueType)
+{
+  for (uint8_t i = 0; i < NUM_UI_VALUES; i++) {
+    if (uiValues[i].uiValueType == uiValueType) {
+      return &uiValues[i];
     }
-    break;
-  default:
-    break;
   }
+  return NULL;
+}
+
+
+static void formatNone(uint16_t value, char *str)
+{
+}
+
+
+// formatInt
+// Writes the value as 5 digits, working from the last digit so no powers of ten are needed
+static void formatInt(uint16_t value, char *str)
+{
+  for (int8_t i = 4; i >= 0; i--) {
+    str[i] = '0' + value % 10;
+    value /= 10;
+  }
+}
+
 
-  ST7789_WriteString(MENU_X_OFFSET, y, str, Font_11x18, RED, WHITE);
-  if (selectState == 1) {
-    ST7789_WriteString(MENU_X_OFFSET + 130, y, valStr, Font_11x18, WHITE, RED);
-  } else if (selectState == 2) {
-    ST7789_WriteString(MENU_X_OFFSET + 130, y, valStr, Font_11x18, WHITE, GREEN);
-  } else if (selectState == 3) {
-    ST7789_WriteString(MENU_X_OFFSET + 130, y, valStr, Font_11x18, WHITE, BLUE);
+static void formatBool(uint16_t value, char *str)
+{
+  if (value) {
+    str[0] = 'Y';
+    str[1] = 'e';
+    str[2] = 's';
   } else {
-    ST7789_WriteString(MENU_X_OFFSET + 130, y, valStr, Font_11x18, RED, WHITE);
+    str[0] = 'N';
+    str[1] = 'o';
   }
 }
 
-static void renderMenuMarker(uint8_t oldItemPos, uint8_t newItemPos)
+
+// How each type of item shows its value, indexed by itemTypeT
+static const formatFuncPtr itemFormats[] = {
+    [ACTION] = &formatNone,
+    [INT_VALUE] = &formatInt,
+    [BOOL_VALUE] = &formatBool
+};
+
+// Colors of a value field, indexed by the select state of its item
+static const valueStyleT valueStyles[] = {
+    {RED, WHITE},
+    {WHITE, RED},
+    {WHITE, GREEN},
+    {WHITE, BLUE}
+};
+
+
+// renderMenuItem
+// Sets the value field of a menu row, unless it would show the same as when it was last set
+static void renderMenuItem(uint8_t itemPos, const menuItemT *item, uint8_t selectState)
 {
-  uint16_t y = MENU_Y_OFFSET + oldItemPos * MENU_ITEM_HEIGHT;
-  ST7789_Fill(MENU_MARKER_X, y, MENU_MARKER_X + 12, y + MENU_ITEM_HEIGHT, WHITE);
+  char valStr[VALUE_CELLS + 1] = "      ";
+  itemWidgetT *widget = &itemWidgets[itemPos];
+  const uiValueT *value = findValue(item->uiValueType);
+
+  if (value) {
+    uint16_t val = value->get();
+    itemFormats[item->itemType](val, valStr);
+    if (value->marked && value->marked(val)) {
+      valStr[VALUE_CELLS - 1] = '*';
+    }
+  }
 
-  y = MENU_Y_OFFSET + newItemPos * MENU_ITEM_HEIGHT;
-  ST7789_WriteChar(MENU_MARKER_X, y, '>', Font_11x18, BLACK, WHITE);
+  bool changed = !widget->valid || widget->selectState != selectState;
+  for (uint8_t i = 0; i < VALUE_CELLS; i++) {
+    if (widget->valueStr[i] != valStr[i]) {
+      widget->valueStr[i] = valStr[i];
+      changed = true;
+    }
+  }
+  if (!changed) {
+    return;
+  }
+  widget->selectState = selectState;
+  widget->valid = true;
+  screenFieldSet(&valueFields[itemPos], valStr, valueStyles[selectState].color, valueStyles[selectState].bgColor);
+}
+
+static void renderMenuMarker(uint8_t oldItemPos, uint8_t newItemPos)
+{
+  screenFieldSet(&markerFields[oldItemPos], "", BLACK, WHITE);
+  screenFieldSet(&markerFields[newItemPos], ">", BLACK, WHITE);
 }
 
 
@@ -431,6 +769,7 @@ static void switchToMenu(menuIndexT menuIdx_)
   menuIdx = menuIdx_;
   menuPos = 0;
   menuRenderRequired = true;
+  schedulerPost(EVENT_UI);
 }
 
 
@@ -472,35 +811,437 @@ static void switchSequenceEditMenu(void)
 }
 
 
-void uiInit(void)
+static void switchSequenceRecordMenu(void)
 {
-  ST7789_Init();
-  ST7789_Fill_Color(WHITE);
+  switchToMenu(SEQUENCE_RECORD_MENU);
 }
 
 
-void uiUpdate(int16_t encCountChange, bool buttonPressed)
+static void switchSequenceGridMenu(void)
 {
-  menuT *currMenu = menus[menuIdx];
+  switchToMenu(SEQUENCE_GRID_MENU);
+}
 
-  if (menuRenderRequired) {
-    ST7789_Fill_Color(WHITE);
 
-    uint8_t titleLen = simpleStrlen(currMenu->title);
-    uint8_t titleX = ((22 - titleLen) / 2) * 11;
-    ST7789_WriteString(titleX, 5, currMenu->title, Font_11x18, BLUE, WHITE);
+static uint8_t waveRow(int16_t sample)
+{
+  return (WAVE_HEIGHT / 2 - 1) - sample / (32768 / (WAVE_HEIGHT / 2));
+}
 
-    for (int i = 0; i < currMenu->numItems; i++) {
-      renderMenuItem(i, currMenu->items[i].label, currMenu->items[i].itemType, currMenu->items[i].uiValueType, false);
+
+static void waveMarkDirty(uint8_t first, uint8_t last)
+{
+  if (first > last) {
+    uint8_t tmp = first;
+    first = last;
+    last = tmp;
+  }
+  for (uint16_t column = first; column <= last && column < AUDIO_PEAK_COLUMNS; column++) {
+    waveDirty[column / 32] |= 1u << (column % 32);
+  }
+}
+
+
+// waveUpdateMarkers
+// Marks the columns to be redrawn whose color changes when the start or end sample moves
+static void waveUpdateMarkers(void)
+{
+  ChannelParams_T params = appGetAudioChannelParams(0);
+  uint8_t startColumn = params.startSample / AUDIO_PEAK_SAMPLES;
+  uint8_t endColumn = params.endSample / AUDIO_PEAK_SAMPLES;
+
+  waveMarkDirty(waveStartColumn, startColumn);
+  waveMarkDirty(waveEndColumn, endColumn);
+  waveStartColumn = startColumn;
+  waveEndColumn = endColumn;
+}
+
+
+// waveLoad
+// Sets the waveform from the overview stored with the current clip, or to silence if the clip has
+// none, for when the clip changes. Marks the whole of it to be redrawn.
+static void waveLoad(void)
+{
+  static int8_t overview[AUDIO_PEAK_COLUMNS * 2];
+  uint8_t columns = audioReadOverview(appGetAudioChannelParams(0).clipNum, 0, overview);
+
+  for (uint8_t column = 0; column < AUDIO_PEAK_COLUMNS; column++) {
+    if (column < columns) {
+      waveTop[column] = waveRow(overview[column * 2 + 1] << 8);
+      waveBottom[column] = waveRow(overview[column * 2] << 8);
+    } else {
+      waveTop[column] = waveRow(0);
+      waveBottom[column] = waveRow(0);
     }
+  }
+  waveMarkDirty(0, AUDIO_PEAK_COLUMNS - 1);
+  waveUpdateMarkers();
+}
 
-    renderMenuMarker(menuPos, menuPos);
 
-    menuRenderRequired = false;
+static void drawWaveColumn(uint8_t column)
+{
+  if (column == waveStartColumn || column == waveEndColumn) {
+    ST7789_DrawColumn(column, WAVE_Y, WAVE_HEIGHT, 0, WAVE_HEIGHT - 1, RED, WHITE);
+  } else if (column > waveStartColumn && column < waveEndColumn) {
+    ST7789_DrawColumn(column, WAVE_Y, WAVE_HEIGHT, waveTop[column], waveBottom[column], BLUE, WHITE);
+  } else {
+    ST7789_DrawColumn(column, WAVE_Y, WAVE_HEIGHT, waveTop[column], waveBottom[column], GRAY, WHITE);
+  }
+}
+
+
+// clearStart
+// Sets the rows from y to be cleared by drawClear
+static void clearStart(clearAreaT *area, uint16_t y, uint16_t height)
+{
+  area->nextRow = y;
+  area->endRow = y + height;
+}
+
+
+// drawClear
+// Clears the next bands of an area set by clearStart, giving way to higher priority work between
+// bands. Returns true once the whole of it has been cleared.
+static bool drawClear(clearAreaT *area)
+{
+  while (area->nextRow < area->endRow) {
+    uint16_t lastRow = area->nextRow + CLEAR_BAND_ROWS - 1;
+    if (lastRow >= area->endRow) {
+      lastRow = area->endRow - 1;
+    }
+    ST7789_Fill_Rows(area->nextRow, lastRow, WHITE);
+    area->nextRow = lastRow + 1;
+    if (schedulerShouldYield()) {
+      schedulerPost(EVENT_UI);
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// drawWave
+// Takes the peaks found by the audio processing since the last update and draws the columns of
+// the waveform that have changed. While a clip plays that is usually just the newest column.
+// Text is drawn first: this waits until the display has finished sending it.
+static void drawWave(void)
+{
+  AudioPeak_T peak;
+
+  while (audioGetPeak(&peak)) {
+    if (!waveVisible || peak.column >= AUDIO_PEAK_COLUMNS) {
+      continue;
+    }
+    uint8_t top = waveRow(peak.max);
+    uint8_t bottom = waveRow(peak.min);
+    if (top != waveTop[peak.column] || bottom != waveBottom[peak.column]) {
+      waveTop[peak.column] = top;
+      waveBottom[peak.column] = bottom;
+      waveMarkDirty(peak.column, peak.column);
+    }
+  }
+
+  if (ST7789_AsyncBusy() || !drawClear(&waveClear) || !waveVisible) {
+    return;
+  }
+  for (uint8_t column = 0; column < AUDIO_PEAK_COLUMNS; column++) {
+    uint32_t bit = 1u << (column % 32);
+    if (!(waveDirty[column / 32] & bit)) {
+      continue;
+    }
+    waveDirty[column / 32] &= ~bit;
+    drawWaveColumn(column);
+    if (schedulerShouldYield()) {
+      schedulerPost(EVENT_UI);
+      break;
+    }
+  }
+}
+
+
+static gridCellT gridCellState(uint8_t channelIdx, uint8_t stepInBar)
+{
+  uint8_t stepIdx = gridBar * NUM_STEPS + stepInBar;
+
+  if (stepIdx >= appGetSequenceLength()) {
+    return GRID_CELL_OFF_END;
+  }
+  if (appGetSequenceStepChannelParams(stepIdx, channelIdx).clipNum > 0) {
+    return GRID_CELL_TRIGGER;
+  }
+  return GRID_CELL_EMPTY;
+}
+
+
+static void drawGridCell(uint8_t channelIdx, uint8_t stepInBar, gridCellT state)
+{
+  uint16_t x = GRID_X + stepInBar * GRID_CELL_WIDTH;
+  uint16_t y = GRID_Y + channelIdx * GRID_CELL_HEIGHT;
+  uint16_t color = WHITE;
+
+  if (state == GRID_CELL_TRIGGER) {
+    color = gridChannelColors[channelIdx];
+  } else if (state == GRID_CELL_EMPTY) {
+    // The first step of each beat is darker
+    color = stepInBar % 4 == 0 ? GRAY : LGRAY;
+  }
+  // Cells are a pixel smaller than their spacing so there is a gap between them
+  ST7789_Fill(x, y, x + GRID_CELL_WIDTH - 2, y + GRID_CELL_HEIGHT - 2, color);
+}
+
+
+static void drawGridPlayhead(uint8_t stepInBar, uint16_t color)
+{
+  uint16_t x = GRID_X + stepInBar * GRID_CELL_WIDTH;
+
+  ST7789_Fill(x, GRID_PLAYHEAD_Y, x + GRID_CELL_WIDTH - 2, GRID_PLAYHEAD_Y + GRID_PLAYHEAD_HEIGHT - 1, color);
+}
+
 
+// gridReset
+// Marks every cell of the grid as undrawn, so the whole of it is drawn by the next update
+static void gridReset(void)
+{
+  for (uint8_t channelIdx = 0; channelIdx < NUM_CHANNELS; channelIdx++) {
+    for (uint8_t stepInBar = 0; stepInBar < NUM_STEPS; stepInBar++) {
+      gridCells[channelIdx][stepInBar] = GRID_CELL_UNDRAWN;
+    }
+  }
+  gridBar = 0;
+  gridPlayhead = GRID_NO_STEP;
+  gridCheckRequired = true;
+}
+
+
+// drawGrid
+// Moves the playhead to the step that was played last, then draws any cells that have changed.
+// Each step usually only needs the two small playhead fills, so playback isn't held up by
+// redrawing the grid. Text is drawn first: this waits until the display has finished sending it.
+static void drawGrid(void)
+{
+  uint8_t playhead = GRID_NO_STEP;
+
+  if (ST7789_AsyncBusy() || !drawClear(&gridClear) || !gridVisible) {
     return;
   }
 
+  if (appGetSequencePlaying()) {
+    uint8_t stepIdx = appGetPlayedStepIdx();
+    playhead = stepIdx % NUM_STEPS;
+    if (stepIdx / NUM_STEPS != gridBar) {
+      gridBar = stepIdx / NUM_STEPS;
+      gridCheckRequired = true;
+    }
+  }
+  if (playhead != gridPlayhead) {
+    if (gridPlayhead != GRID_NO_STEP) {
+      drawGridPlayhead(gridPlayhead, WHITE);
+    }
+    if (playhead != GRID_NO_STEP) {
+      drawGridPlayhead(playhead, RED);
+    }
+    gridPlayhead = playhead;
+    // Steps recorded live are added as the sequence plays
+    gridCheckRequired = true;
+  }
+
+  if (!gridCheckRequired) {
+    return;
+  }
+  gridCheckRequired = false;
+  for (uint8_t channelIdx = 0; channelIdx < NUM_CHANNELS; channelIdx++) {
+    for (uint8_t stepInBar = 0; stepInBar < NUM_STEPS; stepInBar++) {
+      gridCellT state = gridCellState(channelIdx, stepInBar);
+      if (state == gridCells[channelIdx][stepInBar]) {
+        continue;
+      }
+      drawGridCell(channelIdx, stepInBar, state);
+      gridCells[channelIdx][stepInBar] = state;
+      if (schedulerShouldYield()) {
+        gridCheckRequired = true;
+        schedulerPost(EVENT_UI);
+        return;
+      }
+    }
+  }
+}
+
+
+static void setTitle(char *text, uint16_t color)
+{
+  char title[TITLE_CELLS + 1];
+  uint8_t titleLen = simpleStrlen(text);
+  uint8_t titlePos = 0;
+
+  // Centre the title by starting it with spaces
+  while (titlePos < (22 - titleLen) / 2) {
+    title[titlePos++] = ' ';
+  }
+  for (uint8_t i = 0; i < titleLen && titlePos < TITLE_CELLS; i++) {
+    title[titlePos++] = text[i];
+  }
+  title[titlePos] = '\0';
+  screenFieldSet(&titleField, title, color, WHITE);
+}
+
+
+// renderMenu
+// Sets the fields for the whole of the current menu. Rows the menu doesn't use are cleared.
+static void renderMenu(menuT *currMenu)
+{
+  setTitle(currMenu->title, BLUE);
+
+  for (uint8_t i = 0; i < MAX_MENU_ITEMS; i++) {
+    itemWidgets[i].valid = false;
+    if (i < currMenu->numItems) {
+      screenFieldSet(&labelFields[i], currMenu->items[i].label, RED, WHITE);
+      renderMenuItem(i, &currMenu->items[i], 0);
+    } else {
+      screenFieldSet(&labelFields[i], "", RED, WHITE);
+      screenFieldSet(&valueFields[i], "", RED, WHITE);
+    }
+    screenFieldSet(&markerFields[i], i == menuPos ? ">" : "", BLACK, WHITE);
+  }
+
+  bool showWave = (menuIdx == AUDIO_CLIP_PLAY_MENU || menuIdx == AUDIO_CLIP_RECORD_MENU);
+  if (showWave) {
+    waveLoad();
+  } else if (waveVisible) {
+    clearStart(&waveClear, WAVE_Y, WAVE_HEIGHT);
+  }
+  waveVisible = showWave;
+
+  bool showGrid = (menuIdx == SEQUENCE_GRID_MENU);
+  if (showGrid) {
+    gridReset();
+  } else if (gridVisible) {
+    clearStart(&gridClear, GRID_Y, GRID_PLAYHEAD_Y + GRID_PLAYHEAD_HEIGHT - GRID_Y);
+  }
+  gridVisible = showGrid;
+}
+
+
+// drawFields
+// Starts sending the fields that have changed to the display. Text is sent by DMA while the next
+// band of it is drawn, so this doesn't wait for the display: it stops when the display is busy and
+// carries on when uiDisplayCB runs the UI handler again. It also gives way to higher priority
+// work between fields.
+static void drawFields(void)
+{
+  bool drawn = false;
+
+  ST7789_ProcessAsync();
+  for (uint8_t i = 0; i < NUM_FIELDS; i++) {
+    if (!screenFieldDirty(fields[i])) {
+      continue;
+    }
+    if (!drawn) {
+      TRACE(TRACE_UI_RENDER_BEGIN, menuIdx);
+      drawn = true;
+    }
+    if (!screenFieldDraw(fields[i])) {
+      break;
+    }
+    if (schedulerShouldYield()) {
+      schedulerPost(EVENT_UI);
+      break;
+    }
+  }
+  if (drawn) {
+    TRACE(TRACE_UI_RENDER_END, menuIdx);
+  }
+}
+
+
+// uiDisplayCB
+// Called from the display DMA interrupt when a band of text has been sent, to rasterise the next
+// one or start on the next run of changed cells
+static void uiDisplayCB(void)
+{
+  schedulerPost(EVENT_UI);
+}
+
+
+// uiBenchRedraw
+// Clears the display and redraws the whole of the current menu without giving way to other
+// handlers, returning the number of cycles it took. Used to time drawing from the console.
+uint32_t uiBenchRedraw(void)
+{
+  uint32_t start = cyclesNow();
+
+  ST7789_Fill_Color(WHITE);
+  for (uint8_t i = 0; i < NUM_FIELDS; i++) {
+    screenFieldInvalidate(fields[i]);
+    while (!screenFieldDraw(fields[i])) {
+      ST7789_ProcessAsync();
+    }
+  }
+  while (ST7789_AsyncBusy()) {
+    ST7789_ProcessAsync();
+  }
+  uint32_t cycles = cyclesNow() - start;
+
+  // The waveform and grid aren't part of the timing, they are redrawn by the next update
+  waveMarkDirty(0, AUDIO_PEAK_COLUMNS - 1);
+  gridReset();
+  schedulerPost(EVENT_UI);
+
+  return cycles;
+}
+
+
+void uiInit(void)
+{
+  uint8_t fieldIdx = 0;
+
+  ST7789_Init();
+  ST7789_Fill_Color(WHITE);
+  ST7789_SetAsyncCallback(&uiDisplayCB);
+
+  screenFieldInit(&titleField, 0, TITLE_Y, TITLE_CELLS, WHITE);
+  fields[fieldIdx++] = &titleField;
+  for (uint8_t i = 0; i < MAX_MENU_ITEMS; i++) {
+    uint16_t y = MENU_Y_OFFSET + i * MENU_ITEM_HEIGHT;
+    screenFieldInit(&markerFields[i], MENU_MARKER_X, y, 1, WHITE);
+    screenFieldInit(&labelFields[i], MENU_X_OFFSET, y, LABEL_CELLS, WHITE);
+    screenFieldInit(&valueFields[i], MENU_X_OFFSET + MENU_VALUE_X_OFFSET, y, VALUE_CELLS, WHITE);
+    fields[fieldIdx++] = &markerFields[i];
+    fields[fieldIdx++] = &labelFields[i];
+    fields[fieldIdx++] = &valueFields[i];
+  }
+
+  // Render the first menu
+  schedulerPost(EVENT_UI);
+}
+
+
+// uiTakeValuesChanged
+// Returns the values changed since the last frame and clears them, with interrupts disabled so
+// none are lost
+static int16_t uiTakeValuesChanged(void)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  int16_t valuesChanged = uiValuesChanged;
+  uiValuesChanged = 0;
+  __set_PRIMASK(primask);
+
+  return valuesChanged;
+}
+
+
+// uiFrame
+// Acts on the input since the last frame and sets the fields that need to change as a result
+static void uiFrame(int16_t encCountChange, bool buttonPressed)
+{
+  menuT *currMenu = menus[menuIdx];
+
+  if (menuRenderRequired) {
+    renderMenu(currMenu);
+    menuRenderRequired = false;
+  }
+
   int oldMenuPos = menuPos;
 
   if (itemSelectState == 0) {
@@ -527,34 +1268,9 @@ void uiUpdate(int16_t encCountChange, bool buttonPressed)
       valChange = encCountChange * 100;
     }
 
-    switch (currMenu->items[menuPos].uiValueType) {
-    case UI_CLIP:
-      uiAudioClipChange(valChange);
-      break;
-    case UI_CLIP_START:
-      uiAudioStartChange(valChange);
-      break;
-    case UI_CLIP_END:
-      uiAudioEndChange(valChange);
-      break;
-    case UI_SEQ:
-      uiSequenceChange(valChange);
-      break;
-    case UI_SEQ_CHANNEL:
-      uiSequenceChannelChange(valChange);
-      break;
-    case UI_SEQ_STEP:
-      uiSequenceStepChange(valChange);
-      break;
-    case UI_SEQ_CLIP:
-      uiSequenceClipChange(valChange);
-      break;
-    case UI_SEQ_CLIP_START:
-      uiSequenceStartChange(valChange);
-      break;
-    case UI_SEQ_CLIP_END:
-      uiSequenceEndChange(valChange);
-      break;
+    const uiValueT *value = findValue(currMenu->items[menuPos].uiValueType);
+    if (value) {
+      value->change(valChange);
     }
   }
 
@@ -570,11 +1286,14 @@ void uiUpdate(int16_t encCountChange, bool buttonPressed)
             if (++itemSelectState > 3) {
               itemSelectState = 0;
             }
-            uiValuesChanged |= currMenu->items[menuPos].uiValueType;
+            uiValueChangeCB(currMenu->items[menuPos].uiValueType);
             break;
           case BOOL_VALUE:
-            if (currMenu->items[menuPos].uiValueType == UI_CLIP_LOOP) {
-              uiAudioLoopToggle();
+            {
+              const uiValueT *value = findValue(currMenu->items[menuPos].uiValueType);
+              if (value) {
+                value->change(1);
+              }
             }
             break;
           case ACTION:
@@ -590,26 +1309,92 @@ void uiUpdate(int16_t encCountChange, bool buttonPressed)
 	buttonActioned = false;
   }
 
-  if (uiValuesChanged) {
+  int16_t valuesChanged = uiTakeValuesChanged();
+  if (valuesChanged) {
     int8_t currItemSelectState = 0;
 
     for (int i = 0; i < currMenu->numItems; i++) {
-      if (uiValuesChanged & currMenu->items[i].uiValueType) {
+      if (valuesChanged & currMenu->items[i].uiValueType) {
         if (i == menuPos) {
           currItemSelectState = itemSelectState;
         } else {
           currItemSelectState = 0;
         }
-        renderMenuItem(i, currMenu->items[i].label, currMenu->items[i].itemType, currMenu->items[i].uiValueType, currItemSelectState);
+        renderMenuItem(i, &currMenu->items[i], currItemSelectState);
       }
     }
 
-    uiValuesChanged = 0;
+    if (gridVisible && (valuesChanged & (UI_SEQ | UI_SEQ_LENGTH | UI_SEQ_CLIP))) {
+      gridCheckRequired = true;
+    }
+    if (waveVisible && (valuesChanged & UI_CLIP)) {
+      waveLoad();
+    } else if (waveVisible && (valuesChanged & (UI_CLIP_START | UI_CLIP_END))) {
+      waveUpdateMarkers();
+    }
   }
 }
 
 
+// uiUpdate
+// Runs for every UI event. If there is input or a change to show, a frame is started unless one
+// was started less than UI_FRAME_MS ago, in which case it waits for the next one. However fast the
+// encoder turns, its movement is shown at most once a frame. Drawing of fields and waveform
+// columns that have already been set carries on whenever this runs.
+void uiUpdate(void)
+{
+  PROFILE_BEGIN(PROFILE_UI_UPDATE);
+
+  if (menuRenderRequired || uiValuesChanged || appInputPending()) {
+    uint32_t now = HAL_GetTick();
+    if (now - lastFrameTime >= UI_FRAME_MS) {
+      lastFrameTime = now;
+      framePending = false;
+      framesRendered++;
+      bool buttonPressed;
+      int16_t encCountChange = appTakeInput(&buttonPressed);
+      uiFrame(encCountChange, buttonPressed);
+    } else {
+      framePending = true;
+      framesSkipped++;
+    }
+  }
+
+  drawFields();
+  drawWave();
+  drawGrid();
+  PROFILE_END(PROFILE_UI_UPDATE);
+}
+
+
+// uiTick
+// Called every millisecond from the SysTick interrupt. Runs the UI when a frame is waiting and due.
+void uiTick(void)
+{
+  if (framePending && HAL_GetTick() - lastFrameTime >= UI_FRAME_MS) {
+    framePending = false;
+    schedulerPost(EVENT_UI);
+  }
+}
+
+
+void uiGetAndResetFrameStats(uint32_t *rendered, uint32_t *skipped)
+{
+  *rendered = framesRendered;
+  *skipped = framesSkipped;
+  framesRendered = 0;
+  framesSkipped = 0;
+}
+
+
+// uiValueChangeCB
+// Called when values shown by the menu have changed. Changes are added to those already waiting
+// and shown by the next frame.
 void uiValueChangeCB(int16_t valuesChanged)
 {
-  uiValuesChanged = valuesChanged;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uiValuesChanged |= valuesChanged;
+  __set_PRIMASK(primask);
+  schedulerPost(EVENT_UI);
 }
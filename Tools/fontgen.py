@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Generate anti-aliased, run-length compressed glyphs from the 1bpp fonts in fonts.c.
+
+    fontgen.py Drivers/ST7789/fonts.c Drivers/ST7789/fonts_aa.c Font_11x18
+
+writes an AAFontDef called AAFont_11x18 (see Drivers/ST7789/fonts.h) for each font named.
+
+Each pixel gets one of four levels, 0 the background to 3 the text colour. Pixels set in the
+1bpp font are level 3. Background pixels in the inside corner of a diagonal stroke are given
+level 1, or 2 if they are in two such corners, which smooths the steps without thinning the
+strokes.
+
+Each glyph is stored as a byte giving its first row with anything in it, a byte giving the
+number of rows from there to its last, then those rows as runs of pixels in nibbles, high
+nibble first. A nibble is the level in its top two bits and the run length less one in the
+bottom two, and runs carry on from the end of one row to the start of the next. Rows above
+and below are background. The offsets table gives where each glyph starts in the data.
+"""
+
+import argparse
+import re
+import sys
+
+FIRST_CHAR = 32
+MAX_RUN = 4
+
+
+def load_font(source, name):
+    """Returns (width, height, glyphs) for the FontDef called name, glyphs as rows of 0s and 1s."""
+    m = re.search(r"FontDef\s+%s\s*=\s*\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\w+)\s*\}" % re.escape(name), source)
+    if not m:
+        raise ValueError("no FontDef called %s" % name)
+    width, height, array = int(m.group(1)), int(m.group(2)), m.group(3)
+
+    m = re.search(r"uint16_t\s+%s\s*\[\]\s*=\s*\{(.*?)\};" % re.escape(array), source, re.S)
+    if not m:
+        raise ValueError("no array called %s" % array)
+    body = re.sub(r"//[^\n]*", "", m.group(1))
+    rows = [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", body)]
+
+    glyphs = []
+    for g in range(len(rows) // height):
+        glyphs.append([[(rows[g * height + r] >> (15 - c)) & 1 for c in range(width)] for r in range(height)])
+    return width, height, glyphs
+
+
+def smooth(glyph, width, height):
+    """Returns the glyph as rows of levels 0-3."""
+    def px(r, c):
+        return glyph[r][c] if 0 <= r < height and 0 <= c < width else 0
+
+    levels = []
+    for r in range(height):
+        row = []
+        for c in range(width):
+            if px(r, c):
+                row.append(3)
+                continue
+            up, right, left, down = px(r - 1, c), px(r, c + 1), px(r, c - 1), px(r + 1, c)
+            corners = ((up and left and not right and not down) + (up and right and not left and not down) +
+                       (down and left and not right and not up) + (down and right and not left and not up))
+            row.append(min(corners, 2))
+        levels.append(row)
+    return levels
+
+
+def encode(levels):
+    """Returns the bytes for one glyph."""
+    used = [r for r, row in enumerate(levels) if any(row)]
+    if not used:
+        return bytes([0, 0])
+    top, bottom = used[0], used[-1] + 1
+
+    pixels = [p for row in levels[top:bottom] for p in row]
+    nibbles = []
+    i = 0
+    while i < len(pixels):
+        run = 1
+        while i + run < len(pixels) and pixels[i + run] == pixels[i] and run < MAX_RUN:
+            run += 1
+        nibbles.append((pixels[i] << 2) | (run - 1))
+        i += run
+    if len(nibbles) % 2:
+        nibbles.append(0)
+
+    data = [top, bottom - top]
+    data += [(nibbles[n] << 4) | nibbles[n + 1] for n in range(0, len(nibbles), 2)]
+    return bytes(data)
+
+
+def comment(code):
+    """Returns the comment naming a glyph. A backslash would carry the comment on to the next line."""
+    if code == FIRST_CHAR:
+        return "   // sp"
+    return "   //" if chr(code) == "\\" else "   // " + chr(code)
+
+
+def generate(source, name):
+    """Returns (C source, number of bytes of glyph data and offsets) for one font."""
+    width, height, glyphs = load_font(source, name)
+    base = name.replace("_", "")
+    encoded = [encode(smooth(g, width, height)) for g in glyphs]
+
+    offsets = []
+    pos = 0
+    for data in encoded:
+        offsets.append(pos)
+        pos += len(data)
+    if pos > 0xFFFF:
+        raise ValueError("%s is too big for 16 bit offsets" % name)
+
+    lines = ["static const uint16_t AA%sOffsets [] = {" % base]
+    for i in range(0, len(offsets), 12):
+        lines.append(", ".join("%d" % o for o in offsets[i:i + 12]) + ",")
+    lines.append("};")
+    lines.append("")
+    lines.append("static const uint8_t AA%s [] = {" % base)
+    for code, data in enumerate(encoded, FIRST_CHAR):
+        lines.append(", ".join("0x%02X" % b for b in data) + "," + comment(code))
+    lines.append("};")
+    lines.append("")
+    lines.append("AAFontDef AA%s = {%d,%d,AA%sOffsets,AA%s};" % (name, width, height, base, base))
+    return "\n".join(lines) + "\n", pos + 2 * len(offsets)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="fonts.c holding the 1bpp fonts")
+    parser.add_argument("output", help="C file to write")
+    parser.add_argument("fonts", nargs="+", help="FontDef names to convert, e.g. Font_11x18")
+    args = parser.parse_args()
+
+    with open(args.source) as f:
+        source = f.read()
+
+    parts = ["/* Anti-aliased fonts generated by Tools/fontgen.py from fonts.c, do not edit */", "",
+             '#include "fonts.h"', ""]
+    for name in args.fonts:
+        try:
+            text, size = generate(source, name)
+        except ValueError as e:
+            sys.exit("%s: %s" % (args.source, e))
+        parts.append(text)
+        sys.stderr.write("AA%s: %d bytes\n" % (name, size))
+
+    with open(args.output, "w") as f:
+        f.write("\n".join(parts))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,444 @@
+#!/usr/bin/env python3
+"""Upload and download clips and sequences using the binary transfer protocol (Src/transfer.c).
+
+The device is switched from the console into binary transfer mode with the "xfer" command, the
+requested transfers are done and the session is closed, which hands the port back to the console.
+
+    mes_transfer.py /dev/ttyUSB0 info
+    mes_transfer.py /dev/ttyUSB0 get-clip 3 kick.wav
+    mes_transfer.py /dev/ttyUSB0 put-clip 3 kick.wav
+    mes_transfer.py /dev/ttyUSB0 get-seq 1 seq1.bin
+    mes_transfer.py /dev/ttyUSB0 put-seq 1 seq1.bin
+    mes_transfer.py /dev/ttyUSB0 backup library/
+    mes_transfer.py /dev/ttyUSB0 restore library/
+
+The console runs at 115200 baud. With --baud the device is asked to switch to a faster rate for the
+transfers (see the "baud" console command) and back again afterwards; if the new rate doesn't work
+both ends go back to 115200 and the transfers carry on at that.
+
+    mes_transfer.py --baud 921600 /dev/ttyUSB0 backup library/
+
+Clips are 16 kHz mono 16-bit audio. Files ending in .wav are read and written as WAV, anything
+else as raw little endian samples. Sequences are records in the packed format described in
+Src/sequence.c.
+
+Only the standard library is used; the port is opened with termios so this runs on Linux and macOS.
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+import wave
+
+SYNC = 0xA5
+
+HELLO = 0x01
+INFO = 0x02
+OPEN_READ = 0x03
+OPEN_WRITE = 0x04
+OPEN_OK = 0x05
+DATA = 0x06
+ACK = 0x07
+DONE = 0x08
+ERROR = 0x09
+CLOSE = 0x0A
+
+OBJECT_CLIP = 0x00
+OBJECT_SEQUENCE = 0x01
+
+ERRORS = {0x01: "bad request", 0x02: "busy (stop playback first)", 0x03: "invalid data"}
+
+SAMPLE_RATE = 16000
+CLIP_SAMPLES = 16000
+
+HEADER = struct.Struct("<BBBH")
+RETRY_TIMEOUT = 0.5
+# Opening a clip for writing erases its flash block first
+OPEN_TIMEOUT = 3.0
+
+CONSOLE_BAUD = 115200
+# Rates the device can switch to, see baudRates in Src/consoleIo.c
+DEVICE_BAUD_RATES = (115200, 230400, 460800, 921600, 1000000, 2000000, 3000000)
+# The device goes back to its previous rate if a change isn't confirmed within this time
+BAUD_CONFIRM_TIMEOUT = 1.0
+
+
+class TransferError(Exception):
+    pass
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT as used by crc16Update in Src/crc.c."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def encode_frame(frame_type, seq=0, payload=b""):
+    header = HEADER.pack(SYNC, frame_type, seq, len(payload))
+    body = header[1:] + payload
+    return header[:1] + body + struct.pack("<H", crc16(body))
+
+
+class FrameParser:
+    """Finds frames with a good CRC in a byte stream, skipping anything else."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+
+    def feed(self, data):
+        self.buffer += data
+        frames = []
+        while True:
+            start = self.buffer.find(bytes([SYNC]))
+            if start < 0:
+                self.buffer.clear()
+                break
+            del self.buffer[:start]
+            if len(self.buffer) < HEADER.size:
+                break
+            _, frame_type, seq, length = HEADER.unpack_from(self.buffer)
+            if length > 256:
+                del self.buffer[:1]
+                continue
+            size = HEADER.size + length + 2
+            if len(self.buffer) < size:
+                break
+            body = bytes(self.buffer[1:size - 2])
+            (crc,) = struct.unpack_from("<H", self.buffer, size - 2)
+            if crc == crc16(body):
+                frames.append((frame_type, seq, body[HEADER.size - 1:]))
+                del self.buffer[:size]
+            else:
+                del self.buffer[:1]
+        return frames
+
+
+class Port:
+    """A serial port (or pseudo-terminal) in raw mode."""
+
+    def __init__(self, path, baud=CONSOLE_BAUD):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.set_baud(baud)
+
+    def set_baud(self, baud):
+        speed = getattr(termios, "B%d" % baud, None)
+        if speed is None:
+            raise TransferError("baud rate %d isn't supported on this system" % baud)
+        # Anything already written goes at the old rate
+        termios.tcdrain(self.fd)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        self.baud = baud
+
+    def write(self, data):
+        view = memoryview(data)
+        while view:
+            written = os.write(self.fd, view)
+            view = view[written:]
+
+    def read(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], max(timeout, 0))
+        if not ready:
+            return b""
+        return os.read(self.fd, 4096)
+
+    def flush_input(self):
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+
+    def close(self):
+        os.close(self.fd)
+
+
+class Session:
+    def __init__(self, port):
+        self.port = port
+        self.parser = FrameParser()
+        self.frames = []
+        self.window = 8
+        self.max_payload = 256
+
+    def console_wait(self, text, timeout):
+        """Reads console output until text is seen. Returns False if it isn't seen in time."""
+        seen = b""
+        deadline = time.monotonic() + timeout
+        while text not in seen:
+            if time.monotonic() > deadline:
+                return False
+            seen += self.port.read(deadline - time.monotonic())
+        return True
+
+    def change_baud(self, baud):
+        """Switches the device and the port to a new baud rate using the console. Returns False,
+        with both left at the old rate, if the device can't be heard at the new one."""
+        old_baud = self.port.baud
+        self.port.write(b"\rbaud %d\r" % baud)
+        if not self.console_wait(b"confirm with baudok", 2.0):
+            return False
+        # The device switches as soon as it has sent the reply
+        time.sleep(0.05)
+        self.port.set_baud(baud)
+        self.port.flush_input()
+        self.port.write(b"\rbaudok\r")
+        if self.console_wait(b"Baud rate confirmed", BAUD_CONFIRM_TIMEOUT / 2):
+            return True
+        # Wait for the device to go back by itself
+        self.port.set_baud(old_baud)
+        time.sleep(BAUD_CONFIRM_TIMEOUT)
+        self.port.flush_input()
+        return False
+
+    def enter(self):
+        """Switches the device from the console to binary transfer mode."""
+        self.port.write(b"\rxfer\r")
+        if not self.console_wait(b"Binary transfer mode", 2.0):
+            raise TransferError("device didn't enter transfer mode")
+        # Let the rest of the console output arrive and throw it away
+        time.sleep(0.1)
+        self.port.flush_input()
+        info = self.request(HELLO, expect=INFO)
+        self.window = info[1]
+        self.max_payload = info[2] | (info[3] << 8)
+        return info
+
+    def close(self):
+        """Hands the port back to the console."""
+        try:
+            self.request(CLOSE, expect=CLOSE)
+        except TransferError:
+            # The device goes back to the console by itself once it hears nothing for a while
+            pass
+
+    def send(self, frame_type, seq=0, payload=b""):
+        self.port.write(encode_frame(frame_type, seq, payload))
+
+    def next_frame(self, timeout):
+        deadline = time.monotonic() + timeout
+        while not self.frames:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return None
+            self.frames += self.parser.feed(self.port.read(remaining))
+        return self.frames.pop(0)
+
+    def receive(self, expect, timeout):
+        while True:
+            frame = self.next_frame(timeout)
+            if frame is None:
+                raise TransferError("timed out waiting for a reply")
+            frame_type, seq, payload = frame
+            if frame_type == ERROR:
+                raise TransferError(ERRORS.get(payload[0], "error %d" % payload[0]))
+            if frame_type == expect:
+                return payload
+
+    def request(self, frame_type, payload=b"", expect=OPEN_OK, timeout=1.0, retries=3):
+        for _ in range(retries):
+            self.send(frame_type, 0, payload)
+            try:
+                return self.receive(expect, timeout)
+            except TransferError as error:
+                if "timed out" not in str(error):
+                    raise
+        raise TransferError("no reply from device")
+
+    def read_object(self, object_type, number, progress=None):
+        reply = self.request(OPEN_READ, bytes([object_type, number]))
+        (size,) = struct.unpack("<I", reply)
+        data = bytearray()
+        expected = 0
+        last_ack = time.monotonic()
+        while True:
+            frame = self.next_frame(RETRY_TIMEOUT)
+            if frame is None:
+                if len(data) == size:
+                    # Everything has arrived and the DONE was lost
+                    break
+                # Lost the end of the window, tell the device where to carry on from
+                self.send(ACK, expected & 0xFF)
+                if time.monotonic() - last_ack > 5.0:
+                    raise TransferError("transfer stalled")
+                continue
+            frame_type, seq, payload = frame
+            if frame_type == DONE:
+                break
+            if frame_type == ERROR:
+                raise TransferError(ERRORS.get(payload[0], "error %d" % payload[0]))
+            if frame_type != DATA:
+                continue
+            if seq == expected & 0xFF:
+                data += payload
+                expected += 1
+                last_ack = time.monotonic()
+                if progress:
+                    progress(len(data), size)
+            self.send(ACK, expected & 0xFF)
+        if len(data) != size:
+            raise TransferError("received %d bytes, expected %d" % (len(data), size))
+        return bytes(data)
+
+    def write_object(self, object_type, number, data, progress=None):
+        self.request(OPEN_WRITE, struct.pack("<BBI", object_type, number, len(data)),
+                     timeout=OPEN_TIMEOUT)
+        chunks = [data[i:i + self.max_payload] for i in range(0, len(data), self.max_payload)]
+        base = 0
+        next_idx = 0
+        last_progress = time.monotonic()
+        resent = False
+        while True:
+            while next_idx < len(chunks) and next_idx - base < self.window:
+                self.send(DATA, next_idx & 0xFF, chunks[next_idx])
+                next_idx += 1
+            frame = self.next_frame(RETRY_TIMEOUT)
+            if frame is None:
+                if time.monotonic() - last_progress > 5.0:
+                    raise TransferError("transfer stalled")
+                # Go back to the first frame that hasn't been acknowledged
+                next_idx = base
+                continue
+            frame_type, seq, payload = frame
+            if frame_type == DONE:
+                if progress:
+                    progress(len(data), len(data))
+                return
+            if frame_type == ERROR:
+                raise TransferError(ERRORS.get(payload[0], "error %d" % payload[0]))
+            if frame_type == ACK:
+                acked = (seq - base) & 0xFF
+                if acked == 0 and next_idx > base and not resent:
+                    # The device has dropped a frame, send again from it without waiting for the
+                    # timeout. Later duplicates are for frames already sent again so are ignored.
+                    next_idx = base
+                    resent = True
+                elif 0 < acked <= next_idx - base:
+                    base += acked
+                    resent = False
+                    last_progress = time.monotonic()
+                    if progress:
+                        progress(min(base * self.max_payload, len(data)), len(data))
+
+
+def clips_used(info):
+    num_clips = info[4]
+    bitmap = info[6:]
+    return [n for n in range(1, num_clips + 1) if bitmap[(n - 1) // 8] & (1 << ((n - 1) % 8))]
+
+
+def load_clip(path):
+    if path.lower().endswith(".wav"):
+        with wave.open(path, "rb") as wav:
+            if wav.getnchannels() != 1 or wav.getsampwidth() != 2 or wav.getframerate() != SAMPLE_RATE:
+                raise TransferError("%s must be 16 kHz mono 16-bit" % path)
+            data = wav.readframes(CLIP_SAMPLES)
+    else:
+        with open(path, "rb") as f:
+            data = f.read(CLIP_SAMPLES * 2)
+    # Pad short clips with silence
+    return data + bytes(CLIP_SAMPLES * 2 - len(data))
+
+
+def save_clip(path, data):
+    if path.lower().endswith(".wav"):
+        with wave.open(path, "wb") as wav:
+            wav.setnchannels(1)
+            wav.setsampwidth(2)
+            wav.setframerate(SAMPLE_RATE)
+            wav.writeframes(data)
+    else:
+        with open(path, "wb") as f:
+            f.write(data)
+
+
+def show_progress(done, total):
+    sys.stderr.write("\r%6d / %6d bytes" % (done, total))
+    if done == total:
+        sys.stderr.write("\n")
+    sys.stderr.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("port", help="serial port, e.g. /dev/ttyUSB0")
+    parser.add_argument("--baud", type=int, default=CONSOLE_BAUD, choices=DEVICE_BAUD_RATES,
+                        help="baud rate to use for the transfers")
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("info", help="list used clips")
+    for name, help_text in (("get-clip", "download a clip"), ("put-clip", "upload a clip"),
+                            ("get-seq", "download a sequence"), ("put-seq", "upload a sequence")):
+        p = sub.add_parser(name, help=help_text)
+        p.add_argument("number", type=int)
+        p.add_argument("file")
+    sub.add_parser("backup", help="download all used clips and all sequences").add_argument("dir")
+    sub.add_parser("restore", help="upload the clips and sequences in a backup").add_argument("dir")
+    args = parser.parse_args()
+
+    port = Port(args.port)
+    session = Session(port)
+    try:
+        if args.baud != CONSOLE_BAUD and not session.change_baud(args.baud):
+            print("warning: device didn't switch to %d baud, using %d" % (args.baud, CONSOLE_BAUD),
+                  file=sys.stderr)
+        info = session.enter()
+        try:
+            num_sequences = info[5]
+            if args.command == "info":
+                print("protocol %d, window %d, payload %d" % (info[0], session.window, session.max_payload))
+                print("clips used: %s" % " ".join(str(n) for n in clips_used(info)))
+            elif args.command == "get-clip":
+                save_clip(args.file, session.read_object(OBJECT_CLIP, args.number, show_progress))
+            elif args.command == "put-clip":
+                session.write_object(OBJECT_CLIP, args.number, load_clip(args.file), show_progress)
+            elif args.command == "get-seq":
+                with open(args.file, "wb") as f:
+                    f.write(session.read_object(OBJECT_SEQUENCE, args.number))
+            elif args.command == "put-seq":
+                with open(args.file, "rb") as f:
+                    session.write_object(OBJECT_SEQUENCE, args.number, f.read())
+            elif args.command == "backup":
+                os.makedirs(args.dir, exist_ok=True)
+                for n in clips_used(info):
+                    print("clip %d" % n)
+                    data = session.read_object(OBJECT_CLIP, n, show_progress)
+                    save_clip(os.path.join(args.dir, "clip%03d.wav" % n), data)
+                saved = 0
+                for n in range(1, num_sequences + 1):
+                    try:
+                        data = session.read_object(OBJECT_SEQUENCE, n)
+                    except TransferError:
+                        # Unused sequences can't be read
+                        continue
+                    with open(os.path.join(args.dir, "seq%03d.bin" % n), "wb") as f:
+                        f.write(data)
+                    saved += 1
+                print("%d sequences" % saved)
+            elif args.command == "restore":
+                for name in sorted(os.listdir(args.dir)):
+                    path = os.path.join(args.dir, name)
+                    if name.startswith("clip") and name.endswith(".wav"):
+                        print(name)
+                        session.write_object(OBJECT_CLIP, int(name[4:7]), load_clip(path), show_progress)
+                    elif name.startswith("seq") and name.endswith(".bin"):
+                        with open(path, "rb") as f:
+                            session.write_object(OBJECT_SEQUENCE, int(name[3:6]), f.read())
+        finally:
+            session.close()
+    except TransferError as error:
+        sys.exit("error: %s" % error)
+    finally:
+        if port.baud != CONSOLE_BAUD:
+            session.change_baud(CONSOLE_BAUD)
+        port.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Measure the worst case time of the interrupt mix (AUDIO_REFILL_IN_ISR in Inc/audio.h).
+
+    mix_wcet.py /dev/ttyUSB0
+    mix_wcet.py --clips 4 5 6 --seconds 60 /dev/ttyUSB0
+
+Every step of the loaded sequence is set to trigger a whole clip on all three channels, so each
+step restarts every channel and the mix always has three channels to read. The sequence is played,
+the figures are reset once it has settled, and after the given time the "mixwcet" console command
+is read for the worst case mix in cycles and microseconds and the number of underruns.
+
+The sequence is only changed in RAM, load it again with seqload to get it back. The firmware must
+be built with AUDIO_REFILL_IN_ISR defined and the clips must have been stored.
+"""
+
+import argparse
+import re
+import sys
+import time
+
+from mes_transfer import CLIP_SAMPLES, Port
+
+NUM_CHANNELS = 3
+NUM_STEPS = 16
+
+# What the console prints when a command fails
+FAILED = re.compile(rb"must be|[Ee]rror|not found")
+MIX_WCET = re.compile(rb"Mix WCET: (\d+) cycles \((\d+) us\)\r?\nUnderruns: (\d+)")
+
+
+def command(port, line, reply, timeout=2.0):
+    """Sends a console command and reads its output until reply is seen. Exits if the command
+    fails or there's no reply."""
+    port.write(b"\r" + line + b"\r")
+    seen = b""
+    deadline = time.monotonic() + timeout
+    while not re.search(reply, seen):
+        if FAILED.search(seen) or time.monotonic() > deadline:
+            sys.exit("%s: %r" % (line.decode(), seen.decode(errors="replace")))
+        seen += port.read(deadline - time.monotonic())
+    return seen
+
+
+def read_mix_wcet(port):
+    seen = command(port, b"mixwcet", rb"Underruns: \d+\r?\n|not defined")
+    match = MIX_WCET.search(seen)
+    if not match:
+        sys.exit("the firmware mixes in the main loop, build it with AUDIO_REFILL_IN_ISR defined")
+    return tuple(int(n) for n in match.groups())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("port", help="serial port, e.g. /dev/ttyUSB0")
+    parser.add_argument("--clips", type=int, nargs=NUM_CHANNELS, default=[1, 2, 3],
+                        help="clip played on each channel")
+    parser.add_argument("--seconds", type=float, default=30.0, help="how long to play for")
+    args = parser.parse_args()
+
+    port = Port(args.port)
+    try:
+        port.flush_input()
+        command(port, b"seqlen %d" % NUM_STEPS, rb"Sequence length set")
+        for channel, clip in enumerate(args.clips):
+            for step in range(NUM_STEPS):
+                command(port, b"schsparams %d %d %d 0 %d f" % (channel, step, clip, CLIP_SAMPLES - 1),
+                        rb"Step channel params set")
+        command(port, b"startseq", rb"Sequence started")
+        time.sleep(1.0)
+        # Leave out starting the sequence
+        read_mix_wcet(port)
+        time.sleep(args.seconds)
+        cycles, us, underruns = read_mix_wcet(port)
+        command(port, b"stopseq", rb"Sequence stopped")
+    finally:
+        port.close()
+
+    print("clips %s for %g s" % (" ".join(str(n) for n in args.clips), args.seconds))
+    print("mix WCET %d cycles (%d us)" % (cycles, us))
+    print("underruns %d" % underruns)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""Check the baud rate negotiation in mes_transfer.py against an emulated device on a pseudo-terminal.
+
+    python3 Tools/test_baud_pty.py
+
+The emulated device answers the "baud", "baudok" and "xfer" console commands like Src/consoleIo.c
+and Src/consoleCommands.c, and the transfer requests like Src/transfer.c, with the clips kept in
+memory. A pseudo-terminal carries data at whatever rate it is set to, so to stand in for a real UART
+the device compares its own rate with the rate the host has set on the terminal, and whenever they
+differ every byte in either direction is corrupted.
+
+Runs on Linux, where the master side of a pseudo-terminal sees the rate set on the slave side.
+"""
+
+import os
+import pty
+import select
+import subprocess
+import sys
+import tempfile
+import termios
+import threading
+import time
+import tty
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import mes_transfer as mt  # noqa: E402
+
+MES_TRANSFER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "mes_transfer.py")
+
+NUM_CLIPS = 16
+NUM_SEQUENCES = 8
+CLIP_SIZE = mt.CLIP_SAMPLES * 2
+# See BAUD_CONFIRM_MS in Src/consoleIo.c and RETRY_TIMEOUT_MS in Src/transfer.c
+BAUD_CONFIRM_TIMEOUT = 1.0
+RETRY_TIMEOUT = 0.25
+
+SPEEDS = {getattr(termios, "B%d" % rate): rate for rate in mt.DEVICE_BAUD_RATES if hasattr(termios, "B%d" % rate)}
+
+
+def corrupt(data):
+    """What arrives when the two ends of a UART are at different rates, near enough."""
+    return bytes(b ^ 0xFF for b in data)
+
+
+class EmulatedDevice(threading.Thread):
+    """The device end of the pseudo-terminal. With wrong_rate set, a baud rate change switches the
+    UART to half the rate asked for, so the change is never confirmed."""
+
+    def __init__(self, master, wrong_rate=False):
+        super().__init__(daemon=True)
+        self.master = master
+        self.wrong_rate = wrong_rate
+        self.rate = mt.CONSOLE_BAUD
+        self.previous_rate = None
+        self.confirm_deadline = None
+        self.line = bytearray()
+        self.transfer_mode = False
+        self.parser = mt.FrameParser()
+        self.clips = {n: bytes((n * 31 + i * 7) & 0xFF for i in range(CLIP_SIZE)) for n in (1, 3, 5)}
+        # Rate the UART was at for each object opened, as (request, number, rate)
+        self.opens = []
+        self.stopping = threading.Event()
+        self.state = None
+
+    def host_rate(self):
+        return SPEEDS.get(termios.tcgetattr(self.master)[4])
+
+    def send(self, data):
+        if self.host_rate() != self.rate:
+            data = corrupt(data)
+        view = memoryview(data)
+        while view:
+            view = view[os.write(self.master, view):]
+
+    def run(self):
+        while not self.stopping.is_set():
+            data = b""
+            if select.select([self.master], [], [], 0.02)[0]:
+                data = os.read(self.master, 4096)
+            if data and self.host_rate() != self.rate:
+                data = corrupt(data)
+            if self.transfer_mode:
+                for frame in self.parser.feed(data):
+                    self.frame(*frame)
+                self.transfer_tick()
+            else:
+                self.console(data)
+            if self.confirm_deadline and time.monotonic() > self.confirm_deadline:
+                self.rate = self.previous_rate
+                self.confirm_deadline = None
+                self.send(b"\r\nBaud rate not confirmed\r\n> ")
+
+    def console(self, data):
+        for byte in data:
+            if byte not in b"\r\n":
+                self.line.append(byte)
+                continue
+            words = bytes(self.line).split()
+            self.line.clear()
+            if not words:
+                self.send(b"\r\n> ")
+            elif words[0] == b"baud" and len(words) == 2 and int(words[1]) in SPEEDS.values():
+                rate = int(words[1])
+                self.send(b"\r\nChanging to %d baud, confirm with baudok\r\n" % rate)
+                self.previous_rate = self.rate
+                self.rate = rate // 2 if self.wrong_rate else rate
+                self.confirm_deadline = time.monotonic() + BAUD_CONFIRM_TIMEOUT
+            elif words[0] == b"baudok":
+                if self.confirm_deadline:
+                    self.confirm_deadline = None
+                    self.send(b"\r\nBaud rate confirmed\r\n> ")
+                else:
+                    self.send(b"\r\nNo baud rate change to confirm\r\n> ")
+            elif words[0] == b"xfer":
+                self.send(b"\r\nBinary transfer mode\r\n")
+                self.transfer_mode = True
+                self.parser = mt.FrameParser()
+                return
+            else:
+                self.send(b"\r\nCommand not found\r\n> ")
+
+    def send_frame(self, frame_type, seq=0, payload=b""):
+        self.send(mt.encode_frame(frame_type, seq, payload))
+
+    def frame(self, frame_type, seq, payload):
+        if frame_type == mt.HELLO:
+            bitmap = bytearray((NUM_CLIPS + 7) // 8)
+            for n in self.clips:
+                bitmap[(n - 1) // 8] |= 1 << ((n - 1) % 8)
+            self.send_frame(mt.INFO, 0, bytes([1, 8, 0, 1, NUM_CLIPS, NUM_SEQUENCES]) + bitmap)
+        elif frame_type == mt.OPEN_READ and payload[0] == mt.OBJECT_CLIP and payload[1] in self.clips:
+            self.opens.append(("read", payload[1], self.rate))
+            data = self.clips[payload[1]]
+            self.state = {"read": data, "frames": (len(data) + 255) // 256, "base": 0, "next": 0,
+                          "last": time.monotonic()}
+            self.send_frame(mt.OPEN_OK, 0, len(data).to_bytes(4, "little"))
+        elif frame_type == mt.OPEN_WRITE and payload[0] == mt.OBJECT_CLIP:
+            size = int.from_bytes(payload[2:6], "little")
+            self.opens.append(("write", payload[1], self.rate))
+            self.state = {"write": payload[1], "data": bytearray(), "size": size,
+                          "frames": (size + 255) // 256, "expected": 0}
+            self.send_frame(mt.OPEN_OK, 0, payload[2:6])
+        elif frame_type in (mt.OPEN_READ, mt.OPEN_WRITE):
+            self.send_frame(mt.ERROR, 0, bytes([0x03]))
+        elif frame_type == mt.ACK and self.state and "read" in self.state:
+            state = self.state
+            acked = (seq - state["base"]) & 0xFF
+            if acked == 0:
+                state["next"] = state["base"]
+            elif acked <= state["next"] - state["base"]:
+                state["base"] += acked
+                state["last"] = time.monotonic()
+                if state["base"] == state["frames"]:
+                    self.send_frame(mt.DONE)
+                    self.state = None
+        elif frame_type == mt.DATA and self.state and "write" in self.state:
+            state = self.state
+            if seq == state["expected"] & 0xFF:
+                state["data"] += payload
+                state["expected"] += 1
+                if state["expected"] == state["frames"]:
+                    self.clips[state["write"]] = bytes(state["data"])
+                    self.send_frame(mt.DONE)
+                    self.state = None
+                    return
+            self.send_frame(mt.ACK, state["expected"] & 0xFF)
+        elif frame_type == mt.CLOSE:
+            self.send_frame(mt.CLOSE)
+            self.state = None
+            self.transfer_mode = False
+            self.send(b"\r\n> ")
+
+    def transfer_tick(self):
+        state = self.state
+        if not state or "read" not in state:
+            return
+        if time.monotonic() - state["last"] > RETRY_TIMEOUT:
+            state["next"] = state["base"]
+            state["last"] = time.monotonic()
+        while state["next"] < state["frames"] and state["next"] - state["base"] < 8:
+            offset = state["next"] * 256
+            self.send_frame(mt.DATA, state["next"] & 0xFF, state["read"][offset:offset + 256])
+            state["next"] += 1
+
+
+class BaudNegotiationTest(unittest.TestCase):
+
+    def start_device(self, wrong_rate=False):
+        master, slave = pty.openpty()
+        # Kept open so the master doesn't see a hang up between runs of mes_transfer.py
+        tty.setraw(slave)
+        self.addCleanup(os.close, master)
+        self.addCleanup(os.close, slave)
+        device = EmulatedDevice(master, wrong_rate)
+        device.start()
+        self.addCleanup(device.join)
+        self.addCleanup(device.stopping.set)
+        return device, os.ttyname(slave)
+
+    def transfer(self, path, *args):
+        return subprocess.run([sys.executable, MES_TRANSFER] + list(args[:2]) + [path] + list(args[2:]),
+                              capture_output=True, text=True, timeout=60)
+
+    def settle(self, device):
+        # mes_transfer.py doesn't wait for the device's reply to the final baudok
+        deadline = time.monotonic() + 2.0
+        while device.confirm_deadline and time.monotonic() < deadline:
+            time.sleep(0.05)
+
+    def test_get_clip_at_921600(self):
+        device, path = self.start_device()
+        with tempfile.TemporaryDirectory() as tmp:
+            out = os.path.join(tmp, "clip.raw")
+            result = self.transfer(path, "--baud", "921600", "get-clip", "3", out)
+            self.assertEqual(result.returncode, 0, result.stderr)
+            self.assertNotIn("warning", result.stderr)
+            with open(out, "rb") as f:
+                self.assertEqual(f.read(), device.clips[3])
+        self.settle(device)
+        self.assertEqual(device.opens, [("read", 3, 921600)])
+        self.assertEqual(device.rate, mt.CONSOLE_BAUD)
+        self.assertIsNone(device.confirm_deadline)
+
+    def test_put_clip_at_3000000(self):
+        device, path = self.start_device()
+        data = bytes((i * 13) & 0xFF for i in range(CLIP_SIZE))
+        with tempfile.TemporaryDirectory() as tmp:
+            src = os.path.join(tmp, "clip.raw")
+            with open(src, "wb") as f:
+                f.write(data)
+            result = self.transfer(path, "--baud", "3000000", "put-clip", "7", src)
+            self.assertEqual(result.returncode, 0, result.stderr)
+        self.settle(device)
+        self.assertEqual(device.clips[7], data)
+        self.assertEqual(device.opens, [("write", 7, 3000000)])
+        self.assertEqual(device.rate, mt.CONSOLE_BAUD)
+        self.assertIsNone(device.confirm_deadline)
+
+    def test_falls_back_when_device_is_at_wrong_rate(self):
+        device, path = self.start_device(wrong_rate=True)
+        with tempfile.TemporaryDirectory() as tmp:
+            out = os.path.join(tmp, "clip.raw")
+            start = time.monotonic()
+            result = self.transfer(path, "--baud", "921600", "get-clip", "5", out)
+            self.assertEqual(result.returncode, 0, result.stderr)
+            self.assertIn("didn't switch to 921600", result.stderr)
+            with open(out, "rb") as f:
+                self.assertEqual(f.read(), device.clips[5])
+        self.assertEqual(device.opens, [("read", 5, mt.CONSOLE_BAUD)])
+        # Half of BAUD_CONFIRM_TIMEOUT waiting for the confirmation, then all of it for the device
+        # to go back, plus the transfer itself
+        self.assertLess(time.monotonic() - start, 2.0 + 1.0)
+        self.assertEqual(device.rate, mt.CONSOLE_BAUD)
+
+
+if __name__ == "__main__":
+    unittest.main()
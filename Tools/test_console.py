@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+"""Check the console's command lookup and parameter parsing on the host.
+
+    python3 Tools/test_console.py
+
+Src/console.c is built with the host C compiler (CC, or cc) against a small table of commands that
+print the parameters they are given, and lines are run through ConsoleExecuteLine as if they had
+been typed, including ';' batches. The firmware's own command table is also checked to be in the
+strcmp order the binary search in ConsoleCommandFind needs.
+"""
+
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# The headers console.c includes that would bring in the HAL
+STUBS = {
+    "scheduler.h": "#define EVENT_CONSOLE 0\nstatic inline void schedulerPost(int event) { (void) event; }\n",
+    "profile.h": "#define PROFILE_BEGIN(zone)\n#define PROFILE_END(zone)\n",
+    "macro.h": "#include <stdbool.h>\n#include <stdint.h>\n"
+               "static inline bool macroRecordLine(const char *line, uint32_t length)"
+               " { (void) line; (void) length; return false; }\n"
+               "static inline void macroProcess(void) {}\n",
+}
+
+# Each command prints its name and its parameters read as uint32, ? for one that isn't a number,
+# stopping at the first parameter ConsoleParamFindN doesn't find
+HARNESS = r"""
+#include <stdio.h>
+#include <string.h>
+#include "console.h"
+#include "consoleIo.h"
+#include "consoleCommands.h"
+
+eConsoleError ConsoleIoInit(void) { return CONSOLE_SUCCESS; }
+eConsoleError ConsoleIoReceive(uint8_t *buffer, const uint32_t bufferLength, uint32_t *readLength)
+{
+  (void) buffer; (void) bufferLength;
+  *readLength = 0;
+  return CONSOLE_SUCCESS;
+}
+eConsoleError ConsoleIoSendString(const char *buffer) { fputs(buffer, stdout); return CONSOLE_SUCCESS; }
+eConsoleError ConsoleIoSendData(const uint8_t *buffer, const uint32_t length)
+{
+  fwrite(buffer, 1, length, stdout);
+  return CONSOLE_SUCCESS;
+}
+
+static eCommandResult_T Show(const char buffer[])
+{
+  uint32_t start;
+  uint32_t value;
+  uint8_t i = 0;
+
+  putchar('[');
+  while (buffer[i] != ' ' && buffer[i] != '\r' && buffer[i] != '\n' && buffer[i] != '\0') {
+    putchar(buffer[i++]);
+  }
+  for (i = 1; ConsoleParamFindN(buffer, i, &start) == COMMAND_SUCCESS; i++) {
+    if (ConsoleReceiveParamUInt32(buffer, i, &value) == COMMAND_SUCCESS) {
+      printf(" %u", (unsigned) value);
+    } else {
+      printf(" ?");
+    }
+  }
+  putchar(']');
+  return COMMAND_SUCCESS;
+}
+
+static const sConsoleCommandTable_T table[] = {
+#ifdef UNSORTED
+  {"stats", &Show, HELP("")},
+  {"baud", &Show, HELP("")},
+#else
+  {";", &Show, HELP("")},
+  {"baud", &Show, HELP("")},
+  {"song", &Show, HELP("")},
+  {"songstart", &Show, HELP("")},
+  {"stats", &Show, HELP("")},
+#endif
+  CONSOLE_COMMAND_TABLE_END
+};
+
+const sConsoleCommandTable_T* ConsoleCommandsGetTable(void) { return table; }
+
+int main(int argc, char *argv[])
+{
+  char line[CONSOLE_COMMAND_MAX_LENGTH];
+
+  ConsoleInit();
+  for (int i = 1; i < argc; i++) {
+    uint32_t length = strlen(argv[i]);
+    memset(line, 0, sizeof(line));
+    memcpy(line, argv[i], length);
+    line[length] = '\r';
+    // Marks the start of what each line printed
+    putchar('\x1e');
+    ConsoleExecuteLine(line, length);
+  }
+  return 0;
+}
+"""
+
+
+def build(tmp, name, defines=()):
+    cc = os.environ.get("CC", "cc")
+    for header, text in STUBS.items():
+        with open(os.path.join(tmp, header), "w") as f:
+            f.write(text)
+    source = os.path.join(tmp, "harness.c")
+    with open(source, "w") as f:
+        f.write(HARNESS)
+    binary = os.path.join(tmp, name)
+    subprocess.run([cc, "-std=gnu11", "-Wall", "-I", tmp, "-I", os.path.join(ROOT, "Inc")] +
+                   ["-D%s" % d for d in defines] +
+                   ["-o", binary, source, os.path.join(ROOT, "Src", "console.c")], check=True)
+    return binary
+
+
+@unittest.skipIf(shutil.which(os.environ.get("CC", "cc")) is None, "no host C compiler")
+class ConsoleTest(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.tmp = tempfile.mkdtemp()
+        cls.binary = build(cls.tmp, "console")
+        cls.unsorted = build(cls.tmp, "unsorted", ["UNSORTED"])
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.tmp)
+
+    def run_lines(self, *lines):
+        result = subprocess.run([self.binary] + list(lines), capture_output=True, check=True)
+        # Drop the welcome message, keep what each line printed
+        return result.stdout.decode().split("\x1e")[1:]
+
+    def check(self, line, expected):
+        self.assertEqual(self.run_lines(line), [expected], line)
+
+    def test_single_commands(self):
+        self.check("baud", "[baud]")
+        self.check("baud 921600", "[baud 921600]")
+        self.check("song 1 2 3", "[song 1 2 3]")
+        self.check("songstart", "[songstart]")
+
+    def test_batch_parameterless_command_then_another(self):
+        self.check("baud; stats", "[baud][stats]")
+        self.check("stats; baud 921600", "[stats][baud 921600]")
+
+    def test_batch_parameters_stop_at_the_separator(self):
+        self.check("song 1 2; songstart", "[song 1 2][songstart]")
+        self.check("song 1 2 ; stats", "[song 1 2][stats]")
+        self.check("baud 921600; baud 115200; baud", "[baud 921600][baud 115200][baud]")
+
+    def test_bad_numbers(self):
+        self.check("baud abc", "[baud ?]")
+        self.check("baud 921600x", "[baud ?]")
+        self.check("baud -5", "[baud ?]")
+
+    def test_comment_line_is_not_split(self):
+        self.check("; baud; stats", "[; ? ?]")
+
+    def test_unknown_command(self):
+        self.check("bogus; baud", "Command not found.\r\n[baud]")
+
+    def test_unsorted_table_is_reported(self):
+        result = subprocess.run([self.unsorted], capture_output=True, text=True, check=True)
+        self.assertIn("Command table out of order at: baud", result.stdout)
+        result = subprocess.run([self.binary], capture_output=True, text=True, check=True)
+        self.assertNotIn("out of order", result.stdout)
+
+    def test_firmware_table_is_sorted(self):
+        with open(os.path.join(ROOT, "Src", "consoleCommands.c")) as f:
+            source = f.read()
+        table = source[source.index("mConsoleCommandTable[] ="):source.index("CONSOLE_COMMAND_TABLE_END")]
+        names = [n.encode() for n in re.findall(r'^\s*\{"([^"]+)"', table, re.M)]
+        self.assertGreater(len(names), 10)
+        self.assertEqual(names, sorted(names))
+        self.assertEqual(len(names), len(set(names)))
+
+
+if __name__ == "__main__":
+    unittest.main()
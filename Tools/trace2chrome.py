@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Convert a trace dump from the "tracedump" console command into Chrome trace JSON.
+
+Capture the raw bytes from the serial port while running tracedump, for example
+
+    stty -F /dev/ttyUSB0 115200 raw
+    cat /dev/ttyUSB0 > capture.bin
+
+then run
+
+    trace2chrome.py capture.bin trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev.
+
+The capture can contain other console output, the dump is found by its "TRACE" marker.
+Event ids must match eTraceEvent_T in Inc/trace.h.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MARKER = b"TRACE"
+HEADER = struct.Struct("<HI")
+RECORD = struct.Struct("<IHH")
+
+# Thread lanes in the timeline
+MAIN_TID = 1
+ISR_TID = 2
+
+# id: (name, kind, tid) where kind is "B" (begin), "E" (end) or "i" (instant)
+EVENTS = {
+    0x01: ("I2S RX half", "i", ISR_TID),
+    0x02: ("I2S RX complete", "i", ISR_TID),
+    0x03: ("I2S TX half", "i", ISR_TID),
+    0x04: ("I2S TX complete", "i", ISR_TID),
+    0x05: ("step", "i", MAIN_TID),
+    0x10: ("flash read", "B", MAIN_TID),
+    0x11: ("flash read", "E", MAIN_TID),
+    0x12: ("flash write", "B", MAIN_TID),
+    0x13: ("flash write", "E", MAIN_TID),
+    0x14: ("flash erase", "B", MAIN_TID),
+    0x15: ("flash erase", "E", MAIN_TID),
+    0x20: ("UI render", "B", MAIN_TID),
+    0x21: ("UI render", "E", MAIN_TID),
+    0x30: ("handler", "B", MAIN_TID),
+    0x31: ("handler", "E", MAIN_TID),
+}
+
+# Scheduler handlers in priority order, see eSchedulerEvent_T in Inc/scheduler.h
+HANDLER_NAMES = ["audio", "step", "console", "ui", "sequence", "transfer"]
+
+
+def find_dump(data):
+    """Returns (clock, records) for the last complete dump in data."""
+    pos = data.rfind(MARKER)
+    while pos >= 0:
+        start = pos + len(MARKER)
+        if len(data) >= start + HEADER.size:
+            count, clock = HEADER.unpack_from(data, start)
+            start += HEADER.size
+            if len(data) >= start + count * RECORD.size:
+                records = [RECORD.unpack_from(data, start + i * RECORD.size) for i in range(count)]
+                return clock, records
+        pos = data.rfind(MARKER, 0, pos)
+    raise ValueError("no complete trace dump found")
+
+
+def to_chrome(clock, records):
+    events = [
+        {"name": "thread_name", "ph": "M", "pid": 1, "tid": MAIN_TID, "args": {"name": "main loop"}},
+        {"name": "thread_name", "ph": "M", "pid": 1, "tid": ISR_TID, "args": {"name": "interrupts"}},
+    ]
+    cycles_per_us = clock / 1e6
+    base = None
+    last = 0
+    wraps = 0
+
+    for timestamp, event_id, arg in records:
+        # The cycle counter wraps every 2^32 cycles, records are in order so unwrap them
+        if base is not None and timestamp < last:
+            wraps += 1
+        last = timestamp
+        cycles = timestamp + (wraps << 32)
+        if base is None:
+            base = cycles
+
+        name, kind, tid = EVENTS.get(event_id, ("event 0x%02x" % event_id, "i", MAIN_TID))
+        if event_id in (0x30, 0x31) and arg < len(HANDLER_NAMES):
+            name = HANDLER_NAMES[arg]
+
+        event = {"name": name, "ph": kind, "pid": 1, "tid": tid, "ts": (cycles - base) / cycles_per_us}
+        if kind == "i":
+            event["s"] = "t"
+        if kind != "E":
+            event["args"] = {"arg": arg}
+        events.append(event)
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="file holding the raw serial capture")
+    parser.add_argument("output", nargs="?", help="JSON file to write (default stdout)")
+    args = parser.parse_args()
+
+    with open(args.capture, "rb") as f:
+        data = f.read()
+
+    try:
+        clock, records = find_dump(data)
+    except ValueError as e:
+        sys.exit("%s: %s" % (args.capture, e))
+
+    trace = to_chrome(clock, records)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()